@@ -1,8 +1,19 @@
 #include <net/buffer.h>
 #include <utils/uv_error.h>
 
+#include <fcntl.h>
 #include <limits.h>
+#include <poll.h>
+#include <sys/sendfile.h>
 #include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#ifndef MSG_ZEROCOPY
+#define MSG_ZEROCOPY 0x4000000
+#endif
+
 namespace common_library {
 
 BufferSock::BufferSock(const Buffer::Ptr&       buffer,
@@ -34,6 +45,11 @@ uint32_t BufferSock::Size() const
     return buffer_->Size();
 }
 
+BufferFile::~BufferFile()
+{
+    ::close(fd_);
+}
+
 BufferList::BufferList(List<Buffer::Ptr>& list) : iovec_(list.size())
 {
     pkt_list_.swap(list);
@@ -43,6 +59,14 @@ BufferList::BufferList(List<Buffer::Ptr>& list) : iovec_(list.size())
         it->iov_base = buffer->Data();
         it->iov_len  = buffer->Size();
         remain_size_ += it->iov_len;
+        if (!it->iov_base) {
+            // 只有BufferFile没有数据指针
+            if (files_.empty()) {
+                files_.resize(iovec_.size(), nullptr);
+            }
+            files_[it - iovec_.begin()] =
+                static_cast<BufferFile*>(buffer.get());
+        }
         it++;
     });
 }
@@ -57,32 +81,72 @@ int BufferList::count()
     return iovec_.size() - iovec_off_;
 }
 
-int BufferList::send(int fd, int flags, bool udp)
+uint64_t BufferList::size()
+{
+    return remain_size_;
+}
+
+ssize_t BufferList::send(int fd, int flags, bool udp)
+{
+    uint64_t remain_size = remain_size_;
+    wait_fd_             = -1;
+    if (udp) {
+        while (remain_size_ && send_mmsg(fd, flags) > 0) {}
+    }
+    else {
+        while (remain_size_ && send_l(fd, flags) != -1) {}
+    }
+
+    ssize_t sent = remain_size - remain_size_;
+    // 文件被截断时即使已有进展也返回错误，此时socket仍可写，不会再触发重试
+    if (sent > 0 && !(remain_size_ && errno == ENODATA)) {
+        return sent;
+    }
+    return -1;
+}
+
+ssize_t BufferList::send_zerocopy(int       fd,
+                                  int       flags,
+                                  uint32_t& calls,
+                                  uint64_t& bytes)
 {
-    int remain_size = remain_size_;
-    while (remain_size_ && send_l(fd, flags, udp) != -1) {}
+    hold_sent_           = true;
+    wait_fd_             = -1;
+    uint64_t remain_size = remain_size_;
+    while (remain_size_) {
+        // sendfile不占用零拷贝通知序号
+        bool file = !files_.empty() && files_[iovec_off_];
+        int  n    = send_l(fd, flags | MSG_ZEROCOPY);
+        if (n == -1) {
+            break;
+        }
+        if (!file) {
+            calls++;
+            bytes += n;
+        }
+    }
 
-    int sent = remain_size - remain_size_;
-    if (sent > 0) {
+    ssize_t sent = remain_size - remain_size_;
+    if (sent > 0 && !(remain_size_ && errno == ENODATA)) {
         return sent;
     }
     return -1;
 }
 
-void BufferList::reoffset(int n)
+void BufferList::reoffset(ssize_t n)
 {
     remain_size_ -= n;
-    int offset   = 0;
-    int last_off = iovec_off_;
+    size_t offset   = 0;
+    int    last_off = iovec_off_;
 
     for (int i = last_off; i < static_cast<int>(iovec_.size()); i++) {
         struct iovec& ref = iovec_[i];
         offset += ref.iov_len;
-        if (offset < n) {
+        if (offset < size_t(n)) {
             continue;
         }
 
-        int remain_size = offset - n;
+        size_t remain_size = offset - n;
         ref.iov_base    = (char*)ref.iov_base + ref.iov_len - remain_size;
         ref.iov_len     = remain_size;
         iovec_off_      = i;
@@ -92,34 +156,37 @@ void BufferList::reoffset(int n)
         break;
     }
 
+    if (hold_sent_) {
+        return;
+    }
     for (int i = last_off; i < iovec_off_; i++) {
         pkt_list_.pop_front();
     }
 }
 
-int BufferList::send_l(int fd, int flags, bool udp)
+int BufferList::send_l(int fd, int flags)
 {
+    size_t iovlen = std::min<size_t>(iovec_.size() - iovec_off_, IOV_MAX);
+    if (!files_.empty()) {
+        if (files_[iovec_off_]) {
+            return send_file(fd);
+        }
+        for (size_t i = 1; i < iovlen; i++) {
+            if (files_[iovec_off_ + i]) {
+                iovlen = i;
+                break;
+            }
+        }
+    }
+
     int n;
 
     do {
         struct msghdr msg;
-        if (!udp) {
-            msg.msg_name    = nullptr;
-            msg.msg_namelen = 0;
-        }
-        else {
-            BufferSock* buffer =
-                static_cast<BufferSock*>(pkt_list_.front().get());
-            msg.msg_name    = buffer->addr_;
-            msg.msg_namelen = buffer->addr_len_;
-        }
-
-        msg.msg_iov    = &iovec_[iovec_off_];
-        msg.msg_iovlen = iovec_.size() - iovec_off_;
-        int max        = udp ? 1 : IOV_MAX;
-        if (msg.msg_iovlen > static_cast<size_t>(max)) {
-            msg.msg_iovlen = max;
-        }
+        msg.msg_name    = nullptr;
+        msg.msg_namelen = 0;
+        msg.msg_iov     = &iovec_[iovec_off_];
+        msg.msg_iovlen  = iovlen;
 
         msg.msg_control    = nullptr;
         msg.msg_controllen = 0;
@@ -128,7 +195,7 @@ int BufferList::send_l(int fd, int flags, bool udp)
 
     } while (n == -1 && EINTR == get_uv_error());
 
-    if (n >= remain_size_) {
+    if (n > 0 && uint64_t(n) >= remain_size_) {
         iovec_off_   = iovec_.size();
         remain_size_ = 0;
         return n;
@@ -141,4 +208,91 @@ int BufferList::send_l(int fd, int flags, bool udp)
 
     return n;
 }
-}  // namespace common_library
\ No newline at end of file
+
+int BufferList::send_file(int fd)
+{
+    BufferFile*   file = files_[iovec_off_];
+    struct iovec& ref  = iovec_[iovec_off_];
+    ssize_t       n;
+
+    do {
+        if (file->IsPipe()) {
+            n = splice(file->FD(), nullptr, fd, nullptr, ref.iov_len,
+                       SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+        }
+        else {
+            // 已发送的部分由剩余长度推算，不修改BufferFile
+            off_t offset = file->Offset() + file->Size() - ref.iov_len;
+            n            = sendfile(fd, file->FD(), &offset, ref.iov_len);
+        }
+    } while (n == -1 && EINTR == get_uv_error());
+
+    if (n == 0) {
+        // 文件被截断或管道写端已关闭，剩余数据无法补齐
+        errno = ENODATA;
+        return -1;
+    }
+
+    if (n == -1) {
+        if (file->IsPipe() && EAGAIN == get_uv_error()) {
+            // 区分管道为空和socket缓冲已满
+            struct pollfd pfd;
+            pfd.fd     = file->FD();
+            pfd.events = POLLIN;
+            if (poll(&pfd, 1, 0) == 0) {
+                wait_fd_ = file->FD();
+            }
+            errno = EAGAIN;
+        }
+        return -1;
+    }
+
+    remain_size_ -= n;
+    ref.iov_len -= n;
+    if (ref.iov_len == 0) {
+        iovec_off_++;
+        if (!hold_sent_) {
+            pkt_list_.pop_front();
+        }
+    }
+    return n;
+}
+
+int BufferList::send_mmsg(int fd, int flags)
+{
+    if (msgvec_.empty()) {
+        // 第一次发送时为每个数据报构造mmsghdr，与iovec_下标一一对应
+        msgvec_.resize(iovec_.size());
+        int i = 0;
+        pkt_list_.for_each([&](const Buffer::Ptr& buffer) {
+            BufferSock*    sock = static_cast<BufferSock*>(buffer.get());
+            struct msghdr& msg  = msgvec_[i].msg_hdr;
+            msg.msg_name        = sock->addr_;
+            msg.msg_namelen     = sock->addr_len_;
+            msg.msg_iov         = &iovec_[i];
+            msg.msg_iovlen      = 1;
+            msg.msg_control     = nullptr;
+            msg.msg_controllen  = 0;
+            msg.msg_flags       = 0;
+            msgvec_[i].msg_len  = 0;
+            i++;
+        });
+    }
+
+    int batch = std::min<int>(count(), UDP_SEND_BATCH_SIZE);
+    int n;
+    do {
+        n = sendmmsg(fd, &msgvec_[iovec_off_], batch, flags);
+    } while (n == -1 && EINTR == get_uv_error());
+
+    // 部分发送时只移除已发送的数据报，剩余的等待下次可写
+    // 数据报整体发送，不存在单个数据报只发送一部分的情况
+    for (int i = 0; i < n; i++) {
+        remain_size_ -= iovec_[iovec_off_].iov_len;
+        iovec_off_++;
+        pkt_list_.pop_front();
+    }
+
+    return n;
+}
+}  // namespace common_library
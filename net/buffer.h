@@ -13,6 +13,9 @@
 #include <string>
 #include <vector>
 
+// 单次sendmmsg最多发送的数据报数
+#define UDP_SEND_BATCH_SIZE 256
+
 namespace common_library {
 
 class Buffer : public noncopyable {
@@ -120,6 +123,81 @@ class BufferRaw final : public Buffer {
     uint32_t size_     = 0;
 };
 
+/**
+ * 引用另一个Buffer中的一段数据，不拷贝，持有原Buffer的引用
+ * 数据不以'\0'结尾
+ */
+class BufferSlice final : public Buffer {
+  public:
+    typedef std::shared_ptr<BufferSlice> Ptr;
+    BufferSlice(const Buffer::Ptr& buffer, uint32_t offset, uint32_t size)
+        : buffer_(buffer), offset_(offset), size_(size)
+    {
+        if (offset + size > buffer->Size()) {
+            throw std::invalid_argument("BufferSlice out of range");
+        }
+    }
+
+  public:
+    char* Data() const override
+    {
+        return buffer_->Data() + offset_;
+    }
+    uint32_t Size() const override
+    {
+        return size_;
+    }
+
+  private:
+    Buffer::Ptr buffer_;
+    uint32_t    offset_;
+    uint32_t    size_;
+};
+
+/**
+ * 文件或管道中的一段数据，发送时由sendfile/splice直接从fd写入socket
+ * 数据不经过用户态，Data()返回nullptr，不能作为普通Buffer读取
+ * 持有fd的所有权，析构时关闭
+ * 普通文件从offset处开始发送，管道忽略offset，按顺序读出size字节
+ */
+class BufferFile final : public Buffer {
+  public:
+    typedef std::shared_ptr<BufferFile> Ptr;
+    BufferFile(int fd, off_t offset, uint32_t size, bool is_pipe)
+        : fd_(fd), offset_(offset), size_(size), is_pipe_(is_pipe)
+    {
+    }
+    ~BufferFile();
+
+  public:
+    char* Data() const override
+    {
+        return nullptr;
+    }
+    uint32_t Size() const override
+    {
+        return size_;
+    }
+    int FD() const
+    {
+        return fd_;
+    }
+    off_t Offset() const
+    {
+        return offset_;
+    }
+    bool IsPipe() const
+    {
+        return is_pipe_;
+    }
+
+  private:
+    int      fd_;
+    off_t    offset_;
+    uint32_t size_;
+    bool     is_pipe_;
+};
+
 class BufferList;
 class BufferSock : public Buffer {
   public:
@@ -148,17 +226,44 @@ class BufferList : public noncopyable {
   public:
     bool empty();
     int  count();
-    int  send(int fd, int flags, bool udp);
+    // 剩余未发送的字节数，SendFile可能使其超过int范围
+    uint64_t size();
+    ssize_t  send(int fd, int flags, bool udp);
+    /**
+     * TCP零拷贝发送，之后已发送的Buffer保留到BufferList析构
+     * calls累加成功的sendmsg次数，每次占用一个完成通知序号
+     * bytes累加通过sendmsg发送的字节数，不含BufferFile
+     */
+    ssize_t
+    send_zerocopy(int fd, int flags, uint32_t& calls, uint64_t& bytes);
+    /**
+     * 上次发送因管道中暂无数据而停止时返回该管道的fd，否则返回-1
+     */
+    int wait_fd()
+    {
+        return wait_fd_;
+    }
 
   private:
-    void reoffset(int n);
-    int  send_l(int fd, int flags, bool udp);
+    void reoffset(ssize_t n);
+    // TCP使用sendmsg，一次最多IOV_MAX个iovec，遇到BufferFile时截止
+    int send_l(int fd, int flags);
+    // 发送iovec_off_处的BufferFile
+    int send_file(int fd);
+    // UDP每个数据报一个mmsghdr，通过sendmmsg批量发送
+    int send_mmsg(int fd, int flags);
 
   private:
-    std::vector<struct iovec> iovec_;
-    int                       iovec_off_   = 0;
-    int                       remain_size_ = 0;
-    List<Buffer::Ptr>         pkt_list_;
+    std::vector<struct iovec>   iovec_;
+    std::vector<struct mmsghdr> msgvec_;
+    int                         iovec_off_   = 0;
+    uint64_t                    remain_size_ = 0;
+    // 与iovec_下标对应，只在包含BufferFile时分配
+    std::vector<BufferFile*> files_;
+    int                      wait_fd_ = -1;
+    // 内核可能仍在引用已发送的数据，不能提前释放
+    bool              hold_sent_ = false;
+    List<Buffer::Ptr> pkt_list_;
 };
 }  // namespace common_library
 
@@ -4,72 +4,312 @@
 #include <utils/uv_error.h>
 
 #include <netdb.h>
+#include <string.h>
+
+#include <algorithm>
 
 namespace common_library {
 
 INSTANCE_IMPL(DNSCache);
 
-DNSCache::DNSCache() {}
-
 bool DNSCache::Parse(const char* host, sockaddr_storage& addr, int expire_sec)
 {
-    DNSItem item;
-    if (!get_cache_domain_ip(host, item, expire_sec)) {
-        // 本地缓存中没找到，到系统缓存去找
-        if (!get_system_domain_ip(host, item)) {
-            return false;
-        }
+    std::vector<sockaddr_storage> addrs;
+    if (!Parse(host, addrs, expire_sec)) {
+        return false;
     }
 
-    addr = item.addr;
+    addr = addrs.front();
     return true;
 }
 
-bool DNSCache::get_cache_domain_ip(const char* host,
-                                   DNSItem&    item,
-                                   int         expire_sec)
+bool DNSCache::Parse(const char*                    host,
+                     std::vector<sockaddr_storage>& addrs,
+                     int                            expire_sec)
 {
-    bool exist = false;
-    {
-        auto it = dns_map_.find(host);
-        if (it != dns_map_.end()) {
-            item  = it->second;
-            exist = true;
+    bool     need_refresh   = false;
+    uint32_t system_ttl_sec = 0;
+    switch (lookup(host, addrs, need_refresh, system_ttl_sec)) {
+    case DNS_CACHE_HIT:
+        return true;
+    case DNS_CACHE_STALE:
+        // 同步接口不依赖poller，都用getaddrinfo刷新
+        if (need_refresh) {
+            refresh_system(host, system_ttl_sec ? system_ttl_sec : expire_sec);
         }
+        return true;
+    case DNS_CACHE_NEGATIVE:
+        return false;
+    default:
+        break;
     }
 
-    if (exist && item.create_time + expire_sec < get_current_seconds()) {
-        // timeout
-        dns_map_.erase(host);
+    // 本地缓存中没找到，到系统缓存去找
+    bool not_found = false;
+    if (!get_system_domain_ip(host, addrs, not_found)) {
+        if (not_found) {
+            update(host, addrs, negative_ttl_sec_);
+        }
         return false;
     }
 
-    return exist;
+    update(host, addrs, expire_sec, true);
+    return true;
+}
+
+void DNSCache::ParseAsync(const std::string&       host,
+                          const EventPoller::Ptr&  poller,
+                          DNSResolver::ResolveCB&& cb)
+{
+    std::vector<sockaddr_storage> addrs;
+    bool                          need_refresh   = false;
+    uint32_t                      system_ttl_sec = 0;
+
+    switch (lookup(host, addrs, need_refresh, system_ttl_sec)) {
+    case DNS_CACHE_STALE:
+        if (need_refresh && system_ttl_sec) {
+            refresh_system(host, system_ttl_sec);
+        }
+        else if (need_refresh) {
+            refresh(host, poller);
+        }
+        // fall through
+    case DNS_CACHE_HIT:
+        poller->Post([cb, addrs]() { cb(SocketException(), addrs, 0); });
+        return;
+    case DNS_CACHE_NEGATIVE:
+        poller->Post([cb, host]() {
+            cb(SocketException(ERR_OTHER, "host not found(cached): " + host),
+               std::vector<sockaddr_storage>(), 0);
+        });
+        return;
+    default:
+        break;
+    }
+
+    DNSResolver::Get(poller)->Resolve(
+        host, [this, host, cb](const SocketException&               err,
+                               const std::vector<sockaddr_storage>& addrs,
+                               uint32_t                             ttl_sec) {
+            on_resolved(host, err, addrs, ttl_sec);
+            cb(err, addrs, ttl_sec);
+        });
+}
+
+void DNSCache::SetMaxSize(size_t size)
+{
+    max_size_ = std::max<size_t>(size, DNS_CACHE_SHARDS);
+}
+
+void DNSCache::SetNegativeTTL(uint32_t sec)
+{
+    negative_ttl_sec_ = sec;
+}
+
+void DNSCache::SetStaleTTL(uint32_t sec)
+{
+    stale_ttl_sec_ = sec;
+}
+
+size_t DNSCache::Size()
+{
+    size_t size = 0;
+    for (Shard& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard.mux);
+        size += shard.items.size();
+    }
+    return size;
+}
+
+void DNSCache::Clear()
+{
+    for (Shard& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard.mux);
+        shard.items.clear();
+        shard.lru.clear();
+    }
+}
+
+DNSCache::LookupResult DNSCache::lookup(const std::string&             host,
+                                        std::vector<sockaddr_storage>& addrs,
+                                        bool&     need_refresh,
+                                        uint32_t& system_ttl_sec)
+{
+    Shard&                      shard = get_shard(host);
+    std::lock_guard<std::mutex> lock(shard.mux);
+
+    auto it = shard.items.find(host);
+    if (it == shard.items.end()) {
+        return DNS_CACHE_MISS;
+    }
+
+    DNSItem& item = *it->second;
+    uint64_t now  = get_steady_milliseconds();
+    if (item.addrs.empty()) {
+        if (now < item.expire_ms) {
+            return DNS_CACHE_NEGATIVE;
+        }
+        shard.lru.erase(it->second);
+        shard.items.erase(it);
+        return DNS_CACHE_MISS;
+    }
+
+    if (now >= item.expire_ms + uint64_t(stale_ttl_sec_) * 1000) {
+        // 超出可使用旧结果的时间
+        shard.lru.erase(it->second);
+        shard.items.erase(it);
+        return DNS_CACHE_MISS;
+    }
+
+    // 移到LRU头部
+    shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+    addrs = item.addrs;
+
+    if (now < item.expire_ms) {
+        return DNS_CACHE_HIT;
+    }
+
+    // 同一域名同时只有一个后台刷新
+    need_refresh    = !item.refreshing;
+    item.refreshing = true;
+    system_ttl_sec  = item.system_ttl_sec;
+    return DNS_CACHE_STALE;
 }
 
-bool DNSCache::get_system_domain_ip(const char* host, DNSItem& item)
+void DNSCache::update(const std::string&                   host,
+                      const std::vector<sockaddr_storage>& addrs,
+                      uint32_t                             ttl_sec,
+                      bool                                 from_system)
 {
+    Shard&                      shard = get_shard(host);
+    std::lock_guard<std::mutex> lock(shard.mux);
+
+    auto it = shard.items.find(host);
+    if (it != shard.items.end()) {
+        if (ttl_sec == 0 || (addrs.empty() && !it->second->addrs.empty())) {
+            // 刷新失败时继续使用旧结果，直到超出可使用旧结果的时间
+            it->second->refreshing = false;
+            return;
+        }
+        shard.lru.erase(it->second);
+        shard.items.erase(it);
+    }
+    else if (ttl_sec == 0) {
+        return;
+    }
+
+    DNSItem item;
+    item.host           = host;
+    item.addrs          = addrs;
+    item.expire_ms      = get_steady_milliseconds() + uint64_t(ttl_sec) * 1000;
+    item.system_ttl_sec = from_system ? ttl_sec : 0;
+    shard.lru.emplace_front(std::move(item));
+    shard.items[host] = shard.lru.begin();
+
+    size_t limit = std::max<size_t>(max_size_ / DNS_CACHE_SHARDS, 1);
+    while (shard.items.size() > limit) {
+        shard.items.erase(shard.lru.back().host);
+        shard.lru.pop_back();
+    }
+}
+
+void DNSCache::on_resolved(const std::string&                   host,
+                           const SocketException&               err,
+                           const std::vector<sockaddr_storage>& addrs,
+                           uint32_t                             ttl_sec)
+{
+    if (!err) {
+        update(host, addrs, ttl_sec);
+        return;
+    }
+
+    // 超时等临时错误不做负缓存
+    update(host, addrs,
+           err.GetErrCode() == ERR_TIMEOUT ? 0 : negative_ttl_sec_.load());
+}
+
+void DNSCache::refresh(const std::string& host, const EventPoller::Ptr& poller)
+{
+    DNSResolver::Get(poller)->Resolve(
+        host, [this, host](const SocketException&               err,
+                           const std::vector<sockaddr_storage>& addrs,
+                           uint32_t ttl_sec) {
+            if (err) {
+                LOG_W << "refresh dns failed. host=" << host << ", "
+                      << err.what();
+            }
+            on_resolved(host, err, addrs, ttl_sec);
+        });
+}
+
+void DNSCache::refresh_system(const std::string& host, uint32_t ttl_sec)
+{
+    WorkThreadPool::Ptr pool;
+    {
+        std::lock_guard<std::mutex> lock(refresh_mux_);
+        if (!refresh_pool_) {
+            refresh_pool_ = std::make_shared<WorkThreadPool>(
+                1, TPRIORITY_NORMAL, false, "dns refresh");
+        }
+        pool = refresh_pool_;
+    }
+
+    pool->Post([this, host, ttl_sec]() {
+        std::vector<sockaddr_storage> addrs;
+        bool                          not_found = false;
+        if (!get_system_domain_ip(host.data(), addrs, not_found)) {
+            // 刷新失败时继续使用旧结果，只清除刷新标记
+            addrs.clear();
+            update(host, addrs, 0);
+            return;
+        }
+        update(host, addrs, ttl_sec, true);
+    });
+}
+
+bool DNSCache::get_system_domain_ip(const char*                    host,
+                                    std::vector<sockaddr_storage>& addrs,
+                                    bool&                          not_found)
+{
+    addrinfo  hints;
     addrinfo* answer = nullptr;
+    bzero(&hints, sizeof(hints));
+    hints.ai_socktype = SOCK_STREAM;
 
     int ret = -1;
     do {
-        ret = getaddrinfo(host, nullptr, nullptr, &answer);
+        ret = getaddrinfo(host, nullptr, &hints, &answer);
     } while (ret != 0 && get_uv_error() == EINTR);
 
     if (ret != 0 || !answer) {
         LOG_W << "dns failed. host=" << host;
+        not_found = (ret == EAI_NONAME);
         return false;
     }
 
-    item.addr        = *(reinterpret_cast<sockaddr_storage*>(answer->ai_addr));
-    item.create_time = get_current_seconds();
-    {
-        dns_map_[host] = item;
+    // IPv4在前，与DNSResolver的结果顺序一致
+    std::vector<sockaddr_storage> addrs_v6;
+    for (addrinfo* cur = answer; cur; cur = cur->ai_next) {
+        sockaddr_storage addr;
+        bzero(&addr, sizeof(addr));
+        memcpy(&addr, cur->ai_addr, cur->ai_addrlen);
+        if (addr.ss_family == AF_INET) {
+            addrs.emplace_back(addr);
+        }
+        else if (addr.ss_family == AF_INET6) {
+            addrs_v6.emplace_back(addr);
+        }
     }
+    addrs.insert(addrs.end(), addrs_v6.begin(), addrs_v6.end());
 
     freeaddrinfo(answer);
 
-    return true;
+    return !addrs.empty();
+}
+
+DNSCache::Shard& DNSCache::get_shard(const std::string& host)
+{
+    return shards_[std::hash<std::string>()(host) % DNS_CACHE_SHARDS];
 }
 
-}  // namespace common_library
\ No newline at end of file
+}  // namespace common_library
@@ -1,38 +1,141 @@
 #ifndef COMMON_LIBRARY_DNS_CACHE_H
 #define COMMON_LIBRARY_DNS_CACHE_H
 
+#include <net/dns_resolver.h>
+#include <thread/work_thread_pool.h>
+
+#include <atomic>
+#include <list>
+#include <mutex>
+#include <string>
 #include <unordered_map>
+#include <vector>
+
+#include <stdint.h>
 
 #include <sys/socket.h>
 
+#define DNS_CACHE_SHARDS 16
+
 namespace common_library {
 
+/**
+ * 线程安全的域名缓存，按域名哈希分片加锁，每个分片按LRU淘汰
+ * 保存解析出的全部地址(IPv4在前)，解析失败的结果也会缓存一段时间
+ * 过期后的stale_sec秒内仍返回旧结果，同时在后台刷新，调用者不会因刷新而阻塞
+ * getaddrinfo得到的结果在工作线程中用getaddrinfo刷新，保留nsswitch和search配置
+ */
 class DNSCache final {
   public:
     static DNSCache& Instance();
 
     ~DNSCache() = default;
 
+    /**
+     * 同步解析，返回第一个地址，未命中时调用getaddrinfo
+     * expire_sec为getaddrinfo结果的缓存时间
+     */
     bool Parse(const char* host, sockaddr_storage& addr, int expire_sec = 60);
 
+    bool Parse(const char*                    host,
+               std::vector<sockaddr_storage>& addrs,
+               int                            expire_sec = 60);
+
+    /**
+     * 异步解析，未命中时使用poller上的DNSResolver
+     * cb总是在poller线程中回调，不会在ParseAsync内回调
+     */
+    void ParseAsync(const std::string&       host,
+                    const EventPoller::Ptr&  poller,
+                    DNSResolver::ResolveCB&& cb);
+
+    /**
+     * 缓存的最大域名数，超出时淘汰最久未使用的
+     */
+    void SetMaxSize(size_t size);
+
+    /**
+     * 解析失败结果的缓存时间，0表示不缓存
+     */
+    void SetNegativeTTL(uint32_t sec);
+
+    /**
+     * 过期后仍可返回旧结果的时间，0表示过期后必须重新解析
+     */
+    void SetStaleTTL(uint32_t sec);
+
+    size_t Size();
+
+    void Clear();
+
   private:
+    typedef enum {
+        DNS_CACHE_MISS,
+        DNS_CACHE_HIT,
+        // 已过期但仍可使用
+        DNS_CACHE_STALE,
+        // 缓存的解析失败结果
+        DNS_CACHE_NEGATIVE
+    } LookupResult;
+
     struct DNSItem
     {
-        sockaddr_storage addr;
-        // unix seconds
-        uint64_t create_time;
+        std::string host;
+        // 为空表示解析失败
+        std::vector<sockaddr_storage> addrs;
+        // 单调时钟毫秒
+        uint64_t expire_ms;
+        // 是否已有后台刷新在进行
+        bool refreshing = false;
+        // getaddrinfo结果的缓存时间，0表示结果来自DNSResolver
+        uint32_t system_ttl_sec = 0;
     };
 
-    DNSCache();
+    struct Shard
+    {
+        std::mutex         mux;
+        std::list<DNSItem> lru;
+        std::unordered_map<std::string, std::list<DNSItem>::iterator> items;
+    };
+
+    DNSCache() = default;
+
+    LookupResult lookup(const std::string&             host,
+                        std::vector<sockaddr_storage>& addrs,
+                        bool&                          need_refresh,
+                        uint32_t&                      system_ttl_sec);
 
-    bool get_cache_domain_ip(const char* host, DNSItem& item, int expire_sec);
+    void update(const std::string&                   host,
+                const std::vector<sockaddr_storage>& addrs,
+                uint32_t                             ttl_sec,
+                bool                                 from_system = false);
 
-    bool get_system_domain_ip(const char* host, DNSItem& item);
+    void on_resolved(const std::string&                   host,
+                     const SocketException&               err,
+                     const std::vector<sockaddr_storage>& addrs,
+                     uint32_t                             ttl_sec);
+
+    void refresh(const std::string& host, const EventPoller::Ptr& poller);
+
+    void refresh_system(const std::string& host, uint32_t ttl_sec);
+
+    bool get_system_domain_ip(const char*                    host,
+                              std::vector<sockaddr_storage>& addrs,
+                              bool&                          not_found);
+
+    Shard& get_shard(const std::string& host);
 
   private:
-    std::unordered_map<std::string, DNSItem> dns_map_;
+    Shard                 shards_[DNS_CACHE_SHARDS];
+    std::atomic<size_t>   max_size_{10000};
+    std::atomic<uint32_t> negative_ttl_sec_{5};
+    std::atomic<uint32_t> stale_ttl_sec_{300};
+
+    // 执行getaddrinfo刷新，第一次使用时创建，最后析构以便执行完剩余任务
+    std::mutex          refresh_mux_;
+    WorkThreadPool::Ptr refresh_pool_;
 };
 
 }  // namespace common_library
 
-#endif
\ No newline at end of file
+#endif
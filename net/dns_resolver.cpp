@@ -0,0 +1,696 @@
+#include <net/dns_resolver.h>
+#include <utils/logger.h>
+#include <utils/uv_error.h>
+
+#include <arpa/inet.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+
+#define DNS_HEADER_SIZE 12
+#define DNS_MAX_PACKET_SIZE 4096
+#define DNS_TYPE_A 1
+#define DNS_TYPE_AAAA 28
+#define DNS_CLASS_IN 1
+#define DNS_FLAG_QR 0x8000
+#define DNS_FLAG_TC 0x0200
+#define DNS_FLAG_RD 0x0100
+#define DNS_RCODE_NXDOMAIN 3
+
+namespace common_library {
+
+typedef std::unordered_map<std::string, std::vector<sockaddr_storage>> HostMap;
+
+static uint16_t read_u16(const uint8_t* p)
+{
+    return (uint16_t(p[0]) << 8) | p[1];
+}
+
+static uint32_t read_u32(const uint8_t* p)
+{
+    return (uint32_t(read_u16(p)) << 16) | read_u16(p + 2);
+}
+
+static void append_u16(std::string& out, uint16_t value)
+{
+    out.push_back(char(value >> 8));
+    out.push_back(char(value & 0xFF));
+}
+
+static std::string normalize_host(const std::string& host)
+{
+    std::string name = host;
+    if (!name.empty() && name.back() == '.') {
+        name.pop_back();
+    }
+    std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+    return name;
+}
+
+static bool parse_ip(std::string ip, uint16_t port, sockaddr_storage& addr)
+{
+    if (ip.size() > 2 && ip.front() == '[' && ip.back() == ']') {
+        ip = ip.substr(1, ip.size() - 2);
+    }
+
+    bzero(&addr, sizeof(addr));
+    sockaddr_in*  addr4 = reinterpret_cast<sockaddr_in*>(&addr);
+    sockaddr_in6* addr6 = reinterpret_cast<sockaddr_in6*>(&addr);
+    if (inet_pton(AF_INET, ip.c_str(), &addr4->sin_addr) == 1) {
+        addr4->sin_family = AF_INET;
+        addr4->sin_port   = htons(port);
+        return true;
+    }
+    if (inet_pton(AF_INET6, ip.c_str(), &addr6->sin6_addr) == 1) {
+        addr6->sin6_family = AF_INET6;
+        addr6->sin6_port   = htons(port);
+        return true;
+    }
+    return false;
+}
+
+static bool parse_server(const std::string& server, sockaddr_storage& addr)
+{
+    std::string ip   = server;
+    uint16_t    port = 53;
+
+    size_t pos = server.rfind(':');
+    if (!server.empty() && server.front() == '[') {
+        // [ipv6]:port
+        size_t end = server.find(']');
+        if (end == std::string::npos) {
+            return false;
+        }
+        ip = server.substr(1, end - 1);
+        if (end + 1 < server.size() && server[end + 1] == ':') {
+            port = atoi(server.c_str() + end + 2);
+        }
+    }
+    else if (pos != std::string::npos && server.find(':') == pos) {
+        // ipv4:port
+        ip   = server.substr(0, pos);
+        port = atoi(server.c_str() + pos + 1);
+    }
+
+    return parse_ip(ip, port, addr);
+}
+
+static bool same_addr(const sockaddr_storage& a, const sockaddr_storage& b)
+{
+    if (a.ss_family != b.ss_family) {
+        return false;
+    }
+    if (a.ss_family == AF_INET) {
+        const sockaddr_in* a4 = reinterpret_cast<const sockaddr_in*>(&a);
+        const sockaddr_in* b4 = reinterpret_cast<const sockaddr_in*>(&b);
+        return a4->sin_port == b4->sin_port &&
+               a4->sin_addr.s_addr == b4->sin_addr.s_addr;
+    }
+    const sockaddr_in6* a6 = reinterpret_cast<const sockaddr_in6*>(&a);
+    const sockaddr_in6* b6 = reinterpret_cast<const sockaddr_in6*>(&b);
+    return a6->sin6_port == b6->sin6_port &&
+           memcmp(&a6->sin6_addr, &b6->sin6_addr, sizeof(in6_addr)) == 0;
+}
+
+static bool encode_query(uint16_t           id,
+                         uint16_t           type,
+                         const std::string& host,
+                         std::string&       out)
+{
+    out.clear();
+    append_u16(out, id);
+    append_u16(out, DNS_FLAG_RD);
+    append_u16(out, 1);
+    append_u16(out, 0);
+    append_u16(out, 0);
+    append_u16(out, 0);
+
+    // 域名按"."拆分为长度前缀的label
+    size_t begin = 0;
+    while (begin < host.size()) {
+        size_t end = host.find('.', begin);
+        if (end == std::string::npos) {
+            end = host.size();
+        }
+        size_t label = end - begin;
+        if (label == 0 || label > 63) {
+            return false;
+        }
+        out.push_back(char(label));
+        out.append(host, begin, label);
+        begin = end + 1;
+    }
+    out.push_back(0);
+
+    if (out.size() - DNS_HEADER_SIZE > 255) {
+        return false;
+    }
+
+    append_u16(out, type);
+    append_u16(out, DNS_CLASS_IN);
+    return true;
+}
+
+// 应答问题区的域名与查询包中的一致，忽略大小写
+// 问题区是报文中的第一个域名，不会被压缩
+static bool match_question(const uint8_t*     data,
+                           size_t             len,
+                           size_t&            pos,
+                           const std::string& packet)
+{
+    // 查询包的问题区为 域名 + type + class
+    size_t name_len = packet.size() - DNS_HEADER_SIZE - 4;
+    if (pos + name_len > len) {
+        return false;
+    }
+    for (size_t i = 0; i < name_len; i++) {
+        if (::tolower(data[pos + i]) !=
+            ::tolower(uint8_t(packet[DNS_HEADER_SIZE + i]))) {
+            return false;
+        }
+    }
+    pos += name_len;
+    return true;
+}
+
+// 跳过一个(可能被压缩的)域名
+static bool skip_name(const uint8_t* data, size_t len, size_t& pos)
+{
+    while (pos < len) {
+        uint8_t label = data[pos];
+        if (label == 0) {
+            pos += 1;
+            return true;
+        }
+        if ((label & 0xC0) == 0xC0) {
+            pos += 2;
+            return pos <= len;
+        }
+        pos += label + 1;
+    }
+    return false;
+}
+
+static void load_resolv_conf(const char*                    path,
+                             std::vector<sockaddr_storage>& servers,
+                             uint32_t&                      timeout_ms,
+                             uint32_t&                      attempts)
+{
+    std::ifstream file(path);
+    std::string   line;
+
+    while (std::getline(file, line)) {
+        std::istringstream iss(line);
+        std::string        key;
+        iss >> key;
+
+        if (key == "nameserver") {
+            std::string      ip;
+            sockaddr_storage addr;
+            iss >> ip;
+            if (parse_ip(ip, 53, addr)) {
+                servers.emplace_back(addr);
+            }
+        }
+        else if (key == "options") {
+            std::string option;
+            while (iss >> option) {
+                if (option.compare(0, 8, "timeout:") == 0) {
+                    timeout_ms = std::max(atoi(option.c_str() + 8), 1) * 1000;
+                }
+                else if (option.compare(0, 9, "attempts:") == 0) {
+                    attempts = std::max(atoi(option.c_str() + 9), 1);
+                }
+            }
+        }
+    }
+
+    if (servers.empty()) {
+        // 与glibc一致，没有配置时使用本机
+        sockaddr_storage addr;
+        parse_ip("127.0.0.1", 53, addr);
+        servers.emplace_back(addr);
+    }
+}
+
+static void load_hosts(const char* path, HostMap& hosts)
+{
+    std::ifstream file(path);
+    std::string   line;
+
+    while (std::getline(file, line)) {
+        size_t comment = line.find('#');
+        if (comment != std::string::npos) {
+            line.resize(comment);
+        }
+
+        std::istringstream iss(line);
+        std::string        ip;
+        std::string        name;
+        sockaddr_storage   addr;
+        if (!(iss >> ip) || !parse_ip(ip, 0, addr)) {
+            continue;
+        }
+        while (iss >> name) {
+            hosts[normalize_host(name)].emplace_back(addr);
+        }
+    }
+}
+
+// 进程内只读取一次的系统配置
+struct SystemConfig
+{
+    std::vector<sockaddr_storage> servers;
+    uint32_t                      timeout_ms = 5000;
+    uint32_t                      attempts   = 2;
+    std::shared_ptr<HostMap>      hosts;
+};
+
+static const SystemConfig& get_system_config()
+{
+    static SystemConfig s_config = []() {
+        SystemConfig config;
+        config.hosts = std::make_shared<HostMap>();
+        load_resolv_conf("/etc/resolv.conf", config.servers, config.timeout_ms,
+                         config.attempts);
+        load_hosts("/etc/hosts", *config.hosts);
+        return config;
+    }();
+    return s_config;
+}
+
+DNSResolver::Ptr DNSResolver::Create(const EventPoller::Ptr& poller)
+{
+    return std::make_shared<DNSResolver>(poller);
+}
+
+DNSResolver::Ptr DNSResolver::Get(const EventPoller::Ptr& poller)
+{
+    static std::mutex s_mux;
+    static std::unordered_map<EventPoller*, std::weak_ptr<DNSResolver>> s_map;
+
+    std::lock_guard<std::mutex> lock(s_mux);
+    DNSResolver::Ptr            resolver = s_map[poller.get()].lock();
+    if (!resolver) {
+        for (auto it = s_map.begin(); it != s_map.end();) {
+            it = it->second.expired() ? s_map.erase(it) : std::next(it);
+        }
+        resolver            = Create(poller);
+        s_map[poller.get()] = resolver;
+    }
+    return resolver;
+}
+
+DNSResolver::DNSResolver(const EventPoller::Ptr& poller)
+{
+    poller_ = poller;
+
+    const SystemConfig& config = get_system_config();
+    servers_    = config.servers;
+    timeout_ms_ = config.timeout_ms;
+    attempts_   = config.attempts;
+    hosts_      = config.hosts;
+}
+
+DNSResolver::~DNSResolver()
+{
+    for (auto& it : queries_) {
+        if (it.second->timer) {
+            it.second->timer->Cancel();
+        }
+        close_socket(it.second);
+    }
+}
+
+void DNSResolver::Resolve(const std::string& host, ResolveCB&& cb, int family)
+{
+    DNSResolver::Ptr self = shared_from_this();
+    // 总是投递到下一轮执行，避免在调用者的栈上回调
+    poller_->Post([self, host, cb, family]() mutable {
+        self->resolve(host, cb, family);
+    });
+}
+
+void DNSResolver::SetNameServers(const std::vector<std::string>& servers)
+{
+    std::vector<sockaddr_storage> addrs;
+    for (const std::string& server : servers) {
+        sockaddr_storage addr;
+        if (parse_server(server, addr)) {
+            addrs.emplace_back(addr);
+        }
+        else {
+            LOG_W << "invalid nameserver: " << server;
+        }
+    }
+
+    DNSResolver::Ptr self = shared_from_this();
+    poller_->Post([self, addrs]() { self->servers_ = addrs; });
+}
+
+void DNSResolver::SetTimeout(uint32_t timeout_ms, uint32_t attempts)
+{
+    DNSResolver::Ptr self = shared_from_this();
+    poller_->Post([self, timeout_ms, attempts]() {
+        self->timeout_ms_ = std::max<uint32_t>(timeout_ms, 1);
+        self->attempts_   = std::max<uint32_t>(attempts, 1);
+    });
+}
+
+void DNSResolver::resolve(const std::string& host, ResolveCB& cb, int family)
+{
+    if (resolve_local(host, cb, family)) {
+        return;
+    }
+
+    std::shared_ptr<Request> request = std::make_shared<Request>();
+    request->owner                   = shared_from_this();
+    request->host                    = normalize_host(host);
+    request->cb                      = std::move(cb);
+
+    if (servers_.empty()) {
+        request->err     = ERR_OTHER;
+        request->err_msg = "no nameserver configured";
+        finish_request(request);
+        return;
+    }
+
+    bool query_a    = (family != AF_INET6);
+    bool query_aaaa = (family != AF_INET);
+
+    // 先计数再发送，避免第一个查询同步失败时提前结束整个请求
+    request->pending = int(query_a) + int(query_aaaa);
+    if (query_a) {
+        start_query(request, DNS_TYPE_A);
+    }
+    if (query_aaaa) {
+        start_query(request, DNS_TYPE_AAAA);
+    }
+}
+
+bool DNSResolver::resolve_local(const std::string& host,
+                                ResolveCB&         cb,
+                                int                family)
+{
+    std::vector<sockaddr_storage> addrs;
+    sockaddr_storage              addr;
+
+    if (parse_ip(host, 0, addr)) {
+        addrs.emplace_back(addr);
+    }
+    else {
+        auto it = hosts_->find(normalize_host(host));
+        if (it == hosts_->end()) {
+            return false;
+        }
+        for (const sockaddr_storage& item : it->second) {
+            if (family == AF_UNSPEC || family == item.ss_family) {
+                addrs.emplace_back(item);
+            }
+        }
+        if (addrs.empty()) {
+            return false;
+        }
+    }
+
+    cb(SocketException(), addrs, 0);
+    return true;
+}
+
+void DNSResolver::start_query(const std::shared_ptr<Request>& request,
+                              uint16_t                        type)
+{
+    std::shared_ptr<Query> query = std::make_shared<Query>();
+    query->request               = request;
+    query->type                  = type;
+
+    // 随机选取未使用的id
+    do {
+        query->id = uint16_t(random_());
+    } while (queries_.count(query->id));
+
+    if (!encode_query(query->id, type, request->host, query->packet)) {
+        finish_query(query, ERR_OTHER, "invalid host name");
+        return;
+    }
+
+    queries_[query->id] = query;
+    send_query(query);
+}
+
+void DNSResolver::send_query(const std::shared_ptr<Query>& query)
+{
+    const sockaddr_storage& server =
+        servers_[query->server_index % servers_.size()];
+    ++query->tries;
+
+    // 每次发送更换socket，源端口由内核随机分配
+    close_socket(query);
+    int     fd  = open_socket(server.ss_family);
+    ssize_t ret = -1;
+    query->fd   = fd;
+    if (fd != -1) {
+        socklen_t len = server.ss_family == AF_INET6 ? sizeof(sockaddr_in6) :
+                                                       sizeof(sockaddr_in);
+        do {
+            ret = ::sendto(fd, query->packet.data(), query->packet.size(), 0,
+                           reinterpret_cast<const sockaddr*>(&server), len);
+        } while (ret == -1 && get_uv_error() == EINTR);
+    }
+
+    if (ret == -1) {
+        retry_query(query, ERR_OTHER,
+                    StringPrinter << "send dns query failed. "
+                                  << get_uv_errmsg());
+        return;
+    }
+
+    std::weak_ptr<DNSResolver> weak_self  = shared_from_this();
+    std::weak_ptr<Query>       weak_query = query;
+    query->timer = poller_->DoDelayTask(timeout_ms_, [weak_self, weak_query]() {
+        auto strong_self  = weak_self.lock();
+        auto strong_query = weak_query.lock();
+        if (strong_self && strong_query) {
+            strong_self->retry_query(strong_query, ERR_TIMEOUT,
+                                     "dns query timeout");
+        }
+        return 0;
+    });
+}
+
+void DNSResolver::retry_query(const std::shared_ptr<Query>& query,
+                              SockErrCode                   err,
+                              const std::string&            err_msg)
+{
+    if (query->timer) {
+        query->timer->Cancel();
+        query->timer = nullptr;
+    }
+
+    if (query->tries >= attempts_ * servers_.size()) {
+        finish_query(query, err, err_msg);
+        return;
+    }
+
+    // 轮换到下一个nameserver
+    ++query->server_index;
+    send_query(query);
+}
+
+void DNSResolver::finish_query(const std::shared_ptr<Query>& query,
+                               SockErrCode                   err,
+                               const std::string&            err_msg)
+{
+    if (query->timer) {
+        query->timer->Cancel();
+        query->timer = nullptr;
+    }
+    queries_.erase(query->id);
+    close_socket(query);
+
+    std::shared_ptr<Request> request = query->request;
+    if (err != ERR_SUCCESS && request->err == ERR_SUCCESS) {
+        request->err     = err;
+        request->err_msg = err_msg;
+    }
+
+    if (--request->pending == 0) {
+        finish_request(request);
+    }
+}
+
+void DNSResolver::finish_request(const std::shared_ptr<Request>& request)
+{
+    std::vector<sockaddr_storage> addrs;
+    addrs.swap(request->addrs_v4);
+    addrs.insert(addrs.end(), request->addrs_v6.begin(),
+                 request->addrs_v6.end());
+
+    SocketException err;
+    if (addrs.empty()) {
+        if (request->err == ERR_SUCCESS) {
+            err.Reset(ERR_OTHER, "host not found: " + request->host);
+        }
+        else {
+            err.Reset(request->err, request->err_msg + ": " + request->host);
+        }
+    }
+
+    ResolveCB cb = std::move(request->cb);
+    // 调用者在栈上持有解析器，这里释放不会立即析构
+    request->owner = nullptr;
+    cb(err, addrs, addrs.empty() ? 0 : request->ttl_sec);
+}
+
+void DNSResolver::on_read(int fd)
+{
+    uint8_t          buf[DNS_MAX_PACKET_SIZE];
+    sockaddr_storage from;
+
+    for (;;) {
+        socklen_t len = sizeof(from);
+        ssize_t   ret = ::recvfrom(fd, buf, sizeof(buf), 0,
+                                   reinterpret_cast<sockaddr*>(&from), &len);
+        if (ret == -1) {
+            if (get_uv_error() == EINTR) {
+                continue;
+            }
+            break;
+        }
+        on_response(fd, buf, ret, from);
+    }
+}
+
+void DNSResolver::on_response(int                     fd,
+                              const uint8_t*          data,
+                              size_t                  len,
+                              const sockaddr_storage& from)
+{
+    if (len < DNS_HEADER_SIZE) {
+        return;
+    }
+
+    uint16_t id      = read_u16(data);
+    uint16_t flags   = read_u16(data + 2);
+    uint16_t qdcount = read_u16(data + 4);
+    uint16_t ancount = read_u16(data + 6);
+
+    auto it = queries_.find(id);
+    if (it == queries_.end() || it->second->fd != fd ||
+        !(flags & DNS_FLAG_QR) || qdcount != 1 || !is_server(from)) {
+        // 过期或者伪造的应答
+        return;
+    }
+    std::shared_ptr<Query> query = it->second;
+
+    size_t pos = DNS_HEADER_SIZE;
+    if (!match_question(data, len, pos, query->packet) || pos + 4 > len ||
+        read_u16(data + pos) != query->type ||
+        read_u16(data + pos + 2) != DNS_CLASS_IN) {
+        return;
+    }
+    pos += 4;
+
+    uint16_t rcode = flags & 0x0F;
+    if (rcode == DNS_RCODE_NXDOMAIN) {
+        finish_query(query, ERR_SUCCESS, "");
+        return;
+    }
+    if (rcode != 0) {
+        retry_query(query, ERR_OTHER,
+                    StringPrinter << "dns server error. rcode=" << rcode);
+        return;
+    }
+    if (flags & DNS_FLAG_TC) {
+        LOG_W << "dns response truncated. host=" << query->request->host;
+    }
+
+    std::shared_ptr<Request>& request = query->request;
+    for (uint16_t i = 0; i < ancount; i++) {
+        if (!skip_name(data, len, pos) || pos + 10 > len) {
+            break;
+        }
+        uint16_t type   = read_u16(data + pos);
+        uint16_t klass  = read_u16(data + pos + 2);
+        uint32_t ttl    = read_u32(data + pos + 4);
+        uint16_t rd_len = read_u16(data + pos + 8);
+        pos += 10;
+        if (pos + rd_len > len) {
+            break;
+        }
+
+        // CNAME等其他记录直接跳过，递归服务器会在同一应答中给出最终地址
+        if (type == query->type && klass == DNS_CLASS_IN) {
+            sockaddr_storage addr;
+            bzero(&addr, sizeof(addr));
+            if (type == DNS_TYPE_A && rd_len == 4) {
+                sockaddr_in* addr4 = reinterpret_cast<sockaddr_in*>(&addr);
+                addr4->sin_family  = AF_INET;
+                memcpy(&addr4->sin_addr, data + pos, 4);
+                request->addrs_v4.emplace_back(addr);
+                request->ttl_sec = std::min(request->ttl_sec, ttl);
+            }
+            else if (type == DNS_TYPE_AAAA && rd_len == 16) {
+                sockaddr_in6* addr6 = reinterpret_cast<sockaddr_in6*>(&addr);
+                addr6->sin6_family  = AF_INET6;
+                memcpy(&addr6->sin6_addr, data + pos, 16);
+                request->addrs_v6.emplace_back(addr);
+                request->ttl_sec = std::min(request->ttl_sec, ttl);
+            }
+        }
+        pos += rd_len;
+    }
+
+    finish_query(query, ERR_SUCCESS, "");
+}
+
+int DNSResolver::open_socket(int family)
+{
+    int fd = ::socket(family, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd == -1) {
+        LOG_E << "create dns socket failed. " << get_uv_errmsg();
+        return -1;
+    }
+
+    std::weak_ptr<DNSResolver> weak_self = shared_from_this();
+    int ret = poller_->AddEvent(fd, PE_READ, [weak_self, fd](int event) {
+        auto strong_self = weak_self.lock();
+        if (strong_self) {
+            strong_self->on_read(fd);
+        }
+    });
+    if (ret == -1) {
+        LOG_E << "add dns socket to poller failed. fd=" << fd;
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+void DNSResolver::close_socket(const std::shared_ptr<Query>& query)
+{
+    int fd = query->fd;
+    if (fd == -1) {
+        return;
+    }
+    query->fd = -1;
+    // 必须在epoll_ctl之后close fd
+    poller_->DelEvent(fd, [fd](bool) { ::close(fd); });
+}
+
+bool DNSResolver::is_server(const sockaddr_storage& addr)
+{
+    for (const sockaddr_storage& server : servers_) {
+        if (same_addr(server, addr)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+}  // namespace common_library
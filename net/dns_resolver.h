@@ -0,0 +1,158 @@
+#ifndef COMMON_LIBRARY_DNS_RESOLVER_H
+#define COMMON_LIBRARY_DNS_RESOLVER_H
+
+#include <net/socket.h>
+#include <poller/event_poller.h>
+#include <utils/noncopyable.h>
+
+#include <functional>
+#include <memory>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <stdint.h>
+#include <sys/socket.h>
+
+namespace common_library {
+
+/**
+ * 运行在poller线程中的异步DNS解析器，不使用getaddrinfo，不阻塞poller
+ * 直接通过UDP向resolv.conf中的nameserver发送A和AAAA查询，两者并行
+ * 每次查询超时后轮换下一个nameserver重试，优先查找/etc/hosts
+ * 每次发送使用新的socket(随机源端口)和随机id，应答必须来自该socket
+ * 且问题中的域名与查询一致，降低被伪造应答投毒的可能
+ * 系统配置在进程内第一次创建解析器时读取，之后的修改不会生效
+ * 所有状态只在poller线程中访问，回调也在该poller线程中执行
+ * 暂不支持search域和截断后的TCP重试
+ */
+class DNSResolver final : public std::enable_shared_from_this<DNSResolver>,
+                          public noncopyable {
+  public:
+    typedef std::shared_ptr<DNSResolver> Ptr;
+    /**
+     * addrs中IPv4在前，端口为0，ttl_sec为应答中最小的TTL
+     * 数字地址和hosts中的结果ttl_sec为0
+     */
+    typedef std::function<void(const SocketException&               err,
+                               const std::vector<sockaddr_storage>& addrs,
+                               uint32_t                             ttl_sec)>
+        ResolveCB;
+
+    /**
+     * 使用系统配置(/etc/resolv.conf, /etc/hosts)创建解析器
+     */
+    static DNSResolver::Ptr Create(const EventPoller::Ptr& poller);
+
+    /**
+     * 获取与poller绑定的共享解析器，没有时创建
+     */
+    static DNSResolver::Ptr Get(const EventPoller::Ptr& poller);
+
+    DNSResolver(const EventPoller::Ptr& poller);
+
+    ~DNSResolver();
+
+  public:
+    /**
+     * 可在任意线程调用，cb总是在之后的poller循环中回调，不会在Resolve内回调
+     * family为AF_INET/AF_INET6时只查询对应的记录
+     */
+    void Resolve(const std::string& host,
+                 ResolveCB&&        cb,
+                 int                family = AF_UNSPEC);
+
+    /**
+     * 替换nameserver列表，格式为"ip"、"ip:port"或"[ipv6]:port"
+     */
+    void SetNameServers(const std::vector<std::string>& servers);
+
+    /**
+     * 单次查询的超时时间以及每个nameserver的尝试次数
+     */
+    void SetTimeout(uint32_t timeout_ms, uint32_t attempts);
+
+    const EventPoller::Ptr& GetPoller() const
+    {
+        return poller_;
+    }
+
+  private:
+    typedef std::unordered_map<std::string, std::vector<sockaddr_storage>>
+        HostMap;
+
+    // 一次Resolve调用
+    struct Request
+    {
+        DNSResolver::Ptr              owner;
+        std::string                   host;
+        ResolveCB                     cb;
+        std::vector<sockaddr_storage> addrs_v4;
+        std::vector<sockaddr_storage> addrs_v6;
+        uint32_t                      ttl_sec = UINT32_MAX;
+        int                           pending = 0;
+        SockErrCode                   err     = ERR_SUCCESS;
+        std::string                   err_msg;
+    };
+
+    // 一次A或AAAA查询
+    struct Query
+    {
+        std::shared_ptr<Request> request;
+        uint16_t                 id;
+        uint16_t                 type;
+        std::string              packet;
+        uint32_t                 tries        = 0;
+        size_t                   server_index = 0;
+        DelayTask::Ptr           timer;
+        // 本次发送使用的socket，重试时更换
+        int fd = -1;
+    };
+
+    void resolve(const std::string& host, ResolveCB& cb, int family);
+
+    bool resolve_local(const std::string& host, ResolveCB& cb, int family);
+
+    void start_query(const std::shared_ptr<Request>& request, uint16_t type);
+
+    void send_query(const std::shared_ptr<Query>& query);
+
+    void retry_query(const std::shared_ptr<Query>& query,
+                     SockErrCode                   err,
+                     const std::string&            err_msg);
+
+    void finish_query(const std::shared_ptr<Query>& query,
+                      SockErrCode                   err,
+                      const std::string&            err_msg);
+
+    void finish_request(const std::shared_ptr<Request>& request);
+
+    void on_read(int fd);
+
+    void on_response(int                     fd,
+                     const uint8_t*          data,
+                     size_t                  len,
+                     const sockaddr_storage& from);
+
+    int open_socket(int family);
+
+    void close_socket(const std::shared_ptr<Query>& query);
+
+    bool is_server(const sockaddr_storage& addr);
+
+  private:
+    EventPoller::Ptr              poller_;
+    std::vector<sockaddr_storage> servers_;
+    uint32_t                      timeout_ms_ = 5000;
+    uint32_t                      attempts_   = 2;
+    // 查询id的随机来源，不使用可预测的计数器
+    std::random_device random_;
+    std::unordered_map<uint16_t, std::shared_ptr<Query>> queries_;
+    // 所有解析器共用，只在第一次创建解析器时读取
+    std::shared_ptr<const HostMap> hosts_;
+};
+
+}  // namespace common_library
+
+#endif
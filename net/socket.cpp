@@ -1,12 +1,20 @@
+#include <net/dns_cache.h>
 #include <net/socket.h>
 #include <net/socket_utils.h>
+#include <poller/event_poller_pool.h>
 #include <utils/logger.h>
 #include <utils/uv_error.h>
 
+#include <linux/errqueue.h>
+#include <fcntl.h>
+#include <netinet/in.h>
 #include <sys/socket.h>
+#include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
 
+#include <algorithm>
+
 #define CLOSE_SOCKET(fd)                                                       \
     {                                                                          \
         if (fd != -1) {                                                        \
@@ -14,8 +22,25 @@
         }                                                                      \
     }
 
+// 单个UDP_GRO cmsg需要的缓冲大小
+#define GRO_CTRL_SIZE CMSG_SPACE(sizeof(int))
+
 namespace common_library {
 
+// 取得UDP_GRO合并时的分段大小，没有合并时返回0
+static uint32_t get_gro_segment_size(struct msghdr& hdr)
+{
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&hdr);
+    for (; cmsg; cmsg = CMSG_NXTHDR(&hdr, cmsg)) {
+        if (cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO) {
+            int size;
+            memcpy(&size, CMSG_DATA(cmsg), sizeof(size));
+            return size > 0 ? size : 0;
+        }
+    }
+    return 0;
+}
+
 inline LogContextCapturer& Socket::socket_log(const LogContextCapturer& logger,
                                               Socket*                   ptr)
 {
@@ -44,10 +69,11 @@ Socket::Ptr Socket::Create(const EventPoller::Ptr& poller)
 
 Socket::Socket(const EventPoller::Ptr& poller)
 {
-    poller_ = poller;
+    poller_ = poller ? poller : EventPollerPool::Instance().GetPoller();
     SetOnError(nullptr);
     SetOnFlushed(nullptr);
     SetOnRead(nullptr);
+    SetOnBeforeAccept(nullptr);
 }
 
 Socket::~Socket()
@@ -136,25 +162,36 @@ int Socket::Connect(const std::string& host,
     std::weak_ptr<std::function<void(int)>> weak_async_connect_cb =
         async_connect_cb;
 
-    auto poller = poller_;
-
-    // 支持单线程，不使用WorkerPool
-    poller_->Async([host, port, local_ip_or_intf, local_port,
-                    weak_async_connect_cb, poller] {
-        int fd = SocketUtils::Connect(
-            host.c_str(), port, local_ip_or_intf.c_str(), local_port, true);
-        poller->Async([weak_async_connect_cb, fd]() {
+    // 优先使用缓存，未命中时异步解析，结果在poller_线程中回调
+    DNSCache::Instance().ParseAsync(
+        host, poller_,
+        [host, port, local_ip_or_intf, local_port, weak_async_connect_cb,
+         connect_cb](const SocketException&               err,
+                     const std::vector<sockaddr_storage>& addrs, uint32_t) {
             auto strong_async_connect_cb = weak_async_connect_cb.lock();
-            if (strong_async_connect_cb) {
-                (*strong_async_connect_cb)(fd);
+            if (!strong_async_connect_cb) {
+                LOG_D << "socket instance has been destroyed. just return "
+                         "####1";
+                return;
             }
-            else {
-                LOG_D << "socket instance has been destroyed. just close "
-                         "fd and return ####1";
-                CLOSE_SOCKET(fd);
+
+            if (err) {
+                LOG_W << "dns failed. host=" << host << ", " << err.what();
+                connect_cb(err);
+                return;
+            }
+
+            // 依次尝试解析出的地址，直到有一个可以发起连接
+            int fd = -1;
+            for (const sockaddr_storage& addr : addrs) {
+                fd = SocketUtils::Connect(addr, port, local_ip_or_intf.c_str(),
+                                          local_port, true);
+                if (fd != -1) {
+                    break;
+                }
             }
+            (*strong_async_connect_cb)(fd);
         });
-    });
 
     return 0;
 }
@@ -180,6 +217,18 @@ void Socket::Close()
     connect_timer_    = nullptr;
     async_connect_cb_ = nullptr;
     sockfd_           = nullptr;
+
+    cancel_wait_send_source();
+
+    if (!zerocopy_pending_.empty()) {
+        // fd关闭后收不到完成通知，内核可能仍在发送这些数据，延迟释放
+        auto pending = std::make_shared<std::deque<ZeroCopyPending>>();
+        pending->swap(zerocopy_pending_);
+        poller_->DoDelayTask(SOCKET_ZEROCOPY_LINGER_MS, [pending]() {
+            return 0;
+        });
+        zerocopy_stats_.pending_bytes = 0;
+    }
 }
 
 void Socket::SetOnError(ErrorCB&& cb)
@@ -212,6 +261,11 @@ void Socket::SetOnRead(ReadCB&& cb)
     }
 }
 
+void Socket::SetOnBatchRead(BatchReadCB&& cb)
+{
+    batch_read_cb_ = std::move(cb);
+}
+
 void Socket::SetOnAccept(AcceptCB&& cb)
 {
     if (cb) {
@@ -222,6 +276,16 @@ void Socket::SetOnAccept(AcceptCB&& cb)
     }
 }
 
+void Socket::SetOnBeforeAccept(BeforeAcceptCB&& cb)
+{
+    if (cb) {
+        before_accept_cb_ = std::move(cb);
+    }
+    else {
+        before_accept_cb_ = [this]() { return poller_; };
+    }
+}
+
 SocketFD::Ptr Socket::SetPeerSocket(int fd)
 {
     Close();
@@ -323,7 +387,9 @@ bool Socket::flush_data(const SocketFD::Ptr& sockfd)
                 }
             }
 
-            stop_writeable_event(sockfd);
+            if (sending_) {
+                stop_writeable_event(sockfd);
+            }
             on_flushed();
             return true;
 
@@ -336,8 +402,21 @@ bool Socket::flush_data(const SocketFD::Ptr& sockfd)
     while (!send_buf_sending_tmp.empty()) {
         BufferList::Ptr& pkt = send_buf_sending_tmp.front();
 
-        int n = pkt->send(fd, socket_flags_, is_udp);
+        ssize_t n;
+        if (!is_udp && zerocopy_ && zerocopy_threshold_ &&
+            pkt->size() >= zerocopy_threshold_) {
+            n = send_zerocopy(pkt, fd);
+        }
+        else {
+            n = pkt->send(fd, socket_flags_, is_udp);
+            if (n > 0 && zerocopy_) {
+                zerocopy_stats_.copied_bytes += n;
+            }
+        }
+
         if (n > 0) {
+            send_flush_ticker_.Reset();
+            on_send_progress(n);
             if (pkt->empty()) {
                 send_buf_sending_tmp.pop_front();
                 continue;
@@ -357,11 +436,24 @@ bool Socket::flush_data(const SocketFD::Ptr& sockfd)
     }
 
     if (!send_buf_sending_tmp.empty()) {
+        BufferList::Ptr pkt = send_buf_sending_tmp.front();
         send_buf_sending_tmp.swap(send_buf_sending_);
         send_buf_sending_.append(send_buf_sending_tmp);
+        if (pkt->wait_fd() != -1) {
+            // 管道中暂无数据，socket仍可写，等待管道可读
+            wait_send_source(sockfd, pkt);
+        }
+        else if (!sending_) {
+            // 直接发送时未发完，等待可写事件继续发送
+            start_writeable_event(sockfd);
+        }
+        // 回调中可能再次发送，放在队列状态恢复之后
+        check_low_watermark();
         return true;
     }
 
+    check_low_watermark();
+
     // sending缓存已经全部发送完毕，说明该socket还可写，尝试继续写
     // 如果是poller线程，我们尝试再次写一次(因为可能其他线程调用了send函数又有新数据了)
     return flush_data(sockfd);
@@ -369,14 +461,19 @@ bool Socket::flush_data(const SocketFD::Ptr& sockfd)
 
 bool Socket::attach_event(const SocketFD::Ptr& sockfd, bool is_udp)
 {
-    if (!read_buf_) {
-        read_buf_ = std::make_shared<BufferRaw>(is_udp ? 0xFFFF : 128 * 1024);
+    if (is_udp) {
+        apply_udp_options(sockfd);
+    }
+    else if (zerocopy_threshold_ && !zerocopy_) {
+        zerocopy_ = SocketUtils::SetZeroCopy(sockfd->RawFD()) != -1;
     }
 
     std::weak_ptr<Socket>   weak_self   = shared_from_this();
     std::weak_ptr<SocketFD> weak_sockfd = sockfd;
-    int                     ret =
-        poller_->AddEvent(sockfd->RawFD(), PE_READ | PE_WRITE | PE_ERROR,
+    int                     events =
+        (enable_recv_ ? PE_READ : 0) | PE_WRITE | PE_ERROR;
+    int ret =
+        poller_->AddEvent(sockfd->RawFD(), events,
                           [weak_self, weak_sockfd, is_udp](int event) {
                               auto strong_self   = weak_self.lock();
                               auto strong_sockfd = weak_sockfd.lock();
@@ -392,7 +489,10 @@ bool Socket::attach_event(const SocketFD::Ptr& sockfd, bool is_udp)
                               if (strong_self->sockfd_ && (event & PE_WRITE)) {
                                   strong_self->on_writeable(strong_sockfd);
                               }
-                              if (strong_self->sockfd_ && (event & PE_ERROR)) {
+                              // 错误队列中可能只是零拷贝完成通知
+                              if (strong_self->sockfd_ && (event & PE_ERROR) &&
+                                  !strong_self->on_zerocopy_notify(
+                                      strong_sockfd)) {
                                   strong_self->on_error(strong_sockfd);
                               }
                           });
@@ -420,19 +520,43 @@ void Socket::on_connected(const SocketFD::Ptr& sockfd, const ErrorCB& cb)
 
 int Socket::on_read(const SocketFD::Ptr& sockfd, bool is_udp)
 {
-    int  ret    = 0;
-    int  nread  = 0;
-    auto buffer = read_buf_;
-
-    auto             data     = buffer->Data();
-    int              capacity = buffer->Capacity() - 1;
+    int              ret   = 0;
+    int              nread = 0;
     sockaddr_storage addr;
     socklen_t        len = sizeof(addr);
 
+    if (is_udp && recv_batch_size_ > 0) {
+        return on_read_batch(sockfd);
+    }
+
+    // UDP_GRO需要通过cmsg取得分段大小
+    bool          gro = is_udp && recv_gro_;
+    char          ctrl[GRO_CTRL_SIZE];
+    struct msghdr msg;
+
     while (enable_recv_) {
+        // 共用读缓冲可能在上次回调后被交给调用者
+        BufferRaw::Ptr buffer   = poller_->GetSharedBuffer();
+        char*          data     = buffer->Data();
+        int            capacity = buffer->Capacity() - 1;
+        struct iovec   iov      = {data, static_cast<size_t>(capacity)};
+
         do {
-            nread = ::recvfrom(sockfd->RawFD(), data, capacity, 0,
-                               reinterpret_cast<sockaddr*>(&addr), &len);
+            if (gro) {
+                bzero(&msg, sizeof(msg));
+                msg.msg_name       = &addr;
+                msg.msg_namelen    = sizeof(addr);
+                msg.msg_iov        = &iov;
+                msg.msg_iovlen     = 1;
+                msg.msg_control    = ctrl;
+                msg.msg_controllen = sizeof(ctrl);
+                nread              = ::recvmsg(sockfd->RawFD(), &msg, 0);
+                len                = msg.msg_namelen;
+            }
+            else {
+                nread = ::recvfrom(sockfd->RawFD(), data, capacity, 0,
+                                   reinterpret_cast<sockaddr*>(&addr), &len);
+            }
         } while (nread == -1 && get_uv_error() == EINTR);
 
         if (nread == 0) {
@@ -454,14 +578,377 @@ int Socket::on_read(const SocketFD::Ptr& sockfd, bool is_udp)
         data[nread] = '\0';
         buffer->SetSize(nread);
 
-        if (read_cb_) {
+        uint32_t segment_size = gro ? get_gro_segment_size(msg) : 0;
+        if (segment_size && static_cast<uint32_t>(nread) > segment_size) {
+            on_read_segments(buffer, segment_size, &addr, len, nullptr);
+        }
+        else if (read_cb_) {
             read_cb_(buffer, &addr, len);
         }
+
+        // 除poller和这里之外仍有引用，说明调用者保留了该缓冲
+        if (read_buf_transfer_ && buffer.use_count() > 2) {
+            poller_->DetachSharedBuffer();
+        }
     }
 
     return 0;
 }
 
+int Socket::on_read_batch(const SocketFD::Ptr& sockfd)
+{
+    int ret = 0;
+    int nread;
+    while (enable_recv_) {
+        // 回调中可能修改了批量参数
+        uint32_t batch = recv_batch_size_;
+        if (batch == 0) {
+            return ret + on_read(sockfd, true);
+        }
+        // GRO合并后的包可能接近64KB
+        uint32_t packet_size =
+            recv_gro_ ?
+                std::max<uint32_t>(recv_packet_size_, SOCKET_GRO_BUFFER_SIZE) :
+                recv_packet_size_;
+        if (recv_bufs_.size() != batch ||
+            recv_iovs_[0].iov_len != packet_size) {
+            alloc_recv_batch(packet_size);
+        }
+
+        for (uint32_t i = 0; i < batch; i++) {
+            // recvmmsg会改写msg_namelen和msg_flags，每次都要重置
+            bzero(&recv_msgs_[i], sizeof(mmsghdr));
+            recv_msgs_[i].msg_hdr.msg_name    = &recv_addrs_[i];
+            recv_msgs_[i].msg_hdr.msg_namelen = sizeof(sockaddr_storage);
+            recv_msgs_[i].msg_hdr.msg_iov     = &recv_iovs_[i];
+            recv_msgs_[i].msg_hdr.msg_iovlen  = 1;
+            if (recv_gro_) {
+                msghdr& hdr        = recv_msgs_[i].msg_hdr;
+                hdr.msg_control    = &recv_ctrls_[i * GRO_CTRL_SIZE];
+                hdr.msg_controllen = GRO_CTRL_SIZE;
+            }
+        }
+
+        do {
+            nread = ::recvmmsg(sockfd->RawFD(), recv_msgs_.data(), batch,
+                               MSG_DONTWAIT, nullptr);
+        } while (nread == -1 && get_uv_error() == EINTR);
+
+        if (nread == -1) {
+            if (get_uv_error() != EAGAIN) {
+                on_error(sockfd);
+            }
+            return ret;
+        }
+
+        recv_packets_.clear();
+        for (int i = 0; i < nread; i++) {
+            msghdr&  hdr = recv_msgs_[i].msg_hdr;
+            uint32_t len = recv_msgs_[i].msg_len;
+            if (hdr.msg_flags & MSG_TRUNC) {
+                socket_log(LOG_W, this)
+                    << " udp packet larger than " << packet_size
+                    << " bytes, dropped";
+                continue;
+            }
+
+            ret += len;
+            recv_bufs_[i]->Data()[len] = '\0';
+            recv_bufs_[i]->SetSize(len);
+
+            uint32_t segment_size =
+                recv_gro_ ? get_gro_segment_size(hdr) : 0;
+            if (segment_size && len > segment_size) {
+                on_read_segments(recv_bufs_[i], segment_size, &recv_addrs_[i],
+                                 hdr.msg_namelen,
+                                 batch_read_cb_ ? &recv_packets_ : nullptr);
+            }
+            else if (batch_read_cb_) {
+                recv_packets_.push_back(
+                    {recv_bufs_[i], &recv_addrs_[i], hdr.msg_namelen});
+            }
+            else if (read_cb_) {
+                read_cb_(recv_bufs_[i], &recv_addrs_[i], hdr.msg_namelen);
+            }
+        }
+
+        if (!recv_packets_.empty()) {
+            batch_read_cb_(recv_packets_);
+        }
+
+        if (static_cast<uint32_t>(nread) < batch) {
+            // 没有填满，socket读缓存已经取完，省去一次返回EAGAIN的调用
+            return ret;
+        }
+    }
+
+    return ret;
+}
+
+void Socket::alloc_recv_batch(uint32_t packet_size)
+{
+    uint32_t batch = recv_batch_size_;
+    recv_bufs_.resize(batch);
+    recv_msgs_.resize(batch);
+    recv_iovs_.resize(batch);
+    recv_addrs_.resize(batch);
+    recv_ctrls_.resize(batch * GRO_CTRL_SIZE);
+    for (uint32_t i = 0; i < batch; i++) {
+        // 多留一个字节用于在末尾补'\0'
+        recv_bufs_[i] = std::make_shared<BufferRaw>(packet_size + 1);
+        recv_iovs_[i].iov_base = recv_bufs_[i]->Data();
+        recv_iovs_[i].iov_len  = packet_size;
+    }
+}
+
+void Socket::on_read_segments(const Buffer::Ptr&      buffer,
+                              uint32_t                segment_size,
+                              sockaddr_storage*       addr,
+                              socklen_t               addr_len,
+                              std::vector<UdpPacket>* packets)
+{
+    // 除最后一个外每个数据报都是segment_size字节
+    uint32_t size = buffer->Size();
+    for (uint32_t offset = 0; offset < size; offset += segment_size) {
+        Buffer::Ptr segment = std::make_shared<BufferSlice>(
+            buffer, offset, std::min(segment_size, size - offset));
+        if (packets) {
+            packets->push_back({segment, addr, addr_len});
+        }
+        else if (read_cb_) {
+            read_cb_(segment, addr, addr_len);
+        }
+    }
+}
+
+void Socket::SetRecvBatch(uint32_t batch_size, uint32_t packet_size)
+{
+    recv_batch_size_  = batch_size;
+    // 下次读取时按新的参数重新分配
+    recv_packet_size_ = std::max<uint32_t>(packet_size, 1);
+}
+
+void Socket::SetSendSegment(uint16_t segment_size)
+{
+    send_segment_size_ = segment_size;
+    if (sockfd_ && sockfd_->Type() == SOCK_UDP) {
+        apply_udp_options(sockfd_);
+    }
+}
+
+void Socket::SetRecvGRO(bool enable)
+{
+    recv_gro_ = enable;
+    if (sockfd_ && sockfd_->Type() == SOCK_UDP &&
+        SocketUtils::SetUdpGRO(sockfd_->RawFD(), enable) == -1) {
+        recv_gro_ = false;
+    }
+}
+
+void Socket::SetZeroCopy(uint32_t threshold)
+{
+    // 关闭时保留SO_ZEROCOPY，之前发送的数据仍会收到完成通知
+    zerocopy_threshold_ = threshold;
+    if (threshold && !zerocopy_ && sockfd_ && sockfd_->Type() == SOCK_TCP) {
+        zerocopy_ = SocketUtils::SetZeroCopy(sockfd_->RawFD()) != -1;
+    }
+}
+
+void Socket::SetReadBufferTransfer(bool enable)
+{
+    read_buf_transfer_ = enable;
+}
+
+void Socket::SetSendWatermark(uint64_t low, uint64_t high, WatermarkCB&& cb)
+{
+    send_low_watermark_  = std::min(low, high);
+    send_high_watermark_ = high;
+    watermark_cb_        = std::move(cb);
+    if (send_high_ && (!high || send_queued_bytes_ <= send_low_watermark_)) {
+        on_watermark(false);
+    }
+}
+
+void Socket::SetBackpressureSource(const Socket::Ptr& upstream)
+{
+    auto old = backpressure_source_.lock();
+    if (old && old != upstream && send_high_) {
+        old->EnableRecv(true);
+    }
+    backpressure_source_ = upstream;
+    if (upstream && send_high_) {
+        upstream->EnableRecv(false);
+    }
+}
+
+void Socket::SetSendQueueLimit(uint64_t max_bytes, bool close)
+{
+    send_queue_limit_    = max_bytes;
+    send_overflow_close_ = close;
+}
+
+void Socket::SetSendTimeout(uint32_t timeout_sec)
+{
+    send_timeout_ms_ = timeout_sec * 1000;
+    if (send_timeout_ms_ && !send_sweeping_) {
+        send_sweeping_                  = true;
+        std::weak_ptr<Socket> weak_self = shared_from_this();
+        poller_->AddSweep([weak_self]() {
+            auto strong_self = weak_self.lock();
+            return strong_self && strong_self->check_send_timeout();
+        });
+    }
+}
+
+bool Socket::check_send_timeout()
+{
+    if (!send_timeout_ms_) {
+        // 关闭后从检查列表中移除，再次开启时重新加入
+        send_sweeping_ = false;
+        return false;
+    }
+    if (!sockfd_ || send_wait_fd_ != -1 || send_queued_bytes_ == 0 ||
+        send_flush_ticker_.ElapsedTimeMS() < send_timeout_ms_) {
+        return true;
+    }
+
+    emit_error(SocketException(ERR_TIMEOUT, "send timeout"));
+    // 对端不再读取，释放发送队列
+    send_buf_sending_.clear();
+    send_buf_waiting_.clear();
+    send_queued_bytes_ = 0;
+    check_low_watermark();
+    return true;
+}
+
+void Socket::EnableRecv(bool enable)
+{
+    if (!poller_->IsCurrentThread()) {
+        std::weak_ptr<Socket> weak_self = shared_from_this();
+        poller_->Post([weak_self, enable]() {
+            auto strong_self = weak_self.lock();
+            if (strong_self) {
+                strong_self->EnableRecv(enable);
+            }
+        });
+        return;
+    }
+
+    if (enable_recv_ == enable) {
+        return;
+    }
+    enable_recv_ = enable;
+    if (!sockfd_ ||
+        (sockfd_->Type() == SOCK_TCP && !sockfd_->IsConnected())) {
+        // TCP连接建立后在attach_event中生效，监听socket不受影响
+        return;
+    }
+    // 重新加入PE_READ时内核会报告当前已可读，暂停期间到达的数据不会丢失
+    if (sending_) {
+        start_writeable_event(sockfd_);
+    }
+    else {
+        stop_writeable_event(sockfd_);
+    }
+}
+
+bool Socket::enqueue_send_buf(Buffer::Ptr buf)
+{
+    if (!sockfd_ || !check_send_limit(buf->Size())) {
+        return false;
+    }
+    push_send_buf(std::move(buf));
+    return true;
+}
+
+bool Socket::enqueue_send_bufs(std::vector<Buffer::Ptr>& bufs)
+{
+    // 整批一起检查上限，不会只发出其中一部分
+    uint64_t size = 0;
+    for (const Buffer::Ptr& buf : bufs) {
+        size += buf->Size();
+    }
+    if (!sockfd_ || !check_send_limit(size)) {
+        return false;
+    }
+    for (Buffer::Ptr& buf : bufs) {
+        push_send_buf(std::move(buf));
+    }
+    return true;
+}
+
+bool Socket::check_send_limit(uint64_t size)
+{
+    if (!send_queue_limit_ || send_queued_bytes_ + size <= send_queue_limit_) {
+        return true;
+    }
+
+    if (send_overflow_close_) {
+        emit_error(SocketException(ERR_OTHER, "send queue overflow"));
+    }
+    else {
+        send_dropped_bytes_ += size;
+    }
+    return false;
+}
+
+void Socket::push_send_buf(Buffer::Ptr&& buf)
+{
+    uint32_t size = buf->Size();
+    if (send_queued_bytes_ == 0) {
+        // 队列从空开始计时
+        send_flush_ticker_.Reset();
+    }
+    send_buf_waiting_.emplace_back(std::move(buf));
+    send_queued_bytes_ += size;
+    if (send_high_watermark_ && !send_high_ &&
+        send_queued_bytes_ >= send_high_watermark_) {
+        on_watermark(true);
+    }
+}
+
+void Socket::on_send_progress(uint64_t n)
+{
+    send_queued_bytes_ -= std::min<uint64_t>(n, send_queued_bytes_);
+}
+
+void Socket::check_low_watermark()
+{
+    if (send_high_ && send_queued_bytes_ <= send_low_watermark_) {
+        on_watermark(false);
+    }
+}
+
+void Socket::on_watermark(bool high)
+{
+    send_high_    = high;
+    auto upstream = backpressure_source_.lock();
+    if (upstream) {
+        upstream->EnableRecv(!high);
+    }
+    if (watermark_cb_) {
+        watermark_cb_(high);
+    }
+}
+
+void Socket::apply_udp_options(const SocketFD::Ptr& sockfd)
+{
+    int fd = sockfd->RawFD();
+    if (send_segment_size_ || send_gso_) {
+        // 关闭时也要清除内核中的设置
+        int ret   = SocketUtils::SetUdpSegment(fd, send_segment_size_);
+        send_gso_ = (ret != -1 && send_segment_size_);
+        if (send_segment_size_ && !send_gso_) {
+            socket_log(LOG_W, this)
+                << " kernel udp gso unsupported, segment in user space";
+        }
+    }
+
+    if (recv_gro_ && SocketUtils::SetUdpGRO(fd, true) == -1) {
+        recv_gro_ = false;
+    }
+}
+
 void Socket::on_writeable(const SocketFD::Ptr& sockfd)
 {
     bool sending_empty;
@@ -491,7 +978,7 @@ bool Socket::emit_error(const SocketException& err)
     Close();
 
     std::weak_ptr<Socket> weak_self = shared_from_this();
-    poller_->Async([weak_self, err]() {
+    poller_->Post([weak_self, err]() {
         auto strong_self = weak_self.lock();
         if (!strong_self) {
             return;
@@ -545,7 +1032,12 @@ int Socket::on_accept(const SocketFD::Ptr& sockfd, int event)
             SocketUtils::SetCloseWait(fd);
             SocketUtils::SetCloExec(fd);
 
-            Socket::Ptr   peer_socket = Socket::Create(poller_);
+            EventPoller::Ptr peer_poller = before_accept_cb_();
+            if (!peer_poller) {
+                peer_poller = poller_;
+            }
+
+            Socket::Ptr   peer_socket = Socket::Create(peer_poller);
             SocketFD::Ptr peer_sockfd = peer_socket->SetPeerSocket(fd);
             peer_sockfd->SetConnected();
 
@@ -553,9 +1045,19 @@ int Socket::on_accept(const SocketFD::Ptr& sockfd, int event)
                 accept_cb_(peer_socket);
             }
 
-            if (!peer_socket->attach_event(peer_sockfd)) {
-                peer_socket->emit_error(SocketException(
-                    ERR_OTHER, "attach to poller failed while accept"));
+            auto attach = [peer_socket, peer_sockfd]() {
+                if (!peer_socket->attach_event(peer_sockfd)) {
+                    peer_socket->emit_error(SocketException(
+                        ERR_OTHER, "attach to poller failed while accept"));
+                }
+            };
+
+            if (peer_poller == poller_) {
+                attach();
+            }
+            else {
+                // 新连接属于其他poller，必须在其线程中注册事件
+                peer_poller->Post(std::move(attach));
             }
         }
 
@@ -574,6 +1076,8 @@ bool Socket::listen(const SocketFD::Ptr& sockfd)
 {
     std::weak_ptr<Socket>   weak_self   = shared_from_this();
     std::weak_ptr<SocketFD> weak_sockfd = sockfd;
+    // 其他线程调用时poller可能在AddEvent返回前就分发事件，先设置sockfd_
+    sockfd_ = sockfd;
     if (sockfd->Type() == SOCK_TCP) {
         int ret =
             poller_->AddEvent(sockfd->RawFD(), PE_LT | PE_READ | PE_ERROR,
@@ -588,6 +1092,7 @@ bool Socket::listen(const SocketFD::Ptr& sockfd)
                               });
 
         if (ret == -1) {
+            sockfd_ = nullptr;
             return false;
         }
     }
@@ -595,8 +1100,6 @@ bool Socket::listen(const SocketFD::Ptr& sockfd)
         attach_event(sockfd, true);
     }
 
-    sockfd_ = sockfd;
-
     return true;
 }
 
@@ -629,20 +1132,46 @@ int Socket::send(const Buffer::Ptr&       buf,
         return -1;
     }
 
+    if (sockfd_->Type() == SOCK_UDP && send_segment_size_ &&
+        size > send_segment_size_) {
+        uint32_t chunk_size = get_send_chunk_size();
+        if (size > chunk_size) {
+            std::vector<Buffer::Ptr> bufs;
+            split_segments(buf, addr, len, chunk_size, bufs);
+            return send(bufs);
+        }
+    }
+
+    Buffer::Ptr tmp_buf =
+        (sockfd_->Type() == SOCK_UDP ?
+             std::make_shared<BufferSock>(buf, addr, len) :
+             buf);
+
+    if (poller_->IsCurrentThread()) {
+        if (!enqueue_send_buf(std::move(tmp_buf))) {
+            return -1;
+        }
+        if (!sending_) {
+            // 不在等待可写事件时直接发送，发送出错时sockfd_可能被重置
+            SocketFD::Ptr sockfd = sockfd_;
+            flush_data(sockfd);
+        }
+        return 0;
+    }
+
     std::weak_ptr<Socket>   weak_self   = shared_from_this();
     std::weak_ptr<SocketFD> weak_sockfd = sockfd_;
-    Buffer::Ptr             tmp_buf     = (sockfd_->Type() == SOCK_UDP ?
-                                               std::make_shared<BufferSock>(buf, addr, len) :
-                                               buf);
 
-    poller_->AsyncFirst([weak_self, weak_sockfd, tmp_buf]() {
+    poller_->PostFirst([weak_self, weak_sockfd, tmp_buf]() {
         auto strong_self   = weak_self.lock();
         auto strong_sockfd = weak_sockfd.lock();
         if (!strong_self || !strong_sockfd) {
             return;
         }
 
-        strong_self->send_buf_waiting_.emplace_back(tmp_buf);
+        if (!strong_self->enqueue_send_buf(tmp_buf)) {
+            return;
+        }
 
         if (!strong_self->sending_) {
             strong_self->start_writeable_event(strong_sockfd);
@@ -652,6 +1181,322 @@ int Socket::send(const Buffer::Ptr&       buf,
     return 0;
 }
 
+int Socket::Send(const Buffer::Ptr&       buf,
+                 struct sockaddr_storage* addr,
+                 socklen_t                len)
+{
+    return send(buf, addr, len);
+}
+
+int Socket::Send(const std::vector<Buffer::Ptr>& bufs,
+                 struct sockaddr_storage*        addr,
+                 socklen_t                       len)
+{
+    if (!sockfd_) {
+        return -1;
+    }
+
+    bool     is_udp     = sockfd_->Type() == SOCK_UDP;
+    uint32_t chunk_size = is_udp ? get_send_chunk_size() : 0;
+
+    std::vector<Buffer::Ptr> tmp_bufs;
+    tmp_bufs.reserve(bufs.size());
+    for (const Buffer::Ptr& buf : bufs) {
+        if (!buf || !buf->Size()) {
+            continue;
+        }
+        if (!is_udp) {
+            tmp_bufs.emplace_back(buf);
+        }
+        else if (chunk_size && buf->Size() > chunk_size) {
+            split_segments(buf, addr, len, chunk_size, tmp_bufs);
+        }
+        else {
+            tmp_bufs.emplace_back(std::make_shared<BufferSock>(buf, addr, len));
+        }
+    }
+
+    if (tmp_bufs.empty()) {
+        return 0;
+    }
+    return send(tmp_bufs);
+}
+
+uint32_t Socket::get_send_chunk_size()
+{
+    if (!send_segment_size_) {
+        return 0;
+    }
+    // 内核切分时每次交给内核多个分段，否则每个分段一个数据报
+    uint32_t chunk_size = send_segment_size_;
+    if (send_gso_) {
+        chunk_size *= std::max<uint32_t>(
+            std::min<uint32_t>(SOCKET_GSO_MAX_SEGMENTS,
+                               SOCKET_GSO_MAX_SIZE / send_segment_size_),
+            1);
+    }
+    return chunk_size;
+}
+
+void Socket::split_segments(const Buffer::Ptr&        buf,
+                            sockaddr_storage*         addr,
+                            socklen_t                 len,
+                            uint32_t                  chunk_size,
+                            std::vector<Buffer::Ptr>& bufs)
+{
+    uint32_t size = buf->Size();
+    for (uint32_t offset = 0; offset < size; offset += chunk_size) {
+        Buffer::Ptr chunk = std::make_shared<BufferSlice>(
+            buf, offset, std::min(chunk_size, size - offset));
+        bufs.emplace_back(std::make_shared<BufferSock>(chunk, addr, len));
+    }
+}
+
+int Socket::send(std::vector<Buffer::Ptr>& bufs)
+{
+    if (poller_->IsCurrentThread()) {
+        // 超过上限时整批丢弃，或连接已关闭
+        if (!enqueue_send_bufs(bufs)) {
+            return -1;
+        }
+        if (!sending_) {
+            SocketFD::Ptr sockfd = sockfd_;
+            flush_data(sockfd);
+        }
+        return 0;
+    }
+
+    std::weak_ptr<Socket>   weak_self   = shared_from_this();
+    std::weak_ptr<SocketFD> weak_sockfd = sockfd_;
+
+    poller_->PostFirst([weak_self, weak_sockfd, bufs]() mutable {
+        auto strong_self   = weak_self.lock();
+        auto strong_sockfd = weak_sockfd.lock();
+        if (!strong_self || !strong_sockfd) {
+            return;
+        }
+
+        if (!strong_self->enqueue_send_bufs(bufs)) {
+            return;
+        }
+
+        if (!strong_self->sending_) {
+            strong_self->start_writeable_event(strong_sockfd);
+        }
+    });
+
+    return 0;
+}
+
+int Socket::SendFile(int fd, off_t offset, size_t length)
+{
+    if (!sockfd_ || sockfd_->Type() != SOCK_TCP) {
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) == -1) {
+        socket_log(LOG_E, this) << " fstat failed. " << get_uv_errmsg();
+        return -1;
+    }
+
+    bool is_pipe = S_ISFIFO(st.st_mode);
+    if (is_pipe) {
+        if (length == 0) {
+            return -1;
+        }
+        offset = 0;
+    }
+    else if (S_ISREG(st.st_mode)) {
+        if (offset < 0 || offset > st.st_size) {
+            return -1;
+        }
+        if (length == 0 || length > size_t(st.st_size - offset)) {
+            length = st.st_size - offset;
+        }
+        if (length == 0) {
+            return 0;
+        }
+    }
+    else {
+        socket_log(LOG_E, this) << " SendFile only supports file and pipe";
+        return -1;
+    }
+
+    // 每段使用独立的fd，各自在发送完成后关闭
+    std::vector<Buffer::Ptr> bufs;
+    for (size_t sent = 0; sent < length; sent += SOCKET_SENDFILE_CHUNK_SIZE) {
+        int dup_fd = fcntl(fd, F_DUPFD_CLOEXEC, 0);
+        if (dup_fd == -1) {
+            socket_log(LOG_E, this) << " dup failed. " << get_uv_errmsg();
+            return -1;
+        }
+        uint32_t size = std::min<size_t>(length - sent,
+                                         SOCKET_SENDFILE_CHUNK_SIZE);
+        bufs.emplace_back(std::make_shared<BufferFile>(
+            dup_fd, offset + sent, size, is_pipe));
+    }
+    return send(bufs);
+}
+
+void Socket::wait_send_source(const SocketFD::Ptr&   sockfd,
+                              const BufferList::Ptr& pkt)
+{
+    int fd = pkt->wait_fd();
+    if (fd == send_wait_fd_) {
+        return;
+    }
+    // 之前等待的管道可能已经发送完毕，不会再触发事件
+    cancel_wait_send_source();
+    if (sending_) {
+        // 停止可写事件后新的Send会直接尝试发送
+        stop_writeable_event(sockfd);
+    }
+
+    std::weak_ptr<Socket>   weak_self   = shared_from_this();
+    std::weak_ptr<SocketFD> weak_sockfd = sockfd;
+
+    int ret = poller_->AddEvent(
+        fd, PE_READ | PE_ERROR, [weak_self, weak_sockfd](int) {
+            auto strong_self   = weak_self.lock();
+            auto strong_sockfd = weak_sockfd.lock();
+            if (!strong_self || !strong_sockfd) {
+                return;
+            }
+            // 写端关闭时也会触发，由splice返回0报错
+            strong_self->cancel_wait_send_source();
+            strong_self->flush_data(strong_sockfd);
+        });
+    if (ret == -1) {
+        emit_error(SocketException(ERR_OTHER, "wait pipe failed"));
+        return;
+    }
+    send_wait_fd_  = fd;
+    send_wait_pkt_ = pkt;
+}
+
+void Socket::cancel_wait_send_source()
+{
+    if (send_wait_fd_ == -1) {
+        return;
+    }
+    // 移除事件后才能释放管道fd
+    BufferList::Ptr pkt = std::move(send_wait_pkt_);
+    poller_->DelEvent(send_wait_fd_, [pkt](bool) {});
+    send_wait_fd_ = -1;
+}
+
+ssize_t Socket::send_zerocopy(const BufferList::Ptr& pkt, int fd)
+{
+    uint32_t calls = 0;
+    uint64_t bytes = 0;
+    ssize_t  n     = pkt->send_zerocopy(fd, socket_flags_, calls, bytes);
+    if (calls) {
+        zerocopy_pending_.push_back({calls, calls, bytes, false, pkt});
+        zerocopy_stats_.pending_bytes += bytes;
+    }
+
+    if (!pkt->empty() && errno == ENOBUFS) {
+        // 未完成的通知超出optmem限制，剩余数据改为拷贝发送
+        ssize_t copied = pkt->send(fd, socket_flags_, false);
+        if (copied > 0) {
+            zerocopy_stats_.copied_bytes += copied;
+            n = (n > 0 ? n : 0) + copied;
+        }
+    }
+
+    return n;
+}
+
+bool Socket::on_zerocopy_notify(const SocketFD::Ptr& sockfd)
+{
+    if (!zerocopy_) {
+        return false;
+    }
+
+    char ctrl[CMSG_SPACE(sizeof(sock_extended_err) + sizeof(sockaddr_in6))];
+    bool notified = false;
+    while (true) {
+        struct msghdr msg;
+        bzero(&msg, sizeof(msg));
+        msg.msg_control    = ctrl;
+        msg.msg_controllen = sizeof(ctrl);
+
+        int ret;
+        do {
+            ret = ::recvmsg(sockfd->RawFD(), &msg, MSG_ERRQUEUE);
+        } while (ret == -1 && get_uv_error() == EINTR);
+        if (ret == -1) {
+            break;
+        }
+
+        struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+        for (; cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+            if (!(cmsg->cmsg_level == SOL_IP &&
+                  cmsg->cmsg_type == IP_RECVERR) &&
+                !(cmsg->cmsg_level == SOL_IPV6 &&
+                  cmsg->cmsg_type == IPV6_RECVERR)) {
+                continue;
+            }
+
+            sock_extended_err ee;
+            memcpy(&ee, CMSG_DATA(cmsg), sizeof(ee));
+            if (ee.ee_origin == SO_EE_ORIGIN_ZEROCOPY && ee.ee_errno == 0) {
+                // ee_info到ee_data为完成的通知序号区间
+                notified = true;
+                on_zerocopy_complete(ee.ee_info, ee.ee_data,
+                                     ee.ee_code & SO_EE_CODE_ZEROCOPY_COPIED);
+            }
+        }
+    }
+
+    if (!notified) {
+        // 不是零拷贝通知引起的，如连接挂断
+        return false;
+    }
+
+    // 错误队列中只有完成通知时socket本身没有错误
+    SocketException err = get_socket_error(sockfd, false);
+    if (err) {
+        emit_error(err);
+    }
+    return true;
+}
+
+void Socket::on_zerocopy_complete(uint32_t lo, uint32_t hi, bool copied)
+{
+    // 通知可能乱序到达，按相对队首的偏移扣减每条记录的剩余序号数
+    uint32_t begin = lo - zerocopy_seq_;
+    uint32_t end   = hi - zerocopy_seq_ + 1;
+    uint32_t base  = 0;
+    for (ZeroCopyPending& pending : zerocopy_pending_) {
+        if (base >= end) {
+            break;
+        }
+        uint32_t from = std::max(begin, base);
+        uint32_t to   = std::min(end, base + pending.seqs);
+        if (from < to) {
+            pending.remaining -= to - from;
+            pending.copied = pending.copied || copied;
+        }
+        base += pending.seqs;
+    }
+
+    while (!zerocopy_pending_.empty() &&
+           zerocopy_pending_.front().remaining == 0) {
+        ZeroCopyPending& front = zerocopy_pending_.front();
+        if (front.copied) {
+            zerocopy_stats_.fallback_bytes += front.bytes;
+        }
+        else {
+            zerocopy_stats_.zerocopy_bytes += front.bytes;
+        }
+        zerocopy_stats_.pending_bytes -= front.bytes;
+        zerocopy_seq_ += front.seqs;
+        zerocopy_pending_.pop_front();
+    }
+}
+
 SocketException Socket::get_socket_error(const SocketFD::Ptr& sockfd,
                                          bool                 try_errno)
 {
@@ -1,9 +1,11 @@
 #ifndef COMMON_LIBRARY_SOCKET_H
 #define COMMON_LIBRARY_SOCKET_H
 
+#include <deque>
 #include <exception>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include <net/buffer.h>
 #include <poller/event_poller.h>
@@ -13,6 +15,16 @@
 #include <sys/socket.h>
 #include <unistd.h>
 
+// 内核单次UDP_SEGMENT发送最多的分段数和总长度
+#define SOCKET_GSO_MAX_SEGMENTS 64
+#define SOCKET_GSO_MAX_SIZE     65000
+// UDP_GRO合并后的最大长度
+#define SOCKET_GRO_BUFFER_SIZE 65535
+// 关闭时仍未收到零拷贝完成通知的数据延迟释放的时间
+#define SOCKET_ZEROCOPY_LINGER_MS 30000
+// SendFile拆分大文件时单个BufferFile的最大长度
+#define SOCKET_SENDFILE_CHUNK_SIZE (1024 * 1024 * 1024)
+
 namespace common_library {
 
 typedef enum {
@@ -143,6 +155,31 @@ class SocketInfo {
     }
 };
 
+/**
+ * 批量接收到的一个UDP包，buffer和addr在回调返回后会被复用
+ */
+struct UdpPacket
+{
+    Buffer::Ptr       buffer;
+    sockaddr_storage* addr;
+    socklen_t         addr_len;
+};
+
+/**
+ * MSG_ZEROCOPY发送统计，单位字节
+ */
+struct ZeroCopyStats
+{
+    // 内核确认零拷贝发送
+    uint64_t zerocopy_bytes = 0;
+    // 请求了零拷贝但内核回退为拷贝，如回环地址或网卡不支持
+    uint64_t fallback_bytes = 0;
+    // 低于阈值或通知过多时直接拷贝发送
+    uint64_t copied_bytes = 0;
+    // 已发送，等待完成通知
+    uint64_t pending_bytes = 0;
+};
+
 class Socket final : public std::enable_shared_from_this<Socket>,
                      public noncopyable,
                      public SocketInfo {
@@ -150,14 +187,22 @@ class Socket final : public std::enable_shared_from_this<Socket>,
     typedef std::shared_ptr<Socket>                     Ptr;
     typedef std::function<void(const SocketException&)> ErrorCB;
     typedef std::function<bool()>                       FlushedCB;
+    // high为true表示达到高水位，false表示降到低水位
+    typedef std::function<void(bool high)> WatermarkCB;
     typedef std::function<
         void(const Buffer::Ptr&, sockaddr_storage*, socklen_t)>
                                                      ReadCB;
     typedef std::function<void(Socket::Ptr& socket)> AcceptCB;
+    typedef std::function<void(const std::vector<UdpPacket>&)> BatchReadCB;
+    // 返回新连接所属的poller
+    typedef std::function<EventPoller::Ptr()> BeforeAcceptCB;
 
-    static Socket::Ptr Create(const EventPoller::Ptr& poller);
+    /**
+     * poller为空时从EventPollerPool中选择
+     */
+    static Socket::Ptr Create(const EventPoller::Ptr& poller = nullptr);
 
-    Socket(const EventPoller::Ptr& poller);
+    Socket(const EventPoller::Ptr& poller = nullptr);
 
     ~Socket();
 
@@ -181,12 +226,143 @@ class Socket final : public std::enable_shared_from_this<Socket>,
              struct sockaddr_storage* addr = nullptr,
              socklen_t                len  = 0);
 
+    /**
+     * 发送已有的Buffer，不拷贝，同一个Buffer可以同时发给多个socket
+     * 发送完成前Buffer的内容不能被修改
+     * 转发读回调的Buffer时不能关闭SetReadBufferTransfer，否则会被后续读取覆盖
+     */
+    int Send(const Buffer::Ptr&       buf,
+             struct sockaddr_storage* addr = nullptr,
+             socklen_t                len  = 0);
+
+    /**
+     * 按顺序发送多个Buffer，不拷贝，跨线程调用时只投递一次任务
+     * UDP时每个Buffer是一个数据报，都发往addr
+     */
+    int Send(const std::vector<Buffer::Ptr>& bufs,
+             struct sockaddr_storage*        addr = nullptr,
+             socklen_t                       len  = 0);
+
+    /**
+     * TCP发送文件或管道fd中的数据，与Send的数据按调用顺序进入同一发送队列
+     * 普通文件通过sendfile、管道通过splice发送，数据不经过用户态
+     * 普通文件从offset开始发送length字节，length为0时发送到文件末尾
+     * 管道忽略offset，length必须大于0，管道中暂无数据时等待其可读后继续
+     * fd会被dup，调用后即可关闭，发送期间文件不能被截断
+     * 队列中的数据全部发送完毕后回调OnFlushed，可据此继续发送下一段
+     * 成功入队返回0，失败返回-1
+     */
+    int SendFile(int fd, off_t offset = 0, size_t length = 0);
+
     void          SetOnError(ErrorCB&& cb);
     void          SetOnFlushed(FlushedCB&& cb);
     void          SetOnRead(ReadCB&& cb);
+    void          SetOnBatchRead(BatchReadCB&& cb);
     void          SetOnAccept(AcceptCB&& cb);
+    void          SetOnBeforeAccept(BeforeAcceptCB&& cb);
     SocketFD::Ptr SetPeerSocket(int fd);
 
+    /**
+     * UDP使用recvmmsg批量接收，每次最多batch_size个包，0表示关闭
+     * 每个包预分配packet_size字节，超长的包被截断后丢弃
+     * 设置了BatchReadCB时一次回调整批，否则逐个回调ReadCB
+     * 需在poller线程或者Listen之前调用
+     */
+    void SetRecvBatch(uint32_t batch_size, uint32_t packet_size = 2048);
+
+    /**
+     * UDP分段发送，每次Send的数据按segment_size切分成多个数据报发给同一目标
+     * 内核支持UDP_SEGMENT时一次系统调用交给内核切分，否则在用户态切分后批量发送
+     * segment_size不能超过路径MTU减去IP和UDP头，0表示关闭
+     * 需在poller线程或者Listen之前调用
+     */
+    void SetSendSegment(uint16_t segment_size);
+
+    /**
+     * UDP_GRO接收，内核将同一来源连续到达的数据报合并后一次返回
+     * 收到后按内核给出的分段大小拆分，每个数据报仍单独回调
+     * 拆分出的Buffer引用同一块接收缓冲，数据不以'\0'结尾
+     * 批量接收时每个包的缓冲至少为SOCKET_GRO_BUFFER_SIZE
+     * 需在poller线程或者Listen之前调用
+     */
+    void SetRecvGRO(bool enable);
+
+    /**
+     * TCP单次发送不小于threshold字节时使用MSG_ZEROCOPY，0表示关闭
+     * Buffer在收到内核的完成通知后才释放，发送后不能再修改其内容
+     * 零拷贝需要额外的完成通知，阈值过小反而更慢，建议不低于16KB
+     * 需在poller线程或者连接建立之前调用
+     */
+    void SetZeroCopy(uint32_t threshold);
+
+    /**
+     * 读回调收到的Buffer是poller内所有socket共用的读缓冲
+     * 默认开启，回调返回时若仍有引用(如已Send入队)，该缓冲交给调用者
+     * poller另行分配新的读缓冲
+     * 关闭后省去引用检查，Buffer只在回调期间有效，之后会被任意socket的读取覆盖
+     * 需在poller线程中调用
+     */
+    void SetReadBufferTransfer(bool enable);
+
+    /**
+     * 发送队列中未发送的字节数达到high时回调cb(true)
+     * 之后降到low及以下时回调cb(false)，high为0表示关闭
+     * 需在poller线程中调用
+     */
+    void SetSendWatermark(uint64_t low, uint64_t high, WatermarkCB&& cb);
+
+    /**
+     * 代理场景的反压，本socket达到高水位时暂停upstream的读取，降到低水位后恢复
+     * 需配合SetSendWatermark使用，upstream可以属于其他poller，nullptr表示取消
+     * 需在poller线程中调用
+     */
+    void SetBackpressureSource(const Socket::Ptr& upstream);
+
+    /**
+     * 发送队列的硬上限，0表示不限制
+     * 入队后会超过max_bytes的数据被丢弃，close为true时改为关闭连接并回调错误
+     * 一次Send多个buffer或SendFile拆出的多段整体检查，要么全部入队要么全部丢弃
+     * 需在poller线程中调用
+     */
+    void SetSendQueueLimit(uint64_t max_bytes, bool close = false);
+
+    /**
+     * 发送队列非空且超过timeout_sec秒没有任何数据写出时，释放队列并回调ERR_TIMEOUT
+     * 由poller内共用的定时器每POLLER_SWEEP_MS检查一次，0表示关闭
+     * 等待管道数据(SendFile)期间不计时，需在poller线程中调用
+     */
+    void SetSendTimeout(uint32_t timeout_sec);
+
+    /**
+     * 暂停或恢复读取，可在任意线程调用
+     */
+    void EnableRecv(bool enable);
+
+    /**
+     * 发送队列中未发送的字节数，不含其他线程尚未投递到poller的数据
+     * 需在poller线程中调用
+     */
+    uint64_t GetSendQueueBytes() const
+    {
+        return send_queued_bytes_;
+    }
+
+    /**
+     * 因超过SetSendQueueLimit而丢弃的字节数，需在poller线程中调用
+     */
+    uint64_t GetSendDroppedBytes() const
+    {
+        return send_dropped_bytes_;
+    }
+
+    /**
+     * 需在poller线程中调用
+     */
+    ZeroCopyStats GetZeroCopyStats() const
+    {
+        return zerocopy_stats_;
+    }
+
   public:
     // implement socket info interface
     std::string GetLocalIP() const override;
@@ -204,6 +380,13 @@ class Socket final : public std::enable_shared_from_this<Socket>,
 
     void on_connected(const SocketFD::Ptr& sockfd, const ErrorCB& cb);
     int  on_read(const SocketFD::Ptr& sockfd, bool is_udp);
+    int  on_read_batch(const SocketFD::Ptr& sockfd);
+    void alloc_recv_batch(uint32_t packet_size);
+    void on_read_segments(const Buffer::Ptr&      buffer,
+                          uint32_t                segment_size,
+                          sockaddr_storage*       addr,
+                          socklen_t               addr_len,
+                          std::vector<UdpPacket>* packets);
     void on_writeable(const SocketFD::Ptr& sockfd);
     bool on_error(const SocketFD::Ptr& sockfd);
     bool emit_error(const SocketException& err);
@@ -211,6 +394,29 @@ class Socket final : public std::enable_shared_from_this<Socket>,
     int  on_accept(const SocketFD::Ptr& sockfd, int event);
     bool listen(const SocketFD::Ptr& sockfd);
     int  send(const Buffer::Ptr& buf, sockaddr_storage* addr, socklen_t len);
+    int  send(std::vector<Buffer::Ptr>& bufs);
+    uint32_t get_send_chunk_size();
+    void     split_segments(const Buffer::Ptr&        buf,
+                            sockaddr_storage*         addr,
+                            socklen_t                 len,
+                            uint32_t                  chunk_size,
+                            std::vector<Buffer::Ptr>& bufs);
+    void apply_udp_options(const SocketFD::Ptr& sockfd);
+    ssize_t send_zerocopy(const BufferList::Ptr& pkt, int fd);
+    bool on_zerocopy_notify(const SocketFD::Ptr& sockfd);
+    void on_zerocopy_complete(uint32_t lo, uint32_t hi, bool copied);
+    void wait_send_source(const SocketFD::Ptr&   sockfd,
+                          const BufferList::Ptr& pkt);
+    void cancel_wait_send_source();
+    bool enqueue_send_buf(Buffer::Ptr buf);
+    bool enqueue_send_bufs(std::vector<Buffer::Ptr>& bufs);
+    bool check_send_limit(uint64_t size);
+    void push_send_buf(Buffer::Ptr&& buf);
+    void on_send_progress(uint64_t n);
+    void check_low_watermark();
+    // 返回false表示不再需要检查
+    bool check_send_timeout();
+    void on_watermark(bool high);
 
     static SocketException get_socket_error(const SocketFD::Ptr& sockfd,
                                             bool try_errno = true);
@@ -225,21 +431,76 @@ class Socket final : public std::enable_shared_from_this<Socket>,
 
     SocketFD::Ptr sockfd_;
 
-    BufferRaw::Ptr read_buf_ = nullptr;
+    // 读回调后保留的共用读缓冲交给调用者
+    bool read_buf_transfer_ = true;
+
+    // recvmmsg批量接收使用的预分配缓冲
+    uint32_t                      recv_batch_size_  = 0;
+    uint32_t                      recv_packet_size_ = 0;
+    std::vector<BufferRaw::Ptr>   recv_bufs_;
+    std::vector<mmsghdr>          recv_msgs_;
+    std::vector<iovec>            recv_iovs_;
+    std::vector<sockaddr_storage> recv_addrs_;
+    std::vector<UdpPacket>        recv_packets_;
+    // 每个包一个cmsg缓冲，用于取得UDP_GRO的分段大小
+    std::vector<char> recv_ctrls_;
+    bool              recv_gro_ = false;
+
+    // UDP分段发送，send_gso_表示由内核切分
+    uint16_t send_segment_size_ = 0;
+    bool     send_gso_          = false;
+
+    // 一次零拷贝发送占用的通知序号，全部完成后释放buffers
+    struct ZeroCopyPending
+    {
+        uint32_t        seqs;
+        uint32_t        remaining;
+        uint64_t        bytes;
+        bool            copied;
+        BufferList::Ptr buffers;
+    };
+
+    uint32_t zerocopy_threshold_ = 0;
+    // 内核已开启SO_ZEROCOPY
+    bool zerocopy_ = false;
+    // zerocopy_pending_队首的第一个通知序号
+    uint32_t                    zerocopy_seq_ = 0;
+    std::deque<ZeroCopyPending> zerocopy_pending_;
+    ZeroCopyStats               zerocopy_stats_;
 
     Ticker                send_flush_ticker_;
     List<BufferList::Ptr> send_buf_sending_;
     List<Buffer::Ptr>     send_buf_waiting_;
+    // send_flush_ticker_记录最近一次发送进展的时刻，用于发送超时检测
+    uint32_t send_timeout_ms_ = 0;
+    // 是否已加入poller的周期检查
+    bool send_sweeping_ = false;
+    // 正在等待可读的管道及其所在的BufferList，持有管道fd直到从poller中移除
+    int             send_wait_fd_ = -1;
+    BufferList::Ptr send_wait_pkt_;
+
+    // 发送队列的水位和上限
+    uint64_t              send_queued_bytes_   = 0;
+    uint64_t              send_dropped_bytes_  = 0;
+    uint64_t              send_low_watermark_  = 0;
+    uint64_t              send_high_watermark_ = 0;
+    uint64_t              send_queue_limit_    = 0;
+    bool                  send_overflow_close_ = false;
+    bool                  send_high_           = false;
+    WatermarkCB           watermark_cb_;
+    std::weak_ptr<Socket> backpressure_source_;
 
     bool sending_     = true;
     bool enable_recv_ = true;
 
-    ErrorCB   error_cb_;
-    FlushedCB flushed_cb_;
-    ReadCB    read_cb_;
-    AcceptCB  accept_cb_;
+    ErrorCB        error_cb_;
+    FlushedCB      flushed_cb_;
+    ReadCB         read_cb_;
+    BatchReadCB    batch_read_cb_;
+    AcceptCB       accept_cb_;
+    BeforeAcceptCB before_accept_cb_;
 
-    int socket_flags_;
+    int socket_flags_ = MSG_NOSIGNAL | MSG_DONTWAIT;
 };
 
 }  // namespace common_library
@@ -52,7 +52,17 @@ int SocketUtils::Connect(const char* host,
         return -1;
     }
 
-    bool is_ipv6 = (addr.ss_family == AF_INET6);
+    return Connect(addr, port, local_ip_or_intf, local_port, async);
+}
+
+int SocketUtils::Connect(const sockaddr_storage& peer_addr,
+                         uint16_t                port,
+                         const char*             local_ip_or_intf,
+                         uint16_t                local_port,
+                         bool                    async)
+{
+    sockaddr_storage addr    = peer_addr;
+    bool             is_ipv6 = (addr.ss_family == AF_INET6);
 
     int fd = CreateSocket(SOCK_TCP, is_ipv6);
     if (fd == -1) {
@@ -394,6 +404,43 @@ int SocketUtils::SetSendTimeout(int fd, int seconds)
     return ret;
 }
 
+int SocketUtils::SetUdpSegment(int fd, uint16_t segment_size)
+{
+    int opt = segment_size;
+
+    int ret = setsockopt(fd, SOL_UDP, UDP_SEGMENT, &opt, sizeof(opt));
+    if (ret == -1) {
+        LOG_W << "set UDP_SEGMENT failed. " << get_uv_errmsg() << " ,fd=" << fd
+              << " ,segment_size=" << segment_size;
+        return ret;
+    }
+    return ret;
+}
+
+int SocketUtils::SetUdpGRO(int fd, bool enable)
+{
+    int opt = enable;
+
+    int ret = setsockopt(fd, SOL_UDP, UDP_GRO, &opt, sizeof(opt));
+    if (ret == -1) {
+        LOG_W << "set UDP_GRO failed. " << get_uv_errmsg() << " ,fd=" << fd;
+        return ret;
+    }
+    return ret;
+}
+
+int SocketUtils::SetZeroCopy(int fd, bool enable)
+{
+    int opt = enable;
+
+    int ret = setsockopt(fd, SOL_SOCKET, SO_ZEROCOPY, &opt, sizeof(opt));
+    if (ret == -1) {
+        LOG_W << "set SO_ZEROCOPY failed. " << get_uv_errmsg() << " ,fd=" << fd;
+        return ret;
+    }
+    return ret;
+}
+
 std::string SocketUtils::GetIPFromAddr(sockaddr_storage* addr)
 {
     char buf[INET6_ADDRSTRLEN] = {0};
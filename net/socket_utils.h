@@ -1,12 +1,26 @@
 #ifndef COMMON_LIBRARY_SOCKET_UTILS_H
 #define COMMON_LIBRARY_SOCKET_UTILS_H
 
+#include <netinet/udp.h>
 #include <stdint.h>
 
 #include <string>
 
 #include <net/socket.h>
 
+// 旧版本glibc头文件中没有定义
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+
+#ifndef UDP_GRO
+#define UDP_GRO 104
+#endif
+
+#ifndef SO_ZEROCOPY
+#define SO_ZEROCOPY 60
+#endif
+
 struct sockaddr_storage;
 struct sockaddr;
 
@@ -22,6 +36,15 @@ class SocketUtils {
                        uint16_t    local_port = 0,
                        bool        async      = false);
 
+    /**
+     * 连接已解析的地址，addr中的端口被忽略
+     */
+    static int Connect(const sockaddr_storage& addr,
+                       uint16_t                port,
+                       const char*             local_ip   = "0.0.0.0",
+                       uint16_t                local_port = 0,
+                       bool                    async      = false);
+
     static int
     Bind(int fd, const char* local_ip, uint16_t port, bool is_ipv6 = false);
 
@@ -43,6 +66,22 @@ class SocketUtils {
 
     static int SetSendTimeout(int fd, int seconds = 10);
 
+    /**
+     * UDP_SEGMENT，发送大于segment_size的数据时由内核切分成多个数据报
+     * 0表示关闭，内核不支持时返回-1
+     */
+    static int SetUdpSegment(int fd, uint16_t segment_size);
+
+    /**
+     * UDP_GRO，内核将连续到达的同一来源的数据报合并后一次返回
+     */
+    static int SetUdpGRO(int fd, bool enable = true);
+
+    /**
+     * SO_ZEROCOPY，开启后sendmsg才能使用MSG_ZEROCOPY
+     */
+    static int SetZeroCopy(int fd, bool enable = true);
+
     static std::string GetIPFromAddr(sockaddr_storage* addr);
 
     static uint16_t GetPortFromAddr(sockaddr_storage* addr);
@@ -1,19 +1,33 @@
-#include <net/socket_utils.h>
 #include <poller/event_poller.h>
 #include <utils/time_ticker.h>
 #include <utils/utils.h>
 #include <utils/uv_error.h>
 
+#include <algorithm>
+#include <stdexcept>
+
 #include <sys/epoll.h>
+#include <sys/timerfd.h>
 #include <unistd.h>
 
 #define EPOLL_SIZE 1024  // 必须大于0
+#define LOAD_WINDOW_US (1000 * 1000)
+#define SPIN_BACKOFF_MIN_DIV 32
+// Sync检测互相等待时最多追踪的poller数
+#define SYNC_WAIT_CHAIN_MAX 64
+// 共用读缓冲的大小，UDP最大数据报和GRO合并包都不超过它
+#define SHARED_BUFFER_SIZE (128 * 1024)
 
 #define TO_EPOLL(event)                                                        \
     (((event)&PE_READ) ? EPOLLIN : 0) | (((event)&PE_WRITE) ? EPOLLOUT : 0) |  \
         (((event)&PE_ERROR) ? (EPOLLHUP | EPOLLERR) : 0) |                     \
         (((event)&PE_LT) ? 0 : EPOLLET)
 
+#define TO_EPOLL_DATA(fd, generation)                                          \
+    ((static_cast<uint64_t>(generation) << 32) | static_cast<uint32_t>(fd))
+#define EPOLL_DATA_FD(data) static_cast<int>((data)&0xFFFFFFFF)
+#define EPOLL_DATA_GENERATION(data) static_cast<uint32_t>((data) >> 32)
+
 #define TO_POLLER(epoll_event)                                                 \
     (((epoll_event)&EPOLLIN) ? PE_READ : 0) |                                  \
         (((epoll_event)&EPOLLOUT) ? PE_WRITE : 0) |                            \
@@ -22,20 +36,34 @@
 
 namespace common_library {
 
-EventPoller::EventPoller()
+// 当前线程正在运行的poller
+static thread_local EventPoller* s_current_poller = nullptr;
+
+void DelayTask::Cancel()
 {
-    // 将写设置为非阻塞，防止poller线程退出后，因写满缓存被永久阻塞
-    SocketUtils::SetNoBlocked(pipe_.WriteFD());
-    SocketUtils::SetNoBlocked(pipe_.ReadFD());
+    if (canceled_.exchange(true, std::memory_order_acq_rel)) {
+        return;
+    }
+
+    EventPoller::Ptr poller = poller_.lock();
+    if (!poller) {
+        return;
+    }
+
+    DelayTask::Ptr self = shared_from_this();
+    poller->PostFirst([poller, self]() { poller->remove_delay_task(self); });
+}
 
+EventPoller::EventPoller() : delay_wheel_(get_steady_milliseconds())
+{
     epoll_fd_ = epoll_create(EPOLL_SIZE);
     if (epoll_fd_ == -1) {
-        std::runtime_error(StringPrinter << "epoll create failed. "
-                                         << get_uv_errmsg());
+        throw std::runtime_error(StringPrinter << "epoll create failed. "
+                                               << get_uv_errmsg());
     }
 
-    if (AddEvent(pipe_.ReadFD(), PE_READ,
-                 [this](int event) { on_pipe_event(); }) == -1) {
+    if (add_event(notifier_.FD(), PE_READ,
+                  [this](int event) { on_notify_event(); }) == -1) {
         throw std::runtime_error(StringPrinter << "epoll add event failed. "
                                                << get_uv_errmsg());
     }
@@ -45,13 +73,36 @@ EventPoller::~EventPoller()
 {
     Shutdown();
 
+    // 退出前在当前线程执行剩余任务，其中的事件操作不再转交
+    loop_thread_id_.store(std::this_thread::get_id(),
+                          std::memory_order_release);
+    run_tasks();
+
     if (epoll_fd_ != -1) {
         ::close(epoll_fd_);
         epoll_fd_ = -1;
     }
 
-    // 退出前清空管道
-    on_pipe_event();
+    delay_wheel_.Clear([](TimingWheelNode* node) {
+        static_cast<DelayTask*>(node)->self_ = nullptr;
+    });
+    for (auto& pr : delay_map_us_) {
+        pr.second->in_map_ = false;
+    }
+    delay_map_us_.clear();
+
+    if (timer_fd_ != -1) {
+        ::close(timer_fd_);
+        timer_fd_ = -1;
+    }
+
+    TaskNode* node;
+    while ((node = task_queue_first_.Pop())) {
+        delete node;
+    }
+    while ((node = task_queue_.Pop())) {
+        delete node;
+    }
 }
 
 EventPoller::Ptr EventPoller::Create()
@@ -60,30 +111,87 @@ EventPoller::Ptr EventPoller::Create()
     return ptr;
 }
 
-Task::Ptr EventPoller::Async(TaskIn&& task)
+Task::Ptr EventPoller::Async(TaskIn&& task, bool may_sync)
+{
+    if (may_sync && IsCurrentThread()) {
+        task();
+        return nullptr;
+    }
+
+    Task::Ptr ptask = std::make_shared<Task>(std::move(task));
+    post([ptask]() { (*ptask)(); }, false);
+    return ptask;
+}
+
+Task::Ptr EventPoller::AsyncFirst(TaskIn&& task, bool may_sync)
+{
+    if (may_sync && IsCurrentThread()) {
+        task();
+        return nullptr;
+    }
+
+    Task::Ptr ptask = std::make_shared<Task>(std::move(task));
+    post([ptask]() { (*ptask)(); }, true);
+    return ptask;
+}
+
+void EventPoller::Post(SmallTask&& task)
 {
-    return async(std::move(task), false);
+    post(std::move(task), false);
 }
 
-Task::Ptr EventPoller::AsyncFirst(TaskIn&& task)
+void EventPoller::PostFirst(SmallTask&& task)
 {
-    return async(std::move(task), true);
+    post(std::move(task), true);
+}
+
+void EventPoller::Sync(TaskIn&& task)
+{
+    sync(std::move(task), false);
+}
+
+void EventPoller::SyncFirst(TaskIn&& task)
+{
+    sync(std::move(task), true);
+}
+
+bool EventPoller::IsCurrentThread()
+{
+    return loop_thread_id_.load(std::memory_order_acquire) ==
+           std::this_thread::get_id();
 }
 
 int EventPoller::AddEvent(int fd, int event, PollEventCB&& cb)
 {
-    TimeTicker();
-    if (!cb) {
+    if (!cb || fd < 0) {
         return -1;
     }
 
+    return run_event_op([this, fd, event, &cb]() {
+        return add_event(fd, event, std::move(cb));
+    });
+}
+
+int EventPoller::add_event(int fd, int event, PollEventCB&& cb)
+{
+    TimeTicker();
+
+    if (static_cast<size_t>(fd) >= event_slots_.size()) {
+        event_slots_.resize(std::max<size_t>(fd + 1, event_slots_.size() * 2));
+    }
+
+    EventSlot& slot       = event_slots_[fd];
+    uint32_t   generation = slot.generation + 1;
+
     struct epoll_event ev = {0};
     ev.events             = TO_EPOLL(event);
-    ev.data.fd            = fd;
+    ev.data.u64           = TO_EPOLL_DATA(fd, generation);
 
     int ret = epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &ev);
     if (ret == 0) {
-        event_map_.emplace(fd, std::make_shared<PollEventCB>(cb));
+        release_event_cb(slot);
+        slot.cb.reset(new PollEventCB(std::move(cb)));
+        slot.generation = generation;
     }
     else {
         LOG_E << "poller add event failed. " << get_uv_errmsg();
@@ -100,10 +208,19 @@ int EventPoller::DelEvent(int fd, PollDelCB&& cb)
         cb = [](bool success) {};
     }
 
+    if (!IsCurrentThread()) {
+        return run_event_op(
+            [this, fd, &cb]() { return DelEvent(fd, std::move(cb)); });
+    }
+
     bool success = true;
-    if (event_map_.count(fd)) {
-        success = epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr) == 0 &&
-                  event_map_.erase(fd);
+    if (fd >= 0 && static_cast<size_t>(fd) < event_slots_.size() &&
+        event_slots_[fd].cb) {
+        EventSlot& slot = event_slots_[fd];
+        success = epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr) == 0;
+        // 递增generation，本轮已取出的该fd事件将被忽略
+        ++slot.generation;
+        release_event_cb(slot);
         cb(success);
     }
     return success ? 0 : -1;
@@ -113,20 +230,72 @@ int EventPoller::ModifyEvent(int fd, int event)
 {
     TimeTicker();
 
+    if (!IsCurrentThread()) {
+        return run_event_op(
+            [this, fd, event]() { return ModifyEvent(fd, event); });
+    }
+
+    if (fd < 0 || static_cast<size_t>(fd) >= event_slots_.size() ||
+        !event_slots_[fd].cb) {
+        return -1;
+    }
+
     struct epoll_event ev;
-    ev.events  = TO_EPOLL(event);
-    ev.data.fd = fd;
-    // epoll线程安全
+    ev.events   = TO_EPOLL(event);
+    ev.data.u64 = TO_EPOLL_DATA(fd, event_slots_[fd].generation);
     return epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, fd, &ev);
 }
 
+int EventPoller::run_event_op(std::function<int()>&& op)
+{
+    // 事件循环尚未运行或已经退出，没有其他线程访问事件表
+    if (IsCurrentThread() ||
+        loop_thread_id_.load(std::memory_order_acquire) == std::thread::id()) {
+        return op();
+    }
+
+    int ret = -1;
+    try {
+        sync([&ret, &op]() { ret = op(); }, false);
+    }
+    catch (std::exception& e) {
+        // 与当前poller线程互相等待，只能转交执行
+        LOG_W << e.what() << ", event operation deferred";
+        std::shared_ptr<std::function<int()>> pop =
+            std::make_shared<std::function<int()>>(std::move(op));
+        post([pop]() { (*pop)(); }, false);
+        ret = 0;
+    }
+    return ret;
+}
+
 DelayTask::Ptr EventPoller::DoDelayTask(uint64_t                    delay_ms,
                                         std::function<uint64_t()>&& task)
 {
-    DelayTask::Ptr ret      = std::make_shared<DelayTask>(std::move(task));
-    uint64_t       timeline = delay_ms + get_current_milliseconds();
-    AsyncFirst(
-        [this, timeline, ret]() { delay_tasks_.emplace(timeline, ret); });
+    DelayTask::Ptr ret =
+        std::make_shared<DelayTask>(shared_from_this(), std::move(task));
+    uint64_t timeline = delay_ms + get_steady_milliseconds();
+    PostFirst([this, timeline, ret]() {
+        if (*ret) {
+            ret->self_ = ret;
+            delay_wheel_.Add(ret.get(), timeline);
+        }
+    });
+    return ret;
+}
+
+DelayTask::Ptr EventPoller::DoDelayTaskUS(uint64_t                    delay_us,
+                                          std::function<uint64_t()>&& task)
+{
+    DelayTask::Ptr ret =
+        std::make_shared<DelayTask>(shared_from_this(), std::move(task));
+    ret->high_res_    = true;
+    uint64_t timeline = delay_us + get_steady_microseconds();
+    PostFirst([this, timeline, ret]() {
+        if (*ret) {
+            add_delay_task_us(ret, timeline);
+        }
+    });
     return ret;
 }
 
@@ -135,30 +304,63 @@ void EventPoller::RunLoop()
     set_thread_name("poller");
     set_thread_priority(TPRIORITY_HIGHEST);
 
-    exit_flag_ = false;
+    exit_flag_       = false;
+    last_wakeup_us_  = get_current_microseconds();
+    window_begin_us_ = last_wakeup_us_;
+
+    loop_thread_id_.store(std::this_thread::get_id(),
+                          std::memory_order_release);
+    s_current_poller = this;
 
     uint64_t           delay_ms;
+    int                timeout;
+    bool               active = false;
     struct epoll_event events[EPOLL_SIZE];
     while (!exit_flag_) {
         delay_ms = get_min_delay_ms();
-        int n =
-            epoll_wait(epoll_fd_, events, EPOLL_SIZE, delay_ms ? delay_ms : -1);
-        if (n <= 0) {
-            // 超时或被中断
-            continue;
+        // poller线程自己投递的任务不会写eventfd，此时不能阻塞等待
+        timeout = has_pending_tasks() ? 0 : (delay_ms ? delay_ms : -1);
+        start_sleep();
+        int n = 0;
+        if (active && timeout != 0) {
+            // 上一轮有事件处理，先自旋轮询一段时间再进入阻塞等待
+            n = busy_poll(events, EPOLL_SIZE, timeout);
+        }
+        if (n <= 0 && !has_pending_tasks()) {
+            n = epoll_wait(epoll_fd_, events, EPOLL_SIZE, timeout);
+        }
+        sleep_wakeup();
+        active = n > 0;
+
+        loop_iterations_.fetch_add(1, std::memory_order_relaxed);
+        if (n >= 0) {
+            events_per_wait_.Record(n);
+            events_total_.fetch_add(n, std::memory_order_relaxed);
         }
+        bool     timing = stats_enabled_.load(std::memory_order_relaxed);
+        uint64_t begin_us;
 
+        dispatching_ = true;
         for (int i = 0; i < n; ++i) {
             struct epoll_event& event = events[i];
-            int                 fd    = event.data.fd;
-            std::unordered_map<int, std::shared_ptr<PollEventCB>>::iterator it =
-                event_map_.find(fd);
-            if (it == event_map_.end()) {
+            int                 fd    = EPOLL_DATA_FD(event.data.u64);
+            if (static_cast<size_t>(fd) >= event_slots_.size() ||
+                !event_slots_[fd].cb) {
                 epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
                 continue;
             }
 
-            std::shared_ptr<PollEventCB> cb = it->second;
+            EventSlot& slot = event_slots_[fd];
+            if (slot.generation != EPOLL_DATA_GENERATION(event.data.u64)) {
+                // fd在本轮中已被删除并重新注册，事件已过期
+                continue;
+            }
+
+            // 回调中可能删除或替换自身，被替换的回调延迟到本轮结束后释放
+            PollEventCB* cb = slot.cb.get();
+            if (timing) {
+                begin_us = get_steady_microseconds();
+            }
             try {
                 (*cb)(TO_POLLER(event.events));
             }
@@ -167,33 +369,226 @@ void EventPoller::RunLoop()
                          "event handler. "
                       << e.what();
             }
+            if (timing) {
+                event_cb_us_.Record(get_steady_microseconds() - begin_us);
+            }
+        }
+        dispatching_ = false;
+        event_cb_trash_.clear();
+
+        if (has_pending_tasks()) {
+            run_tasks();
+            active = true;
         }
     }
+
+    // 退出后事件操作在调用线程直接执行，不再等待poller线程
+    s_current_poller = nullptr;
+    loop_thread_id_.store(std::thread::id(), std::memory_order_release);
 }
 
 void EventPoller::Shutdown()
 {
-    async([]() { throw ExitException(); }, true);
+    post([]() { throw ExitException(); }, true);
 }
 
-inline void EventPoller::on_pipe_event()
+void EventPoller::SetBusyPoll(uint64_t spin_us)
+{
+    spin_budget_us_.store(spin_us, std::memory_order_relaxed);
+}
+
+uint64_t EventPoller::GetSpinHits()
+{
+    return spin_hits_.load(std::memory_order_relaxed);
+}
+
+uint64_t EventPoller::GetSpinMisses()
+{
+    return spin_misses_.load(std::memory_order_relaxed);
+}
+
+uint64_t EventPoller::GetSpinCpuTimeUS()
+{
+    return spin_cpu_us_.load(std::memory_order_relaxed);
+}
+
+EventPoller::Stats EventPoller::GetStats()
+{
+    Stats stats;
+    stats.loop_iterations    = loop_iterations_.load(std::memory_order_relaxed);
+    stats.events             = events_total_.load(std::memory_order_relaxed);
+    stats.tasks              = tasks_total_.load(std::memory_order_relaxed);
+    stats.queue_depth        = task_queue_first_.Size() + task_queue_.Size();
+    stats.wakeups_sent       = GetWakeupsSent();
+    stats.wakeups_suppressed = GetWakeupsSuppressed();
+    stats.spin_hits          = GetSpinHits();
+    stats.spin_misses        = GetSpinMisses();
+    stats.spin_cpu_us        = GetSpinCpuTimeUS();
+    stats.load               = GetLoad();
+    stats.events_per_wait    = events_per_wait_.GetSnapshot();
+    stats.tasks_per_drain    = tasks_per_drain_.GetSnapshot();
+    stats.queue_delay_us     = queue_delay_us_.GetSnapshot();
+    stats.event_cb_us        = event_cb_us_.GetSnapshot();
+    stats.task_us            = task_us_.GetSnapshot();
+    stats.delay_task_us      = delay_task_us_.GetSnapshot();
+    stats.timer_late_ms      = timer_late_ms_.GetSnapshot();
+    stats.timer_late_us      = timer_late_us_.GetSnapshot();
+    return stats;
+}
+
+void EventPoller::EnableStats(bool enable)
+{
+    stats_enabled_.store(enable, std::memory_order_relaxed);
+}
+
+const BufferRaw::Ptr& EventPoller::GetSharedBuffer()
+{
+    if (!shared_buffer_) {
+        shared_buffer_ = std::make_shared<BufferRaw>(SHARED_BUFFER_SIZE);
+    }
+    return shared_buffer_;
+}
+
+void EventPoller::DetachSharedBuffer()
+{
+    shared_buffer_ = nullptr;
+}
+
+void EventPoller::AddSweep(PollSweepCB&& cb)
+{
+    sweep_cbs_.emplace_back(std::move(cb));
+    if (sweep_timer_) {
+        return;
+    }
+
+    // 定时器由本poller持有，捕获this是安全的
+    sweep_timer_ = DoDelayTask(POLLER_SWEEP_MS, [this]() { return sweep(); });
+}
+
+uint64_t EventPoller::sweep()
+{
+    // 回调中可能再次AddSweep，先移出再执行
+    std::vector<PollSweepCB> cbs;
+    cbs.swap(sweep_cbs_);
+    for (auto& cb : cbs) {
+        if (cb()) {
+            sweep_cbs_.emplace_back(std::move(cb));
+        }
+    }
+
+    if (sweep_cbs_.empty()) {
+        sweep_timer_ = nullptr;
+        return 0;
+    }
+    return POLLER_SWEEP_MS;
+}
+
+void EventPoller::on_notify_event()
+{
+    notifier_.Read();
+    // 必须在处理任务之前清除标记，之后投递的任务会重新唤醒
+    // 使用exchange与生产者的exchange同步，保证能看到其入队的任务
+    notified_.exchange(false, std::memory_order_acq_rel);
+}
+
+void EventPoller::release_event_cb(EventSlot& slot)
+{
+    if (!slot.cb) {
+        return;
+    }
+
+    if (dispatching_) {
+        event_cb_trash_.emplace_back(std::move(slot.cb));
+    }
+    else {
+        slot.cb.reset();
+    }
+}
+
+void EventPoller::run_tasks()
 {
     TimeTicker();
 
-    char buf[1024];
+    // 每条队列只处理本次唤醒前已入队的任务，任务中再次投递的任务留到下一轮
+    uint64_t count = drain_tasks(task_queue_first_);
+    count += drain_tasks(task_queue_);
 
-    do {
-        // 清空pipe
-        if (pipe_.Read(buf, sizeof(buf)) > 0) {
-            continue;
+    tasks_per_drain_.Record(count);
+    tasks_total_.fetch_add(count, std::memory_order_relaxed);
+}
+
+bool EventPoller::has_pending_tasks()
+{
+    return !task_queue_first_.Empty() || !task_queue_.Empty();
+}
+
+void EventPoller::sync(TaskIn&& task, bool first)
+{
+    if (!task) {
+        return;
+    }
+
+    if (IsCurrentThread()) {
+        task();
+        return;
+    }
+
+    // 当前线程是某个poller时，记录等待关系并检查是否形成环
+    EventPoller* self = s_current_poller;
+    if (self) {
+        self->sync_waiting_on_.store(this, std::memory_order_seq_cst);
+
+        EventPoller* poller = this;
+        for (int i = 0; poller && i < SYNC_WAIT_CHAIN_MAX; i++) {
+            if (poller == self) {
+                break;
+            }
+            poller = poller->sync_waiting_on_.load(std::memory_order_seq_cst);
+        }
+
+        if (poller) {
+            self->sync_waiting_on_.store(nullptr, std::memory_order_seq_cst);
+            throw std::runtime_error("event poller sync deadlock detected");
+        }
+    }
+
+    Semaphore sem;
+    post(
+        [&task, &sem]() {
+            // 任务抛出异常时也要唤醒等待者
+            OnceToken token(nullptr, [&sem]() { sem.Post(); });
+            task();
+        },
+        first);
+    sem.Wait();
+
+    if (self) {
+        self->sync_waiting_on_.store(nullptr, std::memory_order_seq_cst);
+    }
+}
+
+uint64_t EventPoller::drain_tasks(MpscQueue<TaskNode>& queue)
+{
+    uint64_t  count     = queue.Size();
+    uint64_t  executed  = 0;
+    bool      timing    = stats_enabled_.load(std::memory_order_relaxed);
+    uint64_t  begin_us  = 0;
+    TaskNode* node;
+    TaskNode* free_head = nullptr;
+    TaskNode* free_tail = nullptr;
+    uint64_t  free_num  = 0;
+
+    while (count-- && (node = queue.Pop())) {
+        ++executed;
+        if (timing) {
+            begin_us = get_steady_microseconds();
+            if (node->enqueue_us) {
+                queue_delay_us_.Record(begin_us - node->enqueue_us);
+            }
         }
-    } while (get_uv_error() != EAGAIN);
 
-    List<Task::Ptr> swap_list;
-    swap_list.swap(task_list_);
-    swap_list.for_each([&](const Task::Ptr& f) {
         try {
-            (*f)();
+            node->task();
         }
         catch (ExitException& e) {
             exit_flag_ = true;
@@ -202,7 +597,25 @@ inline void EventPoller::on_pipe_event()
             LOG_E << "event poller caught an exception while executing task. "
                   << e.what();
         }
-    });
+
+        if (timing) {
+            task_us_.Record(get_steady_microseconds() - begin_us);
+        }
+
+        node->task.Reset();
+        node->free_next = free_head;
+        free_head       = node;
+        ++free_num;
+        if (!free_tail) {
+            free_tail = node;
+        }
+    }
+
+    if (free_head) {
+        TaskNodePool::Free(free_head, free_tail, free_num);
+    }
+
+    return executed;
 }
 
 bool EventPoller::IsClose()
@@ -210,37 +623,126 @@ bool EventPoller::IsClose()
     return exit_flag_;
 }
 
-uint64_t EventPoller::get_min_delay_ms()
+int EventPoller::GetLoad()
 {
-    std::multimap<uint64_t, DelayTask::Ptr>::iterator it = delay_tasks_.begin();
+    if (sleeping_.load(std::memory_order_acquire) &&
+        get_current_microseconds() -
+                sleep_begin_us_.load(std::memory_order_relaxed) >=
+            LOAD_WINDOW_US) {
+        // 已经空闲了一个完整的统计窗口
+        return 0;
+    }
+    return load_.load(std::memory_order_relaxed);
+}
 
-    if (it == delay_tasks_.end()) {
+uint64_t EventPoller::GetWakeupsSent()
+{
+    return wakeups_sent_.load(std::memory_order_relaxed);
+}
+
+uint64_t EventPoller::GetWakeupsSuppressed()
+{
+    return wakeups_suppressed_.load(std::memory_order_relaxed);
+}
+
+void EventPoller::start_sleep()
+{
+    uint64_t now = get_current_microseconds();
+    busy_us_ += now - last_wakeup_us_;
+
+    if (now - window_begin_us_ >= LOAD_WINDOW_US) {
+        load_.store(static_cast<int>(busy_us_ * 100 / (now - window_begin_us_)),
+                    std::memory_order_relaxed);
+        busy_us_         = 0;
+        window_begin_us_ = now;
+    }
+
+    sleep_begin_us_.store(now, std::memory_order_relaxed);
+    sleeping_.store(true, std::memory_order_release);
+}
+
+void EventPoller::sleep_wakeup()
+{
+    sleeping_.store(false, std::memory_order_release);
+    last_wakeup_us_ = get_current_microseconds();
+}
+
+int EventPoller::busy_poll(struct epoll_event* events, int max, int timeout)
+{
+    uint64_t budget = spin_budget_us_.load(std::memory_order_relaxed);
+    if (budget == 0) {
         return 0;
     }
 
-    uint64_t now = get_current_milliseconds();
-    if (it->first > now) {
-        return it->first - now;
+    // 配置变化或者首次自旋时从完整预算开始
+    if (spin_current_us_ == 0 || spin_current_us_ > budget) {
+        spin_current_us_ = budget;
+    }
+
+    uint64_t limit = spin_current_us_;
+    if (timeout > 0) {
+        // 不能因为自旋推迟定时任务
+        limit = std::min<uint64_t>(limit, timeout * 1000ULL);
     }
 
-    return flush_delay_tasks(now);
+    uint64_t cpu_begin = get_thread_cpu_microseconds();
+    uint64_t begin     = get_steady_microseconds();
+    int      n;
+    do {
+        n = epoll_wait(epoll_fd_, events, max, 0);
+        if (n != 0 || has_pending_tasks()) {
+            break;
+        }
+    } while (get_steady_microseconds() - begin < limit);
+    spin_cpu_us_.fetch_add(get_thread_cpu_microseconds() - cpu_begin,
+                           std::memory_order_relaxed);
+
+    if (n > 0 || has_pending_tasks()) {
+        spin_hits_.fetch_add(1, std::memory_order_relaxed);
+        spin_current_us_ = budget;
+    }
+    else {
+        // 自旋落空时减半，下限为预算的1/SPIN_BACKOFF_MIN_DIV
+        spin_misses_.fetch_add(1, std::memory_order_relaxed);
+        spin_current_us_ = std::max<uint64_t>(
+            spin_current_us_ / 2,
+            std::max<uint64_t>(budget / SPIN_BACKOFF_MIN_DIV, 1));
+    }
+
+    return n;
+}
+
+uint64_t EventPoller::get_min_delay_ms()
+{
+    if (delay_wheel_.Empty()) {
+        return 0;
+    }
+
+    uint64_t now = get_steady_milliseconds();
+    flush_delay_tasks(now);
+
+    return delay_wheel_.NextTimeoutMS(now);
 }
 
-uint64_t EventPoller::flush_delay_tasks(uint64_t now)
+void EventPoller::flush_delay_tasks(uint64_t now)
 {
-    std::multimap<uint64_t, DelayTask::Ptr> delay_tasks_copy;
-    delay_tasks_copy.swap(delay_tasks_);
+    bool timing = stats_enabled_.load(std::memory_order_relaxed);
+    delay_wheel_.Advance(now, [&](TimingWheelNode* node) {
+        timer_late_ms_.Record(now - node->ExpireMS());
 
-    for (std::multimap<uint64_t, DelayTask::Ptr>::iterator it =
-             delay_tasks_copy.begin();
-         it != delay_tasks_copy.end() && it->first <= now;
-         it = delay_tasks_copy.erase(it)) {
+        // 取回时间轮持有的引用，执行期间保证任务有效
+        DelayTask::Ptr task = std::move(static_cast<DelayTask*>(node)->self_);
+        uint64_t       begin_us = timing ? get_steady_microseconds() : 0;
         try {
-            // 执行已到期任务，并将循环定时任务再次放入队列
-            uint64_t next_delay = (*(it->second))();
-            if (next_delay > 0) {
-                delay_tasks_copy.emplace(next_delay + now,
-                                         std::move(it->second));
+            // 执行已到期任务，并将循环定时任务再次放入时间轮
+            uint64_t next_delay = (*task)();
+            if (timing) {
+                delay_task_us_.Record(get_steady_microseconds() - begin_us);
+            }
+            if (next_delay > 0 && *task) {
+                task->self_ = task;
+                delay_wheel_.Add(node, next_delay + now);
+                return;
             }
         }
         catch (std::exception& e) {
@@ -248,37 +750,143 @@ uint64_t EventPoller::flush_delay_tasks(uint64_t now)
                      "task. "
                   << e.what();
         }
-    }
+        task->task_ = nullptr;
+    });
+}
 
-    // @warning 这句不需要？因为只有poll线程会操作这个delay_tasks_
-    // delay_tasks_copy.insert(delay_tasks_.begin(), delay_tasks_.end());
-    delay_tasks_copy.swap(delay_tasks_);
+void EventPoller::remove_delay_task(const DelayTask::Ptr& task)
+{
+    if (task->high_res_) {
+        if (task->in_map_) {
+            delay_map_us_.erase(task->map_it_);
+            task->in_map_ = false;
+            update_timer();
+        }
+    }
+    else {
+        delay_wheel_.Remove(task.get());
+    }
+    task->task_ = nullptr;
+    task->self_ = nullptr;
+}
 
-    std::multimap<uint64_t, DelayTask::Ptr>::iterator it = delay_tasks_.begin();
-    if (it == delay_tasks_.end()) {
-        return 0;
+void EventPoller::add_delay_task_us(const DelayTask::Ptr& task,
+                                    uint64_t              expire_us)
+{
+    if (timer_fd_ == -1) {
+        timer_fd_ =
+            timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        if (timer_fd_ == -1) {
+            LOG_E << "timerfd create failed. " << get_uv_errmsg();
+            return;
+        }
+        if (add_event(timer_fd_, PE_READ,
+                      [this](int event) { on_timer_event(); }) == -1) {
+            ::close(timer_fd_);
+            timer_fd_ = -1;
+            return;
+        }
     }
 
-    return it->first - now;
+    task->map_it_ = delay_map_us_.emplace(expire_us, task);
+    task->in_map_ = true;
+    update_timer();
 }
 
-Task::Ptr EventPoller::async(TaskIn&& task, bool first)
+void EventPoller::flush_delay_tasks_us(uint64_t now_us)
 {
-    TimeTicker();
+    bool timing = stats_enabled_.load(std::memory_order_relaxed);
+    while (!delay_map_us_.empty() && delay_map_us_.begin()->first <= now_us) {
+        auto           it     = delay_map_us_.begin();
+        uint64_t       expire = it->first;
+        DelayTask::Ptr task   = std::move(it->second);
+        delay_map_us_.erase(it);
+        task->in_map_ = false;
 
-    Task::Ptr ptask = std::make_shared<Task>(std::move(task));
-    {
-        if (first) {
-            task_list_.emplace_front(ptask);
+        timer_late_us_.Record(now_us - expire);
+
+        uint64_t begin_us = timing ? get_steady_microseconds() : 0;
+        try {
+            uint64_t next_delay = (*task)();
+            if (timing) {
+                delay_task_us_.Record(get_steady_microseconds() - begin_us);
+            }
+            if (next_delay > 0 && *task) {
+                task->map_it_ =
+                    delay_map_us_.emplace(next_delay + now_us, task);
+                task->in_map_ = true;
+                continue;
+            }
         }
-        else {
-            task_list_.emplace_back(ptask);
+        catch (std::exception& e) {
+            LOG_E << "event poller caught an exception while executing delay "
+                     "task. "
+                  << e.what();
         }
+        task->task_ = nullptr;
+    }
+}
+
+void EventPoller::on_timer_event()
+{
+    uint64_t expirations;
+    while (::read(timer_fd_, &expirations, sizeof(expirations)) == -1 &&
+           get_uv_error() == EINTR) {
     }
 
-    pipe_.Write("", 1);
+    // 已触发，需要重新设置
+    timer_armed_us_ = 0;
+    flush_delay_tasks_us(get_steady_microseconds());
+    update_timer();
+}
 
-    return ptask;
+void EventPoller::update_timer()
+{
+    if (timer_fd_ == -1) {
+        return;
+    }
+
+    uint64_t expire_us =
+        delay_map_us_.empty() ? 0 : delay_map_us_.begin()->first;
+    if (expire_us == timer_armed_us_) {
+        return;
+    }
+
+    // 绝对时间为0时取消定时
+    struct itimerspec spec = {{0, 0}, {0, 0}};
+    spec.it_value.tv_sec   = expire_us / 1000000;
+    spec.it_value.tv_nsec  = (expire_us % 1000000) * 1000;
+    if (timerfd_settime(timer_fd_, TFD_TIMER_ABSTIME, &spec, nullptr) == -1) {
+        LOG_E << "timerfd settime failed. " << get_uv_errmsg();
+        return;
+    }
+    timer_armed_us_ = expire_us;
+}
+
+void EventPoller::post(SmallTask&& task, bool first)
+{
+    // 投递是O(1)操作，不使用TimeTicker，其LogContext每次都会分配内存
+    TaskNode* node   = TaskNodePool::Alloc();
+    node->task       = std::move(task);
+    node->enqueue_us = stats_enabled_.load(std::memory_order_relaxed) ?
+                           get_steady_microseconds() :
+                           0;
+    if (first) {
+        task_queue_first_.Push(node);
+    }
+    else {
+        task_queue_.Push(node);
+    }
+
+    if (IsCurrentThread() ||
+        notified_.exchange(true, std::memory_order_acq_rel)) {
+        // poller线程会在本轮循环结束前处理，或者已有未处理的唤醒
+        wakeups_suppressed_.fetch_add(1, std::memory_order_relaxed);
+    }
+    else {
+        notifier_.Write();
+        wakeups_sent_.fetch_add(1, std::memory_order_relaxed);
+    }
 }
 
 }  // namespace common_library
\ No newline at end of file
@@ -1,13 +1,27 @@
 #ifndef COMMON_LIBRARY_EVENT_POLLER_H
 #define COMMON_LIBRARY_EVENT_POLLER_H
 
-#include <poller/pipe_wrapper.h>
+#include <net/buffer.h>
+#include <poller/eventfd_wrapper.h>
+#include <poller/timing_wheel.h>
 #include <thread/task.h>
+#include <thread/mpsc_queue.h>
+#include <thread/node_pool.h>
 #include <thread/task_executor.h>
+#include <utils/histogram.h>
 #include <utils/list.h>
 #include <utils/utils.h>
 
-#include <unordered_map>
+#include <atomic>
+#include <map>
+#include <thread>
+#include <vector>
+
+#include <sys/epoll.h>
+
+#define POLLER_SWEEP_MS 1000
+// 任务节点全局空闲链表缓存的节点数上限，超过后归还的节点直接释放
+#define POLLER_TASK_NODE_FREE_MAX 8192
 
 namespace common_library {
 
@@ -18,33 +32,155 @@ typedef enum {
     PE_LT    = 1 << 3
 } PollEvent;
 
-typedef std::function<void(int event)>     PollEventCB;
-typedef std::function<void(bool success)>  PollDelCB;
-typedef TaskCancelableImpl<uint64_t(void)> DelayTask;
+typedef std::function<void(int event)>    PollEventCB;
+typedef std::function<void(bool success)> PollDelCB;
+// 返回false表示不再需要检查
+typedef std::function<bool()>             PollSweepCB;
+
+class EventPoller;
+
+/**
+ * 延时任务，返回值大于0时表示再过多少毫秒(高精度任务为微秒)后再次执行
+ */
+class DelayTask final : public TaskCancelable,
+                        public TimingWheelNode,
+                        public std::enable_shared_from_this<DelayTask> {
+  public:
+    friend class EventPoller;
+    typedef std::shared_ptr<DelayTask> Ptr;
+
+    template <typename Func>
+    DelayTask(const std::weak_ptr<EventPoller>& poller, Func&& f)
+        : task_(std::forward<Func>(f)), poller_(poller)
+    {
+    }
+
+    ~DelayTask() = default;
+
+  public:
+    /**
+     * 可在任意线程调用，任务会在poller线程中立即从时间轮移除
+     */
+    void Cancel() override;
+
+    // return cancelable
+    operator bool()
+    {
+        return !canceled_.load(std::memory_order_acquire);
+    }
+
+    uint64_t operator()()
+    {
+        if (canceled_.load(std::memory_order_acquire) || !task_) {
+            return 0;
+        }
+        return task_();
+    }
+
+  private:
+    std::function<uint64_t()>  task_;
+    std::weak_ptr<EventPoller> poller_;
+    std::atomic<bool>          canceled_{false};
+    // 位于时间轮中时持有自身，保证节点有效
+    DelayTask::Ptr self_;
+
+    // 高精度任务不使用时间轮，保存在按微秒排序的multimap中
+    bool                                               high_res_ = false;
+    bool                                               in_map_   = false;
+    std::multimap<uint64_t, DelayTask::Ptr>::iterator map_it_;
+};
 
 class EventPoller final : public TaskExecutor,
                           public std::enable_shared_from_this<EventPoller> {
   public:
     typedef std::shared_ptr<EventPoller> Ptr;
+
+    /**
+     * 运行统计快照，耗时类直方图需要EnableStats(true)后才会记录
+     */
+    struct Stats
+    {
+        uint64_t loop_iterations    = 0;
+        // 累计分发的事件数
+        uint64_t events             = 0;
+        // 累计执行的任务数
+        uint64_t tasks              = 0;
+        // 当前待执行的任务数
+        uint64_t queue_depth        = 0;
+        uint64_t wakeups_sent       = 0;
+        uint64_t wakeups_suppressed = 0;
+        uint64_t spin_hits          = 0;
+        uint64_t spin_misses        = 0;
+        uint64_t spin_cpu_us        = 0;
+        int      load               = 0;
+
+        // 每次等待返回的事件数
+        Histogram::Snapshot events_per_wait;
+        // 每次唤醒执行的任务数
+        Histogram::Snapshot tasks_per_drain;
+        // 任务从投递到开始执行的时间(微秒)
+        Histogram::Snapshot queue_delay_us;
+        // 事件回调执行时间(微秒)
+        Histogram::Snapshot event_cb_us;
+        // 任务执行时间(微秒)
+        Histogram::Snapshot task_us;
+        // 延时任务执行时间(微秒)
+        Histogram::Snapshot delay_task_us;
+        // 延时任务实际执行时刻与计划时刻的差值(毫秒)
+        Histogram::Snapshot timer_late_ms;
+        // 高精度延时任务实际执行时刻与计划时刻的差值(微秒)
+        Histogram::Snapshot timer_late_us;
+    };
+
     ~EventPoller();
 
     static EventPoller::Ptr Create();
 
   public:
-    Task::Ptr Async(TaskIn&& task) override;
+    Task::Ptr Async(TaskIn&& task, bool may_sync = true) override;
+
+    Task::Ptr AsyncFirst(TaskIn&& task, bool may_sync = true) override;
+
+    void Post(SmallTask&& task) override;
 
-    Task::Ptr AsyncFirst(TaskIn&& task) override;
+    void PostFirst(SmallTask&& task) override;
+
+    /**
+     * 在poller线程中执行任务并等待其完成，在poller线程中调用时直接执行
+     * 多个poller线程互相Sync形成环时抛出std::runtime_error而不是死锁
+     */
+    void Sync(TaskIn&& task);
+
+    void SyncFirst(TaskIn&& task);
+
+    bool IsCurrentThread();
 
   public:
+    /**
+     * 以下三个接口在其他线程调用时等待poller线程执行完成，返回值与直接调用相同
+     * RunLoop开始前或退出后在调用线程直接执行
+     * 与调用线程所在的poller互相等待时改为转交执行并返回0，失败只记录日志
+     */
     int AddEvent(int fd, int event, PollEventCB&& cb);
 
     int DelEvent(int fd, PollDelCB&& cb = nullptr);
 
     int ModifyEvent(int fd, int event);
 
+    /**
+     * 毫秒精度的延时任务，由时间轮管理，使用单调时钟
+     */
     DelayTask::Ptr DoDelayTask(uint64_t                    delay_ms,
                                std::function<uint64_t()>&& task);
 
+    /**
+     * 微秒精度的延时任务，由timerfd(CLOCK_MONOTONIC)唤醒
+     * task返回值为下次执行的微秒延时
+     * 最早到期时刻变化时需要重设timerfd，开销高于DoDelayTask
+     */
+    DelayTask::Ptr DoDelayTaskUS(uint64_t                    delay_us,
+                                 std::function<uint64_t()>&& task);
+
     /**
      * 执行事件循环
      */
@@ -58,7 +194,75 @@ class EventPoller final : public TaskExecutor,
 
     bool IsClose();
 
+    /**
+     * 获取poller线程负载(0~100)
+     * 由最近统计窗口内的忙碌时间/(忙碌时间+等待事件时间)计算
+     */
+    int GetLoad();
+
+    /**
+     * 跨线程投递任务时实际写eventfd的次数
+     */
+    uint64_t GetWakeupsSent();
+
+    /**
+     * 因已有未处理的唤醒或在poller线程内投递而省略的唤醒次数
+     */
+    uint64_t GetWakeupsSuppressed();
+
+    /**
+     * 设置自旋轮询预算(微秒)，0表示关闭，可在任意线程调用
+     * 处理过事件后先以0超时轮询至多spin_us，仍无事件才进入阻塞等待
+     * 连续落空时自旋时长逐次减半，命中后恢复完整预算，自旋时间不计入负载
+     */
+    void SetBusyPoll(uint64_t spin_us);
+
+    /**
+     * 自旋期间等到事件或任务的次数
+     */
+    uint64_t GetSpinHits();
+
+    /**
+     * 自旋耗尽预算仍无事件的次数
+     */
+    uint64_t GetSpinMisses();
+
+    /**
+     * 自旋累计消耗的cpu时间(微秒)
+     */
+    uint64_t GetSpinCpuTimeUS();
+
+    /**
+     * 获取运行统计，可在任意线程调用
+     */
+    Stats GetStats();
+
+    /**
+     * 开启或关闭耗时类统计，开启后每个任务和回调都会额外读取时钟
+     * 计数类统计始终记录
+     */
+    void EnableStats(bool enable);
+
+    /**
+     * poller内所有socket共用的读缓冲，首次使用时创建，只能在poller线程中使用
+     * 内容在下一次任意socket读取时被覆盖
+     */
+    const BufferRaw::Ptr& GetSharedBuffer();
+
+    /**
+     * 放弃当前读缓冲，交给仍持有它的调用者，下次GetSharedBuffer时重新分配
+     */
+    void DetachSharedBuffer();
+
+    /**
+     * 加入周期检查，每POLLER_SWEEP_MS执行一次cb，只能在poller线程中使用
+     * 所有检查共用一个定时器，首次加入时启动，没有检查项时停止
+     */
+    void AddSweep(PollSweepCB&& cb);
+
   private:
+    friend class DelayTask;
+
     EventPoller();
 
   private:
@@ -68,22 +272,124 @@ class EventPoller final : public TaskExecutor,
         ~ExitException() = default;
     };
 
-    void on_pipe_event();
+    struct TaskNode : public MpscNode
+    {
+        SmallTask task;
+        // 开启统计时记录投递时刻，用于计算排队时间
+        uint64_t  enqueue_us = 0;
+        // 节点缓存中的空闲链表
+        TaskNode* free_next  = nullptr;
+    };
+
+    // 任务节点缓存，所有poller共用
+    typedef NodePool<TaskNode, POLLER_TASK_NODE_FREE_MAX> TaskNodePool;
+
+    // 以fd为下标的事件回调表项，generation用于识别fd被复用后的过期事件
+    struct EventSlot
+    {
+        std::unique_ptr<PollEventCB> cb;
+        uint32_t                     generation = 0;
+    };
+
+    void on_notify_event();
+
+    void release_event_cb(EventSlot& slot);
+
+    void run_tasks();
+
+    bool has_pending_tasks();
+
+    int add_event(int fd, int event, PollEventCB&& cb);
+
+    void sync(TaskIn&& task, bool first);
 
     uint64_t get_min_delay_ms();
 
-    uint64_t flush_delay_tasks(uint64_t now);
+    void flush_delay_tasks(uint64_t now);
+
+    void remove_delay_task(const DelayTask::Ptr& task);
+
+    void add_delay_task_us(const DelayTask::Ptr& task, uint64_t expire_us);
+
+    void flush_delay_tasks_us(uint64_t now_us);
+
+    void on_timer_event();
 
-    Task::Ptr async(TaskIn&& task, bool first);
+    uint64_t sweep();
+
+    void update_timer();
+
+    void post(SmallTask&& task, bool first);
+
+    uint64_t drain_tasks(MpscQueue<TaskNode>& queue);
+
+    int busy_poll(struct epoll_event* events, int max, int timeout);
+
+    int run_event_op(std::function<int()>&& op);
+
+    void start_sleep();
+
+    void sleep_wakeup();
 
   private:
-    PipeWrapper                                           pipe_;
-    std::unordered_map<int, std::shared_ptr<PollEventCB>> event_map_;
-    List<Task::Ptr>                                       task_list_;
-    bool                                                  exit_flag_;
+    EventFDWrapper                                        notifier_;
+    // 是否已经写过eventfd且尚未被poller线程读取
+    std::atomic<bool>                                     notified_{false};
+    std::atomic<std::thread::id>                          loop_thread_id_;
+    std::atomic<uint64_t>                                 wakeups_sent_{0};
+    std::atomic<uint64_t> wakeups_suppressed_{0};
+    std::vector<EventSlot>                                event_slots_;
+    // 事件分发期间被删除或替换的回调，本轮分发结束后再释放
+    std::vector<std::unique_ptr<PollEventCB>>             event_cb_trash_;
+    bool                                                  dispatching_ = false;
+    // AsyncFirst使用的优先队列，每次处理时优先于task_queue_
+    MpscQueue<TaskNode>                                   task_queue_first_;
+    MpscQueue<TaskNode>                                   task_queue_;
+    bool                                                  exit_flag_ = false;
+    // 当前poller线程正在Sync等待的poller，用于检测互相等待
+    std::atomic<EventPoller*>                             sync_waiting_on_{nullptr};
     Semaphore                                             run_started_sem_;
-    std::multimap<uint64_t, DelayTask::Ptr>               delay_tasks_;
+    TimingWheel                                           delay_wheel_;
+    std::multimap<uint64_t, DelayTask::Ptr>               delay_map_us_;
+    // 高精度延时任务使用的timerfd，首次使用时创建
+    int                                                   timer_fd_ = -1;
+    // timerfd当前设置的到期时刻，0表示未设置
+    uint64_t                                              timer_armed_us_ = 0;
     int                                                   epoll_fd_ = -1;
+
+    // 负载统计
+    uint64_t              busy_us_         = 0;
+    uint64_t              last_wakeup_us_  = 0;
+    uint64_t              window_begin_us_ = 0;
+    std::atomic<uint64_t> sleep_begin_us_{0};
+    std::atomic<bool>     sleeping_{false};
+    std::atomic<int>      load_{0};
+
+    // 自旋轮询
+    std::atomic<uint64_t> spin_budget_us_{0};
+    uint64_t              spin_current_us_ = 0;
+    std::atomic<uint64_t> spin_hits_{0};
+    std::atomic<uint64_t> spin_misses_{0};
+    std::atomic<uint64_t> spin_cpu_us_{0};
+
+    // 运行统计，只在poller线程写入
+    std::atomic<bool>     stats_enabled_{false};
+    std::atomic<uint64_t> loop_iterations_{0};
+    std::atomic<uint64_t> events_total_{0};
+    std::atomic<uint64_t> tasks_total_{0};
+    Histogram             events_per_wait_;
+    Histogram             tasks_per_drain_;
+    Histogram             queue_delay_us_;
+    Histogram             event_cb_us_;
+    Histogram             task_us_;
+    Histogram             delay_task_us_;
+    Histogram             timer_late_ms_;
+    Histogram             timer_late_us_;
+
+    BufferRaw::Ptr shared_buffer_;
+
+    std::vector<PollSweepCB> sweep_cbs_;
+    DelayTask::Ptr           sweep_timer_;
 };
 
 }  // namespace common_library
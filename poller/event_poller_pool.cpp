@@ -0,0 +1,120 @@
+#include <poller/event_poller_pool.h>
+#include <utils/logger.h>
+#include <utils/utils.h>
+
+#include <functional>
+
+namespace common_library {
+
+static size_t s_pool_size = 0;
+
+INSTANCE_IMPL(EventPollerPool);
+
+void EventPollerPool::SetPoolSize(size_t size)
+{
+    s_pool_size = size;
+}
+
+EventPollerPool::EventPollerPool()
+{
+    size_t size = s_pool_size;
+    if (size == 0) {
+        size = std::thread::hardware_concurrency();
+    }
+    if (size == 0) {
+        size = 1;
+    }
+
+    for (size_t i = 0; i < size; i++) {
+        EventPoller::Ptr poller = EventPoller::Create();
+        pollers_.emplace_back(poller);
+        threads_.CreateThread([poller]() { poller->RunLoop(); });
+        // 等待事件循环开始，之后其他线程的事件操作都交给poller线程执行
+        poller->Sync([]() {});
+    }
+
+    LOG_I << "event poller pool started. size=" << size;
+}
+
+EventPollerPool::~EventPollerPool()
+{
+    for (EventPoller::Ptr& poller : pollers_) {
+        poller->Shutdown();
+    }
+    threads_.JoinAll();
+}
+
+EventPoller::Ptr EventPollerPool::GetPoller()
+{
+    return GetPoller(policy_.load(std::memory_order_relaxed));
+}
+
+EventPoller::Ptr EventPollerPool::GetPoller(PollerSelectPolicy policy)
+{
+    if (policy == POLLER_SELECT_ROUND_ROBIN) {
+        return get_round_robin_poller();
+    }
+    return get_least_loaded_poller();
+}
+
+EventPoller::Ptr EventPollerPool::GetPollerByKey(uint64_t key)
+{
+    return pollers_[key % pollers_.size()];
+}
+
+EventPoller::Ptr EventPollerPool::GetPollerByKey(const std::string& key)
+{
+    return GetPollerByKey(static_cast<uint64_t>(std::hash<std::string>()(key)));
+}
+
+EventPoller::Ptr EventPollerPool::GetFirstPoller()
+{
+    return pollers_.front();
+}
+
+void EventPollerPool::SetSelectPolicy(PollerSelectPolicy policy)
+{
+    policy_.store(policy, std::memory_order_relaxed);
+}
+
+size_t EventPollerPool::Size()
+{
+    return pollers_.size();
+}
+
+std::vector<int> EventPollerPool::GetLoads()
+{
+    std::vector<int> loads;
+    for (EventPoller::Ptr& poller : pollers_) {
+        loads.emplace_back(poller->GetLoad());
+    }
+    return loads;
+}
+
+EventPoller::Ptr EventPollerPool::get_least_loaded_poller()
+{
+    // 从轮询位置开始查找，负载相同时可以均匀分散
+    size_t size  = pollers_.size();
+    size_t start = rr_index_.fetch_add(1, std::memory_order_relaxed) % size;
+    size_t best  = start;
+    int    min   = pollers_[start]->GetLoad();
+
+    for (size_t i = 1; i < size && min > 0; i++) {
+        size_t idx  = (start + i) % size;
+        int    load = pollers_[idx]->GetLoad();
+        if (load < min) {
+            min  = load;
+            best = idx;
+        }
+    }
+
+    return pollers_[best];
+}
+
+EventPoller::Ptr EventPollerPool::get_round_robin_poller()
+{
+    return pollers_[rr_index_.fetch_add(1, std::memory_order_relaxed) %
+                    pollers_.size()];
+}
+
+}  // namespace common_library
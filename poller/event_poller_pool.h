@@ -0,0 +1,73 @@
+#ifndef COMMON_LIBRARY_EVENT_POLLER_POOL_H
+#define COMMON_LIBRARY_EVENT_POLLER_POOL_H
+
+#include <poller/event_poller.h>
+#include <thread/group.h>
+#include <utils/noncopyable.h>
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+namespace common_library {
+
+typedef enum {
+    POLLER_SELECT_LEAST_LOADED = 0,
+    POLLER_SELECT_ROUND_ROBIN
+} PollerSelectPolicy;
+
+class EventPollerPool final : public noncopyable {
+  public:
+    ~EventPollerPool();
+
+    static EventPollerPool& Instance();
+
+    /**
+     * 设置poller数量，必须在第一次调用Instance()之前设置
+     * 0表示使用cpu核数
+     */
+    static void SetPoolSize(size_t size = 0);
+
+  public:
+    /**
+     * 按默认策略选择一个poller
+     */
+    EventPoller::Ptr GetPoller();
+
+    EventPoller::Ptr GetPoller(PollerSelectPolicy policy);
+
+    /**
+     * 相同key总是返回同一个poller
+     */
+    EventPoller::Ptr GetPollerByKey(uint64_t key);
+
+    EventPoller::Ptr GetPollerByKey(const std::string& key);
+
+    /**
+     * 第一个poller，用于执行控制类任务
+     */
+    EventPoller::Ptr GetFirstPoller();
+
+    void SetSelectPolicy(PollerSelectPolicy policy);
+
+    size_t Size();
+
+    std::vector<int> GetLoads();
+
+  private:
+    EventPollerPool();
+
+    EventPoller::Ptr get_least_loaded_poller();
+
+    EventPoller::Ptr get_round_robin_poller();
+
+  private:
+    std::vector<EventPoller::Ptr>   pollers_;
+    ThreadGroup                     threads_;
+    std::atomic<uint64_t>           rr_index_{0};
+    std::atomic<PollerSelectPolicy> policy_{POLLER_SELECT_LEAST_LOADED};
+};
+
+}  // namespace common_library
+
+#endif
@@ -0,0 +1,58 @@
+#include <poller/eventfd_wrapper.h>
+#include <utils/utils.h>
+#include <utils/uv_error.h>
+
+#include <stdexcept>
+
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+namespace common_library {
+
+EventFDWrapper::EventFDWrapper()
+{
+    // 非阻塞，防止poller线程退出后写入被阻塞
+    fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (fd_ == -1) {
+        throw std::runtime_error(StringPrinter << "create eventfd failed. "
+                                               << get_uv_errmsg());
+    }
+}
+
+EventFDWrapper::~EventFDWrapper()
+{
+    if (fd_ != -1) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+}
+
+int EventFDWrapper::Write(uint64_t value)
+{
+    int ret;
+    do {
+        ret = ::write(fd_, &value, sizeof(value));
+    } while (ret == -1 && get_uv_error() == EINTR);
+    return ret;
+}
+
+int EventFDWrapper::Read(uint64_t* value)
+{
+    uint64_t tmp;
+    int      ret;
+    do {
+        ret = ::read(fd_, &tmp, sizeof(tmp));
+    } while (ret == -1 && get_uv_error() == EINTR);
+
+    if (ret > 0 && value) {
+        *value = tmp;
+    }
+    return ret;
+}
+
+int EventFDWrapper::FD()
+{
+    return fd_;
+}
+
+}  // namespace common_library
@@ -0,0 +1,33 @@
+#ifndef COMMON_LIBRARY_EVENTFD_WRAPPER_H
+#define COMMON_LIBRARY_EVENTFD_WRAPPER_H
+
+#include <stdint.h>
+
+namespace common_library {
+
+/**
+ * eventfd唤醒器，多次写入在被读取前只会产生一次可读事件
+ */
+class EventFDWrapper final {
+  public:
+    EventFDWrapper();
+
+    ~EventFDWrapper();
+
+  public:
+    int Write(uint64_t value = 1);
+
+    /**
+     * 读取并清零计数器
+     */
+    int Read(uint64_t* value = nullptr);
+
+    int FD();
+
+  private:
+    int fd_ = -1;
+};
+
+}  // namespace common_library
+
+#endif
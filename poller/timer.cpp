@@ -6,26 +6,35 @@ namespace common_library {
 Timer::Timer(float                        second,
              const std::function<bool()>& cb,
              const EventPoller::Ptr&      poller,
-             bool                         continue_when_exception)
+             bool                         continue_when_exception,
+             bool                         high_res)
 {
     poller_ = poller;
 
-    tag_ = poller_->DoDelayTask(
-        second * 1000, [cb, second, continue_when_exception]() {
-            try {
-                if (cb()) {
-                    return (uint64_t)(second * 1000);
-                }
-                return (uint64_t)0;
+    // 高精度定时器以微秒为单位
+    uint64_t interval =
+        static_cast<uint64_t>(second * (high_res ? 1000000 : 1000));
+    auto task = [cb, interval, continue_when_exception]() {
+        try {
+            if (cb()) {
+                return interval;
             }
-            catch (std::exception& e) {
-                LOG_E << "timer caught an exception while executing task. "
-                      << e.what();
+            return (uint64_t)0;
+        }
+        catch (std::exception& e) {
+            LOG_E << "timer caught an exception while executing task. "
+                  << e.what();
 
-                return continue_when_exception ? (uint64_t)(second * 1000) :
-                                                 (uint64_t)0;
-            }
-        });
+            return continue_when_exception ? interval : (uint64_t)0;
+        }
+    };
+
+    if (high_res) {
+        tag_ = poller_->DoDelayTaskUS(interval, std::move(task));
+    }
+    else {
+        tag_ = poller_->DoDelayTask(interval, std::move(task));
+    }
 }
 
 Timer::~Timer()
@@ -8,10 +8,14 @@ namespace common_library {
 class Timer {
   public:
     typedef std::shared_ptr<Timer> Ptr;
+    /**
+     * high_res为true时使用微秒精度的DoDelayTaskUS
+     */
     Timer(float                        second,
           const std::function<bool()>& cb,
           const EventPoller::Ptr&      poller,
-          bool                         continue_when_exception = true);
+          bool                         continue_when_exception = true,
+          bool                         high_res                = false);
     ~Timer();
 
   private:
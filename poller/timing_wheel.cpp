@@ -0,0 +1,200 @@
+#include <poller/timing_wheel.h>
+
+namespace common_library {
+
+static inline int level_shift(int level)
+{
+    return level == 0 ? 0 : TW_ROOT_BITS + (level - 1) * TW_LEVEL_BITS;
+}
+
+TimingWheel::TimingWheel(uint64_t now_ms)
+{
+    next_tick_ = now_ms;
+    for (int level = 0; level < TW_LEVELS; level++) {
+        for (int i = 0; i < TW_ROOT_SIZE; i++) {
+            slots_[level][i].prev_ = slots_[level][i].next_ = &slots_[level][i];
+        }
+        for (int i = 0; i < 4; i++) {
+            bitmap_[level][i] = 0;
+        }
+    }
+}
+
+void TimingWheel::Add(TimingWheelNode* node, uint64_t expire_ms)
+{
+    if (node->IsLinked()) {
+        Remove(node);
+    }
+
+    node->expire_ms_ = expire_ms;
+    place(node);
+    ++size_;
+}
+
+void TimingWheel::Remove(TimingWheelNode* node)
+{
+    if (!node->IsLinked()) {
+        return;
+    }
+
+    unlink(node);
+
+    TimingWheelNode& head = slots_[node->level_][node->index_];
+    if (head.next_ == &head) {
+        bitmap_[node->level_][node->index_ >> 6] &=
+            ~(uint64_t(1) << (node->index_ & 63));
+    }
+
+    node->level_ = -1;
+    --size_;
+}
+
+uint64_t TimingWheel::NextTimeoutMS(uint64_t now_ms)
+{
+    if (size_ == 0) {
+        return 0;
+    }
+
+    uint64_t tick     = next_tick_;
+    int      idx      = tick & (TW_ROOT_SIZE - 1);
+    uint64_t boundary = (tick | (TW_ROOT_SIZE - 1)) + 1;
+    uint64_t target;
+
+    if (idx == 0 && has_higher_level_nodes()) {
+        // next_tick_处还未级联
+        return tick > now_ms ? tick - now_ms : 1;
+    }
+
+    int slot = find_next_slot(idx);
+    if (slot >= 0) {
+        target = (tick & ~uint64_t(TW_ROOT_SIZE - 1)) + slot;
+    }
+    else if (has_higher_level_nodes()) {
+        // 需要在下一次级联时重新计算
+        target = boundary;
+    }
+    else {
+        // 第0层剩余的节点都在下一圈
+        slot   = find_first_slot();
+        target = slot < 0 ? boundary : boundary + slot;
+    }
+
+    return target > now_ms ? target - now_ms : 1;
+}
+
+void TimingWheel::cascade(uint64_t tick)
+{
+    // 逐层把当前槽的节点重新放置到更低层
+    for (int level = 1; level < TW_LEVELS; level++) {
+        int idx = (tick >> level_shift(level)) & (TW_LEVEL_SIZE - 1);
+
+        TimingWheelNode list;
+        take_slot(level, idx, list);
+        while (list.next_ != &list) {
+            TimingWheelNode* node = list.next_;
+            unlink(node);
+            place(node);
+        }
+
+        if (idx != 0) {
+            break;
+        }
+    }
+}
+
+void TimingWheel::place(TimingWheelNode* node)
+{
+    uint64_t tick  = node->expire_ms_ < next_tick_ ? next_tick_ : node->expire_ms_;
+    uint64_t delta = tick - next_tick_;
+
+    int level = 0;
+    if (delta >= TW_ROOT_SIZE) {
+        for (level = 1; level < TW_LEVELS; level++) {
+            if (delta < (uint64_t(1) << (level_shift(level) + TW_LEVEL_BITS))) {
+                break;
+            }
+        }
+        if (level == TW_LEVELS) {
+            // 超出时间轮范围，放在最高层最远的槽，级联时再重新计算
+            level = TW_LEVELS - 1;
+            tick  = next_tick_ +
+                   (uint64_t(1) << (level_shift(level) + TW_LEVEL_BITS)) - 1;
+        }
+    }
+
+    int idx = (tick >> level_shift(level)) & (slot_count(level) - 1);
+
+    node->level_ = level;
+    node->index_ = idx;
+    link_before(&slots_[level][idx], node);
+    bitmap_[level][idx >> 6] |= uint64_t(1) << (idx & 63);
+}
+
+void TimingWheel::take_slot(int level, int slot, TimingWheelNode& list)
+{
+    TimingWheelNode& head = slots_[level][slot];
+    if (head.next_ == &head) {
+        list.prev_ = list.next_ = &list;
+        return;
+    }
+
+    // 整条链表转移到list上
+    list.next_        = head.next_;
+    list.prev_        = head.prev_;
+    list.next_->prev_ = &list;
+    list.prev_->next_ = &list;
+    head.prev_ = head.next_ = &head;
+
+    bitmap_[level][slot >> 6] &= ~(uint64_t(1) << (slot & 63));
+}
+
+int TimingWheel::find_next_slot(int idx)
+{
+    for (int i = idx >> 6; i < TW_ROOT_SIZE / 64; i++) {
+        uint64_t bits = bitmap_[0][i];
+        if (i == (idx >> 6)) {
+            bits &= ~uint64_t(0) << (idx & 63);
+        }
+        if (bits) {
+            return i * 64 + __builtin_ctzll(bits);
+        }
+    }
+    return -1;
+}
+
+int TimingWheel::find_first_slot()
+{
+    for (int i = 0; i < TW_ROOT_SIZE / 64; i++) {
+        if (bitmap_[0][i]) {
+            return i * 64 + __builtin_ctzll(bitmap_[0][i]);
+        }
+    }
+    return -1;
+}
+
+bool TimingWheel::has_higher_level_nodes()
+{
+    for (int level = 1; level < TW_LEVELS; level++) {
+        if (bitmap_[level][0]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void TimingWheel::link_before(TimingWheelNode* head, TimingWheelNode* node)
+{
+    node->next_        = head;
+    node->prev_        = head->prev_;
+    head->prev_->next_ = node;
+    head->prev_        = node;
+}
+
+void TimingWheel::unlink(TimingWheelNode* node)
+{
+    node->prev_->next_ = node->next_;
+    node->next_->prev_ = node->prev_;
+    node->prev_ = node->next_ = nullptr;
+}
+
+}  // namespace common_library
@@ -0,0 +1,174 @@
+#ifndef COMMON_LIBRARY_TIMING_WHEEL_H
+#define COMMON_LIBRARY_TIMING_WHEEL_H
+
+#include <utils/noncopyable.h>
+
+#include <stdint.h>
+
+#define TW_ROOT_BITS 8
+#define TW_LEVEL_BITS 6
+#define TW_LEVELS 5
+#define TW_ROOT_SIZE (1 << TW_ROOT_BITS)
+#define TW_LEVEL_SIZE (1 << TW_LEVEL_BITS)
+
+namespace common_library {
+
+/**
+ * 时间轮节点，使用者继承该类并自行管理节点内存
+ */
+class TimingWheelNode {
+  public:
+    TimingWheelNode()  = default;
+    ~TimingWheelNode() = default;
+
+  public:
+    bool IsLinked() const
+    {
+        return level_ >= 0;
+    }
+
+    uint64_t ExpireMS() const
+    {
+        return expire_ms_;
+    }
+
+  private:
+    friend class TimingWheel;
+    TimingWheelNode* prev_      = nullptr;
+    TimingWheelNode* next_      = nullptr;
+    uint64_t         expire_ms_ = 0;
+    int16_t          level_     = -1;
+    uint16_t         index_     = 0;
+};
+
+/**
+ * 分层时间轮，毫秒精度
+ * 第0层256个槽，其余4层各64个槽，覆盖2^32毫秒，超出部分在最高层循环等待
+ * 插入、删除、单个节点到期均为O(1)，非线程安全
+ */
+class TimingWheel final : public noncopyable {
+  public:
+    TimingWheel(uint64_t now_ms);
+    ~TimingWheel() = default;
+
+  public:
+    void Add(TimingWheelNode* node, uint64_t expire_ms);
+
+    void Remove(TimingWheelNode* node);
+
+    /**
+     * 推进到now_ms，对每个到期节点调用f(TimingWheelNode*)
+     * 回调前节点已从时间轮中移除，回调中可以再次Add或者Remove其他节点
+     */
+    template <typename Func> void Advance(uint64_t now_ms, Func&& f)
+    {
+        while (next_tick_ <= now_ms) {
+            uint64_t tick = next_tick_;
+            int      idx  = tick & (TW_ROOT_SIZE - 1);
+
+            if (idx == 0) {
+                cascade(tick);
+            }
+
+            // 跳过空槽，直接定位到下一个非空槽或者下一次级联的位置
+            int      slot   = find_next_slot(idx);
+            uint64_t target = slot < 0 ? (tick | (TW_ROOT_SIZE - 1)) + 1 :
+                                         (tick & ~uint64_t(TW_ROOT_SIZE - 1)) +
+                                             slot;
+            if (target > now_ms) {
+                next_tick_ = now_ms + 1;
+                break;
+            }
+
+            next_tick_ = target;
+            if (slot < 0) {
+                continue;
+            }
+
+            next_tick_ = target + 1;
+
+            // 先整体摘下该槽，回调中新加入同一槽的节点不会在本轮执行
+            TimingWheelNode expired;
+            take_slot(0, slot, expired);
+            while (expired.next_ != &expired) {
+                TimingWheelNode* node = expired.next_;
+                unlink(node);
+                node->level_ = -1;
+                --size_;
+                f(node);
+            }
+        }
+    }
+
+    /**
+     * 距离下一个需要处理的时刻的毫秒数，调用前需先Advance(now_ms)
+     * 时间轮为空时返回0
+     */
+    uint64_t NextTimeoutMS(uint64_t now_ms);
+
+    /**
+     * 移除所有节点，并对每个节点调用f(TimingWheelNode*)
+     */
+    template <typename Func> void Clear(Func&& f)
+    {
+        for (int level = 0; level < TW_LEVELS; level++) {
+            for (int i = 0; i < slot_count(level); i++) {
+                TimingWheelNode& head = slots_[level][i];
+                while (head.next_ != &head) {
+                    TimingWheelNode* node = head.next_;
+                    unlink(node);
+                    node->level_ = -1;
+                    f(node);
+                }
+            }
+            for (int i = 0; i < 4; i++) {
+                bitmap_[level][i] = 0;
+            }
+        }
+        size_ = 0;
+    }
+
+    uint64_t Size() const
+    {
+        return size_;
+    }
+
+    bool Empty() const
+    {
+        return size_ == 0;
+    }
+
+  private:
+    void cascade(uint64_t tick);
+
+    void place(TimingWheelNode* node);
+
+    void take_slot(int level, int slot, TimingWheelNode& list);
+
+    int find_next_slot(int idx);
+
+    int find_first_slot();
+
+    bool has_higher_level_nodes();
+
+    static void link_before(TimingWheelNode* head, TimingWheelNode* node);
+
+    static void unlink(TimingWheelNode* node);
+
+    static int slot_count(int level)
+    {
+        return level == 0 ? TW_ROOT_SIZE : TW_LEVEL_SIZE;
+    }
+
+  private:
+    // 下一个待处理的毫秒时刻
+    uint64_t        next_tick_;
+    uint64_t        size_ = 0;
+    TimingWheelNode slots_[TW_LEVELS][TW_ROOT_SIZE];
+    // 记录非空槽，用于快速跳过空槽
+    uint64_t bitmap_[TW_LEVELS][4];
+};
+
+}  // namespace common_library
+
+#endif
@@ -0,0 +1,185 @@
+#include "net/socket.h"
+#include "poller/event_poller.h"
+#include "thread/semaphore.h"
+#include "utils/logger.h"
+#include <atomic>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <sys/resource.h>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace common_library;
+
+/**
+ * 大量空闲TCP连接的内存测试，客户端和服务端在同一进程的不同poller
+ * 每个连接双向各发送一次数据，保证读缓冲被实际使用，之后保持空闲
+ * 输出建立连接前后的VmRSS和VmData，以及平均每个socket的增量
+ * 客户端轮流绑定127.0.0.x，避免单个源地址的临时端口耗尽
+ * fd上限不足时按上限减少连接数，需要ulimit -n不低于连接数的两倍
+ * 用法: bench_conn_memory [connections]
+ */
+
+#define CONNECT_INFLIGHT  256
+#define CONNS_PER_ADDRESS 20000
+
+// 只在各自的poller线程中访问
+static vector<Socket::Ptr> g_clients;
+static vector<Socket::Ptr> g_peers;
+
+static atomic<uint64_t> g_connected{0};
+static atomic<uint64_t> g_failed{0};
+static atomic<uint64_t> g_server_read{0};
+static atomic<uint64_t> g_client_read{0};
+
+// 单位KB
+static uint64_t read_status(const string& key)
+{
+    ifstream file("/proc/self/status");
+    string   line;
+    while (getline(file, line)) {
+        if (line.compare(0, key.size(), key) == 0) {
+            return stoull(line.substr(key.size() + 1));
+        }
+    }
+    return 0;
+}
+
+static uint64_t raise_fd_limit()
+{
+    struct rlimit limit;
+    getrlimit(RLIMIT_NOFILE, &limit);
+    limit.rlim_cur = limit.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &limit);
+    getrlimit(RLIMIT_NOFILE, &limit);
+    return limit.rlim_cur;
+}
+
+static void connect_next(const EventPoller::Ptr& poller,
+                         uint16_t                port,
+                         uint64_t                total)
+{
+    uint64_t index = g_clients.size();
+    if (index >= total) {
+        return;
+    }
+
+    Socket::Ptr client = Socket::Create(poller);
+    g_clients.emplace_back(client);
+    client->SetOnRead(
+        [](const Buffer::Ptr& buf, sockaddr_storage*, socklen_t) {
+            g_client_read += buf->Size();
+        });
+
+    string local_ip = "127.0.0." + to_string(1 + index / CONNS_PER_ADDRESS);
+    weak_ptr<Socket> weak_client = client;
+    client->Connect(
+        "127.0.0.1", port,
+        [poller, port, total, weak_client](const SocketException& err) {
+            if (err) {
+                ++g_failed;
+            }
+            else {
+                ++g_connected;
+                auto strong_client = weak_client.lock();
+                if (strong_client) {
+                    strong_client->Send("hello", 5);
+                }
+            }
+            connect_next(poller, port, total);
+        },
+        5, local_ip);
+}
+
+static void print_memory(const char* name)
+{
+    cout << name << ": VmRSS=" << read_status("VmRSS") / 1024
+         << " MB, VmData=" << read_status("VmData") / 1024 << " MB" << endl;
+}
+
+int main(int argc, char** argv)
+{
+    Logger::Instance().AddChannel(std::make_shared<ConsoleChannel>());
+    Logger::Instance().SetWriter(
+        std::make_shared<AsyncLogWriter>(Logger::Instance()));
+
+    uint64_t total    = argc > 1 ? atoll(argv[1]) : 100000;
+    uint64_t fd_limit = raise_fd_limit();
+    if (total * 2 + 64 > fd_limit) {
+        total = fd_limit > 64 ? (fd_limit - 64) / 2 : 0;
+        cout << "fd limit " << fd_limit << ", connections reduced to " << total
+             << endl;
+    }
+
+    EventPoller::Ptr client_poller = EventPoller::Create();
+    EventPoller::Ptr server_poller = EventPoller::Create();
+    thread client_loop([client_poller]() { client_poller->RunLoop(); });
+    thread server_loop([server_poller]() { server_poller->RunLoop(); });
+
+    Socket::Ptr server = Socket::Create(server_poller);
+    server_poller->Sync([&]() {
+        server->SetOnAccept([](Socket::Ptr& peer) {
+            g_peers.emplace_back(peer);
+            weak_ptr<Socket> weak_peer = peer;
+            peer->SetOnRead(
+                [weak_peer](const Buffer::Ptr& buf, sockaddr_storage*,
+                            socklen_t) {
+                    g_server_read += buf->Size();
+                    auto strong_peer = weak_peer.lock();
+                    if (strong_peer) {
+                        strong_peer->Send("world", 5);
+                    }
+                });
+        });
+        server->Listen(SOCK_TCP, 0, false, "127.0.0.1", 4096);
+    });
+    uint16_t port = server->GetLocalPort();
+
+    this_thread::sleep_for(chrono::milliseconds(100));
+    uint64_t rss_begin  = read_status("VmRSS");
+    uint64_t data_begin = read_status("VmData");
+    print_memory("before");
+
+    uint64_t begin = get_current_milliseconds();
+    client_poller->Sync([&]() {
+        g_clients.reserve(total);
+        for (int i = 0; i < CONNECT_INFLIGHT; i++) {
+            connect_next(client_poller, port, total);
+        }
+    });
+
+    // 等待全部连接完成，并且两端都收到一次数据
+    uint64_t hello_size = 5 * (total - g_failed);
+    while (g_connected + g_failed < total || g_server_read < hello_size ||
+           g_client_read < hello_size) {
+        this_thread::sleep_for(chrono::milliseconds(100));
+        hello_size = 5 * (total - g_failed);
+    }
+    uint64_t cost = get_current_milliseconds() - begin;
+
+    uint64_t rss_end  = read_status("VmRSS");
+    uint64_t data_end = read_status("VmData");
+    print_memory("after ");
+
+    uint64_t sockets = g_connected * 2;
+    cout << "connections=" << g_connected << " failed=" << g_failed
+         << " cost=" << cost << " ms" << endl;
+    if (sockets) {
+        cout << "per socket: VmRSS=" << (rss_end - rss_begin) * 1024 / sockets
+             << " bytes, VmData=" << (data_end - data_begin) * 1024 / sockets
+             << " bytes" << endl;
+    }
+
+    client_poller->Sync([&]() { g_clients.clear(); });
+    server_poller->Sync([&]() {
+        g_peers.clear();
+        server = nullptr;
+    });
+    client_poller->Shutdown();
+    server_poller->Shutdown();
+    client_loop.join();
+    server_loop.join();
+    return 0;
+}
@@ -0,0 +1,129 @@
+#include "poller/event_poller.h"
+#include "utils/logger.h"
+#include "utils/utils.h"
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+using namespace common_library;
+
+/**
+ * 大量活跃fd时的事件分发开销测试
+ * 所有fd以水平触发方式保持可读，每次epoll_wait都返回满批事件
+ * 对比: EventPoller 与 unordered_map + shared_ptr拷贝的分发方式
+ * 用法: bench_event_dispatch [fd_count] [total_events]
+ */
+
+static vector<int> g_fds;
+
+static bool create_fds(int count)
+{
+    rlimit limit;
+    getrlimit(RLIMIT_NOFILE, &limit);
+    limit.rlim_cur = limit.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &limit);
+
+    for (int i = 0; i < count / 2; i++) {
+        int pair[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, pair) == -1) {
+            cout << "socketpair failed, created " << g_fds.size() << " fds"
+                 << endl;
+            return false;
+        }
+        // 两端各写一个字节，不读取，始终可读
+        ::write(pair[0], "", 1);
+        ::write(pair[1], "", 1);
+        g_fds.emplace_back(pair[0]);
+        g_fds.emplace_back(pair[1]);
+    }
+    return true;
+}
+
+static void print_result(const char* name, uint64_t total, uint64_t cost_us)
+{
+    cout << name << ": " << total << " events, " << cost_us / 1000 << " ms, "
+         << (cost_us ? total * 1000 / cost_us : 0) << " events/ms" << endl;
+}
+
+static void bench_poller(uint64_t total)
+{
+    EventPoller::Ptr poller = EventPoller::Create();
+    uint64_t         count  = 0;
+
+    for (int fd : g_fds) {
+        poller->AddEvent(fd, PE_READ | PE_LT, [&count, total, poller](int) {
+            if (++count == total) {
+                poller->Shutdown();
+            }
+        });
+    }
+
+    uint64_t begin = get_current_microseconds();
+    poller->RunLoop();
+    print_result("EventPoller", count, get_current_microseconds() - begin);
+
+    for (int fd : g_fds) {
+        poller->DelEvent(fd);
+    }
+}
+
+static void bench_hash_map(uint64_t total)
+{
+    typedef function<void(int)>        CB;
+    unordered_map<int, shared_ptr<CB>> event_map;
+    int                                epoll_fd = epoll_create(1024);
+    uint64_t                           count    = 0;
+
+    for (int fd : g_fds) {
+        epoll_event ev = {0};
+        ev.events      = EPOLLIN;
+        ev.data.fd     = fd;
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev);
+        event_map.emplace(fd, make_shared<CB>([&count](int) { ++count; }));
+    }
+
+    epoll_event events[1024];
+    uint64_t    begin = get_current_microseconds();
+    while (count < total) {
+        int n = epoll_wait(epoll_fd, events, 1024, -1);
+        for (int i = 0; i < n; i++) {
+            auto it = event_map.find(events[i].data.fd);
+            if (it == event_map.end()) {
+                continue;
+            }
+            shared_ptr<CB> cb = it->second;
+            (*cb)(events[i].events);
+        }
+    }
+    print_result("unordered_map", count, get_current_microseconds() - begin);
+
+    ::close(epoll_fd);
+}
+
+int main(int argc, char** argv)
+{
+    Logger::Instance().AddChannel(std::make_shared<ConsoleChannel>());
+    Logger::Instance().SetWriter(
+        std::make_shared<AsyncLogWriter>(Logger::Instance()));
+
+    int      fd_count = argc > 1 ? atoi(argv[1]) : 10000;
+    uint64_t total    = argc > 2 ? atoll(argv[2]) : 20000000;
+
+    create_fds(fd_count);
+    cout << "fds=" << g_fds.size() << ", total_events=" << total << endl;
+
+    bench_poller(total);
+    bench_hash_map(total);
+
+    for (int fd : g_fds) {
+        ::close(fd);
+    }
+    return 0;
+}
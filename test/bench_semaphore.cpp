@@ -0,0 +1,131 @@
+#include "thread/semaphore.h"
+#include "utils/histogram.h"
+#include <condition_variable>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace common_library;
+
+/**
+ * futex信号量 与 mutex + condition_variable信号量 的对比
+ * ping-pong: 两个线程通过两个信号量交替唤醒对方，统计单次往返耗时
+ * producer/consumer: 生产者每隔gap_us投递一次，统计从Post到Wait返回的延迟
+ * 用法: bench_semaphore [round_trips] [items] [gap_us]
+ */
+
+// 原先基于条件变量的实现，作为对比基准
+class CondSemaphore {
+  public:
+    void Post(uint32_t n = 1)
+    {
+        unique_lock<mutex> lock(mux_);
+        count_ += n;
+        if (n == 1) {
+            cond_.notify_one();
+        }
+        else {
+            cond_.notify_all();
+        }
+    }
+
+    void Wait()
+    {
+        unique_lock<mutex> lock(mux_);
+        while (count_ == 0) {
+            cond_.wait(lock);
+        }
+        --count_;
+    }
+
+  private:
+    uint32_t               count_ = 0;
+    mutex                  mux_;
+    condition_variable_any cond_;
+};
+
+static uint64_t now_ns()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+template <typename Sem> static void bench_ping_pong(const char* name, int n)
+{
+    Sem ping;
+    Sem pong;
+
+    thread peer([&]() {
+        for (int i = 0; i < n; i++) {
+            ping.Wait();
+            pong.Post();
+        }
+    });
+
+    uint64_t begin = now_ns();
+    for (int i = 0; i < n; i++) {
+        ping.Post();
+        pong.Wait();
+    }
+    uint64_t cost = now_ns() - begin;
+    peer.join();
+
+    cout << name << " ping-pong: " << n << " round trips, " << cost / 1000000
+         << " ms, " << cost / n << " ns/round trip" << endl;
+}
+
+template <typename Sem>
+static void bench_producer_consumer(const char* name, int n, uint64_t gap_us)
+{
+    Sem              sem;
+    vector<uint64_t> stamps(n);
+    Histogram        latency;
+
+    thread consumer([&]() {
+        for (int i = 0; i < n; i++) {
+            sem.Wait();
+            latency.Record(now_ns() - stamps[i]);
+        }
+    });
+
+    uint64_t begin = now_ns();
+    for (int i = 0; i < n; i++) {
+        if (gap_us) {
+            uint64_t until = now_ns() + gap_us * 1000;
+            while (now_ns() < until) {
+            }
+        }
+        stamps[i] = now_ns();
+        sem.Post();
+    }
+    consumer.join();
+    uint64_t cost = now_ns() - begin;
+
+    Histogram::Snapshot snap = latency.GetSnapshot();
+    cout << name << " producer/consumer(gap=" << gap_us << "us): " << n
+         << " items, " << cost / 1000000 << " ms, latency ns mean=" << snap.Mean()
+         << " p50=" << snap.Percentile(50) << " p99=" << snap.Percentile(99)
+         << " max=" << snap.max << endl;
+}
+
+int main(int argc, char** argv)
+{
+    int      round_trips = argc > 1 ? atoi(argv[1]) : 200000;
+    int      items       = argc > 2 ? atoi(argv[2]) : 200000;
+    uint64_t gap_us      = argc > 3 ? atoll(argv[3]) : 20;
+
+    cout << "hardware_concurrency=" << thread::hardware_concurrency() << endl;
+
+    bench_ping_pong<Semaphore>("Semaphore(futex)", round_trips);
+    bench_ping_pong<CondSemaphore>("CondSemaphore", round_trips);
+
+    bench_producer_consumer<Semaphore>("Semaphore(futex)", items, 0);
+    bench_producer_consumer<CondSemaphore>("CondSemaphore", items, 0);
+
+    bench_producer_consumer<Semaphore>("Semaphore(futex)", items / 10, gap_us);
+    bench_producer_consumer<CondSemaphore>("CondSemaphore", items / 10, gap_us);
+    return 0;
+}
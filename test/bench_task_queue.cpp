@@ -0,0 +1,151 @@
+#include "poller/event_poller.h"
+#include "thread/mpsc_queue.h"
+#include "utils/list.h"
+#include "utils/logger.h"
+#include "utils/utils.h"
+#include <atomic>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace common_library;
+
+/**
+ * 多个生产者线程同时向一个消费者投递任务的压力测试
+ * 对比: EventPoller::Async、EventPoller::Post、无锁MpscQueue、加锁的List
+ * 用法: bench_task_queue [producers] [tasks_per_producer]
+ */
+
+struct IntNode : public MpscNode
+{
+    IntNode(uint64_t v) : value(v) {}
+    uint64_t value;
+};
+
+static void print_result(const char* name, uint64_t total, uint64_t cost_us)
+{
+    cout << name << ": " << total << " tasks, " << cost_us / 1000 << " ms, "
+         << (cost_us ? total * 1000000 / cost_us : 0) << " tasks/s" << endl;
+}
+
+template <typename Func>
+static void run_producers(int producers, uint64_t per_producer, Func&& f)
+{
+    vector<thread> threads;
+    for (int i = 0; i < producers; i++) {
+        threads.emplace_back([&f, per_producer]() {
+            for (uint64_t j = 0; j < per_producer; j++) {
+                f(j);
+            }
+        });
+    }
+    for (thread& t : threads) {
+        t.join();
+    }
+}
+
+static void bench_poller(int producers, uint64_t per_producer, bool post)
+{
+    EventPoller::Ptr poller = EventPoller::Create();
+    thread           loop([poller]() { poller->RunLoop(); });
+
+    uint64_t           total = producers * per_producer;
+    atomic<uint64_t>   done{0};
+    uint64_t           begin = get_current_microseconds();
+
+    run_producers(producers, per_producer, [&](uint64_t) {
+        if (post) {
+            poller->Post([&done]() { ++done; });
+        }
+        else {
+            poller->Async([&done]() { ++done; });
+        }
+    });
+    while (done.load() < total) {
+        this_thread::yield();
+    }
+
+    print_result(post ? "EventPoller::Post" : "EventPoller::Async", total,
+                 get_current_microseconds() - begin);
+    cout << "    wakeups sent=" << poller->GetWakeupsSent()
+         << ", suppressed=" << poller->GetWakeupsSuppressed() << endl;
+    poller->Shutdown();
+    loop.join();
+}
+
+static void bench_mpsc(int producers, uint64_t per_producer)
+{
+    MpscQueue<IntNode> queue;
+    uint64_t           total    = producers * per_producer;
+    uint64_t           consumed = 0;
+    uint64_t           begin    = get_current_microseconds();
+
+    thread consumer([&]() {
+        IntNode* node;
+        while (consumed < total) {
+            if ((node = queue.Pop())) {
+                ++consumed;
+                delete node;
+            }
+        }
+    });
+
+    run_producers(producers, per_producer,
+                  [&](uint64_t v) { queue.Push(new IntNode(v)); });
+    consumer.join();
+
+    print_result("MpscQueue", total, get_current_microseconds() - begin);
+}
+
+static void bench_mutex_list(int producers, uint64_t per_producer)
+{
+    List<IntNode*> list;
+    mutex          mux;
+    uint64_t       total    = producers * per_producer;
+    uint64_t       consumed = 0;
+    uint64_t       begin    = get_current_microseconds();
+
+    thread consumer([&]() {
+        while (consumed < total) {
+            List<IntNode*> tmp;
+            {
+                lock_guard<mutex> lock(mux);
+                tmp.swap(list);
+            }
+            tmp.for_each([&](IntNode* node) {
+                ++consumed;
+                delete node;
+            });
+        }
+    });
+
+    run_producers(producers, per_producer, [&](uint64_t v) {
+        lock_guard<mutex> lock(mux);
+        list.emplace_back(new IntNode(v));
+    });
+    consumer.join();
+
+    print_result("mutex + List", total, get_current_microseconds() - begin);
+}
+
+int main(int argc, char** argv)
+{
+    Logger::Instance().AddChannel(std::make_shared<ConsoleChannel>());
+    Logger::Instance().SetWriter(
+        std::make_shared<AsyncLogWriter>(Logger::Instance()));
+
+    int      producers    = argc > 1 ? atoi(argv[1]) : 4;
+    uint64_t per_producer = argc > 2 ? atoll(argv[2]) : 500000;
+
+    cout << "producers=" << producers << ", tasks_per_producer=" << per_producer
+         << endl;
+
+    bench_poller(producers, per_producer, false);
+    bench_poller(producers, per_producer, true);
+    bench_mpsc(producers, per_producer);
+    bench_mutex_list(producers, per_producer);
+
+    return 0;
+}
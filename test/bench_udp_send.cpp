@@ -0,0 +1,172 @@
+#include "net/buffer.h"
+#include "utils/utils.h"
+#include <arpa/inet.h>
+#include <atomic>
+#include <iostream>
+#include <netinet/in.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+
+using namespace std;
+using namespace common_library;
+
+/**
+ * UDP发送队列的刷新开销测试，在回环地址上发送
+ * 对比: 每个数据报一次sendmsg(原BufferList的UDP发送方式) 与 sendmmsg批量发送
+ * 每轮先排队burst个数据报，再一次性刷新，与Socket::flush_data的用法一致
+ * 用法: bench_udp_send [total_packets] [burst] [packet_size]
+ */
+
+static atomic<bool>     g_running{true};
+static atomic<uint64_t> g_received{0};
+static sockaddr_storage g_dest;
+static socklen_t        g_dest_len;
+
+static void run_receiver(int fd)
+{
+    const int      batch = 64;
+    char           bufs[batch][2048];
+    struct iovec   iovs[batch];
+    struct mmsghdr msgs[batch];
+    for (int i = 0; i < batch; i++) {
+        iovs[i].iov_base = bufs[i];
+        iovs[i].iov_len  = sizeof(bufs[i]);
+        bzero(&msgs[i], sizeof(msgs[i]));
+        msgs[i].msg_hdr.msg_iov    = &iovs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    while (g_running) {
+        int n = recvmmsg(fd, msgs, batch, 0, nullptr);
+        if (n > 0) {
+            g_received += n;
+        }
+    }
+}
+
+static List<Buffer::Ptr> make_packets(int burst, const Buffer::Ptr& payload)
+{
+    List<Buffer::Ptr> list;
+    for (int i = 0; i < burst; i++) {
+        list.emplace_back(
+            std::make_shared<BufferSock>(payload, &g_dest, g_dest_len));
+    }
+    return list;
+}
+
+static void wait_writeable(int fd)
+{
+    struct pollfd pfd;
+    pfd.fd     = fd;
+    pfd.events = POLLOUT;
+    poll(&pfd, 1, 100);
+}
+
+// 原实现: 每个数据报一次sendmsg
+static void flush_sendmsg(int fd, List<Buffer::Ptr>& list)
+{
+    while (!list.empty()) {
+        BufferSock* buffer = static_cast<BufferSock*>(list.front().get());
+        // BufferSock的地址不对外暴露，所有数据报的目标地址相同
+        struct iovec iov;
+        iov.iov_base = buffer->Data();
+        iov.iov_len  = buffer->Size();
+
+        struct msghdr msg;
+        bzero(&msg, sizeof(msg));
+        msg.msg_name    = &g_dest;
+        msg.msg_namelen = g_dest_len;
+        msg.msg_iov     = &iov;
+        msg.msg_iovlen  = 1;
+        if (sendmsg(fd, &msg, MSG_NOSIGNAL | MSG_DONTWAIT) == -1) {
+            if (errno == EAGAIN) {
+                wait_writeable(fd);
+                continue;
+            }
+            return;
+        }
+        list.pop_front();
+    }
+}
+
+// 新实现: BufferList通过sendmmsg批量发送
+static void flush_sendmmsg(int fd, List<Buffer::Ptr>& list)
+{
+    BufferList buffers(list);
+    while (!buffers.empty()) {
+        if (buffers.send(fd, MSG_NOSIGNAL | MSG_DONTWAIT, true) == -1) {
+            if (errno == EAGAIN) {
+                wait_writeable(fd);
+                continue;
+            }
+            return;
+        }
+    }
+}
+
+static void bench(const char* name,
+                  void (*flush)(int, List<Buffer::Ptr>&),
+                  int                fd,
+                  int                total,
+                  int                burst,
+                  const Buffer::Ptr& payload)
+{
+    uint64_t received = g_received;
+    uint64_t cost     = 0;
+    for (int sent = 0; sent < total; sent += burst) {
+        List<Buffer::Ptr> list = make_packets(burst, payload);
+        uint64_t          begin = get_current_microseconds();
+        flush(fd, list);
+        cost += get_current_microseconds() - begin;
+    }
+    // 等待接收线程处理完已到达的数据报
+    this_thread::sleep_for(chrono::milliseconds(100));
+
+    cout << name << ": " << total << " packets, " << cost / 1000 << " ms, "
+         << (cost ? uint64_t(total) * 1000000 / cost : 0) << " pps, received "
+         << g_received - received << endl;
+}
+
+int main(int argc, char** argv)
+{
+    int total       = argc > 1 ? atoi(argv[1]) : 1000000;
+    int burst       = argc > 2 ? atoi(argv[2]) : 1000;
+    int packet_size = argc > 3 ? atoi(argv[3]) : 64;
+
+    int         recv_fd = socket(AF_INET, SOCK_DGRAM, 0);
+    sockaddr_in addr;
+    bzero(&addr, sizeof(addr));
+    addr.sin_family      = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bind(recv_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+    socklen_t len = sizeof(addr);
+    getsockname(recv_fd, reinterpret_cast<sockaddr*>(&addr), &len);
+    int rcvbuf = 8 * 1024 * 1024;
+    setsockopt(recv_fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    timeval tv = {0, 100000};
+    setsockopt(recv_fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    thread receiver(run_receiver, recv_fd);
+
+    // 两种方式都使用未connect的socket，逐个数据报指定目标地址
+    bzero(&g_dest, sizeof(g_dest));
+    memcpy(&g_dest, &addr, sizeof(addr));
+    g_dest_len  = sizeof(addr);
+    int send_fd = socket(AF_INET, SOCK_DGRAM, 0);
+
+    BufferRaw::Ptr payload = std::make_shared<BufferRaw>();
+    payload->Assign(std::string(packet_size, 'x').data(), packet_size);
+
+    cout << "packet_size=" << packet_size << " burst=" << burst << endl;
+    bench("sendmsg", flush_sendmsg, send_fd, total, burst, payload);
+    bench("sendmmsg(BufferList)", flush_sendmmsg, send_fd, total, burst,
+          payload);
+
+    g_running = false;
+    receiver.join();
+    close(recv_fd);
+    close(send_fd);
+    return 0;
+}
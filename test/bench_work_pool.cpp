@@ -0,0 +1,127 @@
+#include "thread/task_queue.h"
+#include "thread/work_thread_pool.h"
+#include "utils/logger.h"
+#include "utils/utils.h"
+#include <atomic>
+#include <functional>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace common_library;
+
+/**
+ * WorkThreadPool(工作窃取) 与 共享TaskQueue线程池 的对比
+ * small: 外部线程投递大量很小的任务
+ * fork-join: 任务递归拆分为两个子任务，直到指定深度
+ * 用法: bench_work_pool [threads] [small_tasks] [fork_depth]
+ */
+
+// 使用一个共享TaskQueue的简单线程池，作为对比基准
+class SharedQueuePool {
+  public:
+    SharedQueuePool(size_t thread_num)
+    {
+        for (size_t i = 0; i < thread_num; i++) {
+            threads_.emplace_back([this]() {
+                function<void()> task;
+                while (queue_.GetTask(task)) {
+                    task();
+                }
+            });
+        }
+    }
+
+    ~SharedQueuePool()
+    {
+        queue_.PostExit(threads_.size());
+        for (thread& t : threads_) {
+            t.join();
+        }
+    }
+
+    void Post(function<void()>&& task)
+    {
+        queue_.AddTask(std::move(task));
+    }
+
+  private:
+    TaskQueue<function<void()>> queue_;
+    vector<thread>              threads_;
+};
+
+static void print_result(const char* name, uint64_t total, uint64_t cost_us)
+{
+    cout << name << ": " << total << " tasks, " << cost_us / 1000 << " ms, "
+         << (cost_us ? total * 1000000 / cost_us : 0) << " tasks/s" << endl;
+}
+
+static void wait_done(atomic<uint64_t>& done, uint64_t total)
+{
+    while (done.load(memory_order_acquire) < total) {
+        this_thread::yield();
+    }
+}
+
+template <typename Pool>
+static void bench_small(const char* name, Pool& pool, uint64_t total)
+{
+    atomic<uint64_t> done{0};
+    uint64_t         begin = get_steady_microseconds();
+    for (uint64_t i = 0; i < total; i++) {
+        pool.Post([&done]() { done.fetch_add(1, memory_order_release); });
+    }
+    wait_done(done, total);
+    print_result(name, total, get_steady_microseconds() - begin);
+}
+
+template <typename Pool>
+static void fork(Pool& pool, atomic<uint64_t>& leaves, int depth)
+{
+    if (depth == 0) {
+        leaves.fetch_add(1, memory_order_release);
+        return;
+    }
+    pool.Post([&pool, &leaves, depth]() { fork(pool, leaves, depth - 1); });
+    pool.Post([&pool, &leaves, depth]() { fork(pool, leaves, depth - 1); });
+}
+
+template <typename Pool>
+static void bench_fork_join(const char* name, Pool& pool, int depth)
+{
+    atomic<uint64_t> leaves{0};
+    uint64_t         total = uint64_t(1) << depth;
+    uint64_t         begin = get_steady_microseconds();
+    pool.Post([&pool, &leaves, depth]() { fork(pool, leaves, depth); });
+    wait_done(leaves, total);
+    // 总任务数为满二叉树的节点数
+    print_result(name, total * 2 - 1, get_steady_microseconds() - begin);
+}
+
+int main(int argc, char** argv)
+{
+    Logger::Instance().AddChannel(std::make_shared<ConsoleChannel>());
+    Logger::Instance().SetWriter(
+        std::make_shared<AsyncLogWriter>(Logger::Instance()));
+
+    size_t   threads = argc > 1 ? atoi(argv[1]) : 4;
+    uint64_t small   = argc > 2 ? atoll(argv[2]) : 1000000;
+    int      depth   = argc > 3 ? atoi(argv[3]) : 20;
+
+    cout << "threads=" << threads << ", small_tasks=" << small
+         << ", fork_depth=" << depth << endl;
+
+    {
+        WorkThreadPool pool(threads);
+        bench_small("WorkThreadPool small", pool, small);
+        bench_fork_join("WorkThreadPool fork-join", pool, depth);
+    }
+    {
+        SharedQueuePool pool(threads);
+        bench_small("TaskQueue small", pool, small);
+        bench_fork_join("TaskQueue fork-join", pool, depth);
+    }
+
+    return 0;
+}
@@ -0,0 +1,190 @@
+#include "net/socket.h"
+#include "poller/event_poller.h"
+#include "thread/semaphore.h"
+#include "utils/logger.h"
+#include "utils/utils.h"
+#include <atomic>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace common_library;
+
+/**
+ * TCP大块发送的MSG_ZEROCOPY测试，客户端和服务端在不同的poller
+ * 对比: 拷贝发送 与 零拷贝发送，负载64KB到1MB
+ * 回环地址上内核总是回退为拷贝，只能体现完成通知的额外开销
+ * 在真实网卡上测试时传入对端地址，对端运行同一程序的server模式
+ * 用法: bench_zerocopy [total_mb] [server_ip] [port]
+ *       bench_zerocopy server [port]
+ */
+
+#define SEND_INFLIGHT 4
+
+// 只在服务端poller线程中访问
+static vector<Socket::Ptr> g_peers;
+
+struct Result
+{
+    uint64_t      cost_us;
+    ZeroCopyStats stats;
+};
+
+static Socket::Ptr start_server(const EventPoller::Ptr& poller,
+                                uint16_t                port,
+                                atomic<uint64_t>&       received)
+{
+    Socket::Ptr server = Socket::Create(poller);
+    server->SetOnAccept([&received](Socket::Ptr& peer) {
+        g_peers.emplace_back(peer);
+        peer->SetOnRead(
+            [&received](const Buffer::Ptr& buf, sockaddr_storage*, socklen_t) {
+                received += buf->Size();
+            });
+    });
+    if (!server->Listen(SOCK_TCP, port, false, "0.0.0.0")) {
+        return nullptr;
+    }
+    return server;
+}
+
+static Result run(const EventPoller::Ptr& poller,
+                  const string&           ip,
+                  uint16_t                port,
+                  uint32_t                payload_size,
+                  uint64_t                total,
+                  uint32_t                threshold,
+                  const atomic<uint64_t>* received)
+{
+    string      payload(payload_size, 'x');
+    uint64_t    count  = total / payload_size;
+    uint64_t    sent   = 0;
+    uint64_t    base   = received ? received->load() : 0;
+    Semaphore   sem;
+    Socket::Ptr client = Socket::Create(poller);
+    Result      result;
+
+    // Send可能直接触发OnFlushed重入，先计数再发送
+    auto send_more = [&]() {
+        for (int i = 0; i < SEND_INFLIGHT && sent < count; i++) {
+            sent++;
+            client->Send(payload.data(), payload.size());
+        }
+    };
+
+    uint64_t begin = 0;
+    poller->Sync([&]() {
+        client->SetZeroCopy(threshold);
+        client->SetOnError([&](const SocketException& err) {
+            cout << "error: " << err.what() << endl;
+            sem.Post();
+        });
+        client->SetOnFlushed([&]() {
+            if (sent < count) {
+                send_more();
+                return true;
+            }
+            if (!received) {
+                sem.Post();
+            }
+            return false;
+        });
+        client->Connect(ip, port, [&](const SocketException& err) {
+            if (err) {
+                cout << "connect failed: " << err.what() << endl;
+                sem.Post();
+                return;
+            }
+            begin = get_current_microseconds();
+            send_more();
+        });
+    });
+
+    if (received) {
+        // 同进程的服务端收完全部数据
+        while (*received - base < count * payload_size) {
+            this_thread::sleep_for(chrono::milliseconds(1));
+        }
+    }
+    else {
+        sem.Wait();
+    }
+    result.cost_us = get_current_microseconds() - begin;
+
+    // 等待剩余的完成通知
+    this_thread::sleep_for(chrono::milliseconds(100));
+    poller->Sync([&]() {
+        result.stats = client->GetZeroCopyStats();
+        client       = nullptr;
+    });
+    return result;
+}
+
+static void print_result(const char*   name,
+                         uint32_t      payload_size,
+                         uint64_t      total,
+                         const Result& result)
+{
+    cout << name << " payload=" << payload_size / 1024 << "KB: "
+         << result.cost_us / 1000 << " ms, "
+         << (result.cost_us ? total / result.cost_us : 0) << " MB/s"
+         << ", zerocopy=" << result.stats.zerocopy_bytes
+         << " fallback=" << result.stats.fallback_bytes
+         << " copied=" << result.stats.copied_bytes
+         << " pending=" << result.stats.pending_bytes << endl;
+}
+
+int main(int argc, char** argv)
+{
+    Logger::Instance().AddChannel(std::make_shared<ConsoleChannel>());
+    Logger::Instance().SetWriter(
+        std::make_shared<AsyncLogWriter>(Logger::Instance()));
+
+    EventPoller::Ptr client_poller = EventPoller::Create();
+    EventPoller::Ptr server_poller = EventPoller::Create();
+    thread client_loop([client_poller]() { client_poller->RunLoop(); });
+    thread server_loop([server_poller]() { server_poller->RunLoop(); });
+
+    atomic<uint64_t> received{0};
+    Socket::Ptr      server;
+    if (argc > 1 && string(argv[1]) == "server") {
+        uint16_t port = argc > 2 ? atoi(argv[2]) : 9527;
+        server        = start_server(server_poller, port, received);
+        cout << "listen on " << port << ", press enter to exit" << endl;
+        getchar();
+    }
+    else {
+        uint64_t total = (argc > 1 ? atoll(argv[1]) : 512) * 1024 * 1024;
+        string   ip    = argc > 2 ? argv[2] : "127.0.0.1";
+        uint16_t port  = argc > 3 ? atoi(argv[3]) : 0;
+        bool     local = (port == 0);
+        if (local) {
+            server_poller->Sync([&]() {
+                server = start_server(server_poller, 0, received);
+                port   = server->GetLocalPort();
+            });
+        }
+
+        for (uint32_t payload_size : {64 * 1024, 256 * 1024, 1024 * 1024}) {
+            Result copy = run(client_poller, ip, port, payload_size, total, 0,
+                              local ? &received : nullptr);
+            print_result("copy    ", payload_size, total, copy);
+
+            Result zerocopy = run(client_poller, ip, port, payload_size, total,
+                                  16 * 1024, local ? &received : nullptr);
+            print_result("zerocopy", payload_size, total, zerocopy);
+        }
+    }
+
+    server_poller->Sync([&]() {
+        server = nullptr;
+        g_peers.clear();
+    });
+    client_poller->Shutdown();
+    server_poller->Shutdown();
+    client_loop.join();
+    server_loop.join();
+    return 0;
+}
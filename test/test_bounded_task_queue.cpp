@@ -0,0 +1,277 @@
+#include "thread/bounded_task_queue.h"
+#include "utils/logger.h"
+#include <atomic>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace common_library;
+
+/**
+ * BoundedTaskQueue测试
+ * capacity  容量向上取整为2的幂，最小为2
+ * full      队列满时TryAddTask返回false，AddTask阻塞到消费者取走一个
+ * empty     队列空时GetTask阻塞到有任务入队，先入先出
+ * exit      退出通知排在已入队的任务之后，阻塞中的消费者都被唤醒
+ * mpmc      小容量队列上多生产者多消费者，每个任务恰好取出一次
+ * drop      AsyncLogWriter队列满时丢弃并计数，提示中的条数与丢弃数一致
+ */
+
+// 判断线程仍在阻塞前等待的时间
+#define BLOCK_CHECK_MS 50
+#define MPMC_THREADS   4
+#define MPMC_COUNT     50000
+#define LOG_COUNT      100
+
+static int g_failed = 0;
+
+static void report(bool ok, const string& name, const string& detail)
+{
+    cout << (ok ? "[ok] " : "[failed] ") << name << " " << detail << endl;
+    if (!ok) {
+        ++g_failed;
+    }
+}
+
+static void check_capacity()
+{
+    BoundedTaskQueue<int> q0(0);
+    BoundedTaskQueue<int> q1(1);
+    BoundedTaskQueue<int> q5(5);
+    BoundedTaskQueue<int> q64(64);
+    BoundedTaskQueue<int> q65(65);
+
+    bool ok = q0.Capacity() == 2 && q1.Capacity() == 2 &&
+              q5.Capacity() == 8 && q64.Capacity() == 64 &&
+              q65.Capacity() == 128;
+    report(ok, "capacity",
+           "5->" + to_string(q5.Capacity()) + " 65->" +
+               to_string(q65.Capacity()));
+}
+
+static void check_full()
+{
+    BoundedTaskQueue<int> queue(4);
+    int                   added = 0;
+    while (queue.TryAddTask(added)) {
+        ++added;
+    }
+    bool full_ok = added == 4 && queue.Size() == 4;
+
+    atomic<bool> done{false};
+    thread       producer([&queue, &done]() {
+        queue.AddTask(4);
+        done = true;
+    });
+    this_thread::sleep_for(chrono::milliseconds(BLOCK_CHECK_MS));
+    bool blocked = !done;
+
+    int first = -1;
+    queue.TryGetTask(first);
+    producer.join();
+
+    // 取出的顺序与入队顺序一致，阻塞的任务排在最后
+    vector<int> values;
+    int         value;
+    while (queue.TryGetTask(value)) {
+        values.push_back(value);
+    }
+    bool order_ok = first == 0 && values == vector<int>({1, 2, 3, 4});
+
+    report(full_ok && blocked && done && order_ok, "full",
+           "added=" + to_string(added) + " blocked=" + to_string(blocked) +
+               " left=" + to_string(values.size()));
+}
+
+static void check_empty()
+{
+    BoundedTaskQueue<int> queue(4);
+    int                   value = -1;
+    bool                  empty = !queue.TryGetTask(value);
+
+    atomic<bool> done{false};
+    atomic<int>  got{-1};
+    thread       consumer([&queue, &done, &got]() {
+        int v = -1;
+        if (queue.GetTask(v)) {
+            got = v;
+        }
+        done = true;
+    });
+    this_thread::sleep_for(chrono::milliseconds(BLOCK_CHECK_MS));
+    bool blocked = !done;
+
+    queue.AddTask(42);
+    consumer.join();
+
+    report(empty && blocked && got == 42 && queue.Size() == 0, "empty",
+           "blocked=" + to_string(blocked) + " got=" + to_string(got));
+}
+
+static void check_exit()
+{
+    // 已入队的任务先被取完，之后才收到退出通知
+    BoundedTaskQueue<int> queue(8);
+    for (int i = 0; i < 3; i++) {
+        queue.AddTask(i);
+    }
+    queue.PostExit(1);
+
+    vector<int> values;
+    int         value;
+    while (queue.GetTask(value)) {
+        values.push_back(value);
+    }
+    bool order_ok = values == vector<int>({0, 1, 2});
+
+    // 阻塞在空队列上的消费者都被唤醒并各自收到一个退出通知
+    atomic<int>    exited{0};
+    vector<thread> consumers;
+    for (int i = 0; i < 2; i++) {
+        consumers.emplace_back([&queue, &exited]() {
+            int v;
+            if (!queue.GetTask(v)) {
+                ++exited;
+            }
+        });
+    }
+    this_thread::sleep_for(chrono::milliseconds(BLOCK_CHECK_MS));
+    bool blocked = exited == 0;
+    queue.PostExit(2);
+    for (auto& consumer : consumers) {
+        consumer.join();
+    }
+
+    report(order_ok && blocked && exited == 2, "exit",
+           "values=" + to_string(values.size()) +
+               " exited=" + to_string(exited));
+}
+
+static void check_mpmc()
+{
+    BoundedTaskQueue<int> queue(64);
+    vector<atomic<int>>   counts(MPMC_THREADS * MPMC_COUNT);
+    for (auto& count : counts) {
+        count = 0;
+    }
+
+    vector<thread> threads;
+    for (int i = 0; i < MPMC_THREADS; i++) {
+        threads.emplace_back([&queue, &counts]() {
+            int      values[16];
+            uint64_t n;
+            while ((n = queue.GetTasks(values, 16)) > 0) {
+                for (uint64_t j = 0; j < n; j++) {
+                    ++counts[values[j]];
+                }
+            }
+        });
+    }
+    vector<thread> producers;
+    for (int i = 0; i < MPMC_THREADS; i++) {
+        producers.emplace_back([&queue, i]() {
+            for (int j = 0; j < MPMC_COUNT; j++) {
+                queue.AddTask(i * MPMC_COUNT + j);
+            }
+        });
+    }
+    for (auto& producer : producers) {
+        producer.join();
+    }
+    queue.PostExit(MPMC_THREADS);
+    for (auto& consumer : threads) {
+        consumer.join();
+    }
+
+    size_t bad = 0;
+    for (auto& count : counts) {
+        if (count != 1) {
+            ++bad;
+        }
+    }
+    report(bad == 0 && queue.Size() == 0, "mpmc",
+           "tasks=" + to_string(counts.size()) + " bad=" + to_string(bad));
+}
+
+// 统计收到的日志，每条都阻塞一段时间使队列积压
+class CountChannel final : public LogChannel {
+  public:
+    CountChannel() : LogChannel("CountChannel") {}
+
+    void Write(const Logger&                      logger,
+               const std::shared_ptr<LogContext>& pctx) override
+    {
+        this_thread::sleep_for(chrono::milliseconds(1));
+
+        static const string prefix = "log queue full, ";
+        string              msg    = pctx->str();
+        lock_guard<mutex>   lock(mux_);
+        if (msg.compare(0, prefix.size(), prefix) == 0) {
+            reported_ += stoull(msg.substr(prefix.size()));
+        }
+        else {
+            ++written_;
+        }
+    }
+
+    uint64_t Written()
+    {
+        lock_guard<mutex> lock(mux_);
+        return written_;
+    }
+
+    uint64_t Reported()
+    {
+        lock_guard<mutex> lock(mux_);
+        return reported_;
+    }
+
+  private:
+    mutex    mux_;
+    uint64_t written_  = 0;
+    uint64_t reported_ = 0;
+};
+
+static void check_drop()
+{
+    auto channel = make_shared<CountChannel>();
+    Logger::Instance().AddChannel(channel);
+
+    uint64_t dropped;
+    {
+        AsyncLogWriter writer(Logger::Instance(), 4);
+        for (int i = 0; i < LOG_COUNT; i++) {
+            auto pctx = make_shared<LogContext>(LINFO, __FILE__, 0,
+                                                __FUNCTION__, __LINE__);
+            *pctx << "log " << i;
+            writer.Write(pctx);
+        }
+        dropped = writer.GetDroppedCount();
+    }
+    // 析构时写完队列中剩余的日志并输出丢弃提示
+    Logger::Instance().RemoveChannel(channel->Name());
+
+    bool ok = dropped > 0 && channel->Written() + dropped == LOG_COUNT &&
+              channel->Reported() == dropped;
+    report(ok, "drop",
+           "written=" + to_string(channel->Written()) +
+               " dropped=" + to_string(dropped) +
+               " reported=" + to_string(channel->Reported()));
+}
+
+int main()
+{
+    check_capacity();
+    check_full();
+    check_empty();
+    check_exit();
+    check_mpmc();
+    check_drop();
+
+    cout << (g_failed ? "failed" : "all passed") << endl;
+    return g_failed ? 1 : 0;
+}
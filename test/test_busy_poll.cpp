@@ -0,0 +1,159 @@
+#include "poller/event_poller.h"
+#include "utils/logger.h"
+#include <atomic>
+#include <iostream>
+#include <string>
+#include <thread>
+
+using namespace std;
+using namespace common_library;
+
+/**
+ * EventPoller::SetBusyPoll测试，每个用例使用独立的poller
+ * disabled  预算为0时不自旋，命中、落空和cpu时间都保持为0
+ * hit       任务间隔远小于预算，自旋期间等到下一个任务，绝大多数为命中
+ * backoff   任务间隔大于预算，自旋都落空并逐次减半，cpu消耗远小于预算乘次数
+ * resume    退避到下限后，一次命中即恢复完整预算，之后较稀疏的任务也能命中
+ */
+
+#define SPIN_BUDGET_US 20000
+#define TASK_COUNT     50
+
+static int g_failed = 0;
+
+static void report(bool ok, const string& name, const string& detail)
+{
+    cout << (ok ? "[ok] " : "[failed] ") << name << " " << detail << endl;
+    if (!ok) {
+        ++g_failed;
+    }
+}
+
+// 从其他线程每隔interval_us投递一个任务，返回执行完的任务数
+static int post_tasks(const EventPoller::Ptr& poller,
+                      int                     count,
+                      int                     interval_us)
+{
+    auto executed = make_shared<atomic<int>>(0);
+    for (int i = 0; i < count; i++) {
+        poller->Post([executed]() { ++*executed; });
+        this_thread::sleep_for(chrono::microseconds(interval_us));
+    }
+    poller->Sync([]() {});
+    return *executed;
+}
+
+struct Counters
+{
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t cpu_us;
+};
+
+static Counters get_counters(const EventPoller::Ptr& poller)
+{
+    return {poller->GetSpinHits(), poller->GetSpinMisses(),
+            poller->GetSpinCpuTimeUS()};
+}
+
+static string to_string(const Counters& c)
+{
+    return "hits=" + std::to_string(c.hits) +
+           " misses=" + std::to_string(c.misses) +
+           " cpu=" + std::to_string(c.cpu_us) + "us";
+}
+
+static void check_disabled()
+{
+    EventPoller::Ptr poller = EventPoller::Create();
+    thread           loop([poller]() { poller->RunLoop(); });
+
+    int      executed = post_tasks(poller, TASK_COUNT, 1000);
+    Counters c        = get_counters(poller);
+
+    bool ok = executed == TASK_COUNT && c.hits == 0 && c.misses == 0 &&
+              c.cpu_us == 0;
+    report(ok, "disabled", to_string(c));
+
+    poller->Shutdown();
+    loop.join();
+}
+
+static void check_hit()
+{
+    EventPoller::Ptr poller = EventPoller::Create();
+    thread           loop([poller]() { poller->RunLoop(); });
+    poller->SetBusyPoll(SPIN_BUDGET_US);
+
+    int      executed = post_tasks(poller, TASK_COUNT, 2000);
+    Counters c        = get_counters(poller);
+
+    // 首个任务之前没有处理过事件，最后一个任务之后的自旋落空
+    bool ok = executed == TASK_COUNT && c.hits >= TASK_COUNT / 2 &&
+              c.hits > c.misses && c.cpu_us > 0;
+    report(ok, "hit", to_string(c));
+
+    poller->Shutdown();
+    loop.join();
+}
+
+static void check_backoff()
+{
+    EventPoller::Ptr poller = EventPoller::Create();
+    thread           loop([poller]() { poller->RunLoop(); });
+    poller->SetBusyPoll(SPIN_BUDGET_US);
+
+    // 间隔是预算的3倍，每个任务之后的自旋都等不到下一个任务
+    int      count    = 8;
+    int      executed = post_tasks(poller, count, SPIN_BUDGET_US * 3);
+    Counters c        = get_counters(poller);
+
+    // 首个任务可能落在启动后的自旋中，算作一次命中
+    // 不退避时约为count * 预算，逐次减半时不超过2倍预算
+    bool ok = executed == count && c.misses >= uint64_t(count) &&
+              c.hits <= 1 && c.cpu_us < 3 * SPIN_BUDGET_US;
+    report(ok, "backoff", to_string(c));
+
+    poller->Shutdown();
+    loop.join();
+}
+
+static void check_resume()
+{
+    EventPoller::Ptr poller = EventPoller::Create();
+    thread           loop([poller]() { poller->RunLoop(); });
+    poller->SetBusyPoll(SPIN_BUDGET_US);
+
+    // 连续落空把自旋时长降到下限(预算/32)
+    post_tasks(poller, 10, SPIN_BUDGET_US * 3);
+    // 间隔小于下限的密集任务命中，恢复完整预算
+    post_tasks(poller, 10, SPIN_BUDGET_US / 32 / 4);
+    Counters before = get_counters(poller);
+
+    // 间隔5ms大于下限，只有恢复完整预算后才能持续命中
+    int      executed = post_tasks(poller, TASK_COUNT, 5000);
+    Counters after    = get_counters(poller);
+    uint64_t hits     = after.hits - before.hits;
+
+    bool ok = executed == TASK_COUNT && hits >= TASK_COUNT / 2;
+    report(ok, "resume",
+           "before: " + to_string(before) + " after: " + to_string(after));
+
+    poller->Shutdown();
+    loop.join();
+}
+
+int main()
+{
+    Logger::Instance().AddChannel(std::make_shared<ConsoleChannel>());
+    Logger::Instance().SetWriter(
+        std::make_shared<AsyncLogWriter>(Logger::Instance()));
+
+    check_disabled();
+    check_hit();
+    check_backoff();
+    check_resume();
+
+    cout << (g_failed ? "failed" : "all passed") << endl;
+    return g_failed ? 1 : 0;
+}
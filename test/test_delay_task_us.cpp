@@ -0,0 +1,212 @@
+#include "poller/event_poller.h"
+#include "utils/logger.h"
+#include "utils/utils.h"
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace common_library;
+
+/**
+ * EventPoller::DoDelayTaskUS测试，验证timerfd在最早到期时刻变化时正确重设
+ * order     乱序加入的任务按到期时刻依次触发，且都不提前
+ * earlier   已按较晚时刻设置timerfd后加入更早的任务，提前重设并准时触发
+ * cancel    取消最早的任务后timerfd改为下一个任务的时刻，被取消的任务不触发
+ * repeat    返回下次延时的任务按间隔重复执行，与毫秒任务交替时互不影响
+ */
+
+// 空闲poller上允许的最大触发延迟
+#define MAX_LATE_US 20000
+
+static int g_failed = 0;
+
+static void report(bool ok, const string& name, const string& detail)
+{
+    cout << (ok ? "[ok] " : "[failed] ") << name << " " << detail << endl;
+    if (!ok) {
+        ++g_failed;
+    }
+}
+
+struct Fired
+{
+    int      id;
+    uint64_t late_us;
+};
+
+// 只在poller线程中修改，Sync之后在测试线程读取
+typedef std::shared_ptr<vector<Fired>> FiredList;
+
+static DelayTask::Ptr add_task(const EventPoller::Ptr& poller,
+                               const FiredList&        fired,
+                               int                     id,
+                               uint64_t                delay_us)
+{
+    // 不晚于poller内部记录的到期时刻，据此判断提前触发不会误报
+    uint64_t expire = get_steady_microseconds() + delay_us;
+    return poller->DoDelayTaskUS(delay_us, [fired, id, expire]() -> uint64_t {
+        // 提前触发时记为uint64_t(-1)
+        uint64_t now = get_steady_microseconds();
+        fired->push_back({id, now >= expire ? now - expire : uint64_t(-1)});
+        return 0;
+    });
+}
+
+static void wait_fired(const EventPoller::Ptr& poller,
+                       const FiredList&        fired,
+                       size_t                  count,
+                       int                     timeout_ms)
+{
+    size_t size = 0;
+    for (int i = 0; i < timeout_ms && size < count; i++) {
+        this_thread::sleep_for(chrono::milliseconds(1));
+        poller->Sync([&size, fired]() { size = fired->size(); });
+    }
+}
+
+// 检查按ids顺序触发，且都在到期之后MAX_LATE_US之内
+static bool check_fired(const FiredList&   fired,
+                        const vector<int>& ids,
+                        string&            detail)
+{
+    bool ok = fired->size() == ids.size();
+    for (size_t i = 0; i < fired->size(); i++) {
+        const Fired& f = (*fired)[i];
+        detail += to_string(f.id) + ":" +
+                  (f.late_us == uint64_t(-1) ? string("early")
+                                             : to_string(f.late_us)) +
+                  "us ";
+        if (i >= ids.size() || f.id != ids[i] || f.late_us > MAX_LATE_US) {
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+static void check_order()
+{
+    EventPoller::Ptr poller = EventPoller::Create();
+    thread           loop([poller]() { poller->RunLoop(); });
+    FiredList        fired = make_shared<vector<Fired>>();
+
+    // id即为到期顺序，每次加入较早的任务都需要重设timerfd
+    add_task(poller, fired, 5, 50000);
+    add_task(poller, fired, 2, 20000);
+    add_task(poller, fired, 4, 40000);
+    add_task(poller, fired, 1, 10000);
+    add_task(poller, fired, 3, 30000);
+    add_task(poller, fired, 0, 5000);
+    wait_fired(poller, fired, 6, 1000);
+
+    string detail;
+    bool   ok = check_fired(fired, {0, 1, 2, 3, 4, 5}, detail);
+    report(ok, "order", detail);
+
+    poller->Shutdown();
+    loop.join();
+}
+
+static void check_earlier()
+{
+    EventPoller::Ptr poller = EventPoller::Create();
+    thread           loop([poller]() { poller->RunLoop(); });
+    FiredList        fired = make_shared<vector<Fired>>();
+
+    // 先让timerfd按1秒后设置，再加入5ms的任务
+    DelayTask::Ptr late = add_task(poller, fired, 1, 1000000);
+    poller->Sync([]() {});
+    this_thread::sleep_for(chrono::milliseconds(2));
+    add_task(poller, fired, 0, 5000);
+    wait_fired(poller, fired, 1, 200);
+
+    string detail;
+    bool   ok = check_fired(fired, {0}, detail);
+    report(ok, "earlier", detail);
+
+    late->Cancel();
+    poller->Shutdown();
+    loop.join();
+}
+
+static void check_cancel()
+{
+    EventPoller::Ptr poller = EventPoller::Create();
+    thread           loop([poller]() { poller->RunLoop(); });
+    FiredList        fired = make_shared<vector<Fired>>();
+
+    DelayTask::Ptr first = add_task(poller, fired, 0, 10000);
+    add_task(poller, fired, 1, 30000);
+    DelayTask::Ptr last = add_task(poller, fired, 2, 60000);
+    poller->Sync([]() {});
+    first->Cancel();
+    last->Cancel();
+    wait_fired(poller, fired, 1, 1000);
+    // 等过被取消任务的到期时刻，确认没有再触发
+    this_thread::sleep_for(chrono::milliseconds(60));
+    poller->Sync([]() {});
+
+    string detail;
+    bool   ok = check_fired(fired, {1}, detail);
+    report(ok, "cancel", detail);
+
+    poller->Shutdown();
+    loop.join();
+}
+
+static void check_repeat()
+{
+    EventPoller::Ptr poller = EventPoller::Create();
+    thread           loop([poller]() { poller->RunLoop(); });
+
+    // 两种任务都在poller线程中修改计数
+    auto     count    = make_shared<int>(0);
+    auto     ms_count = make_shared<int>(0);
+    uint64_t begin    = get_steady_microseconds();
+    auto     end      = make_shared<uint64_t>(0);
+    poller->DoDelayTaskUS(2000, [count, end]() -> uint64_t {
+        if (++*count < 10) {
+            return 2000;
+        }
+        *end = get_steady_microseconds();
+        return 0;
+    });
+    poller->DoDelayTask(3, [ms_count]() -> uint64_t {
+        return ++*ms_count < 5 ? 3 : 0;
+    });
+
+    int done = 0;
+    for (int i = 0; i < 1000 && done < 2; i++) {
+        this_thread::sleep_for(chrono::milliseconds(1));
+        poller->Sync([&done, count, ms_count]() {
+            done = (*count == 10) + (*ms_count == 5);
+        });
+    }
+
+    // 10次间隔2ms的执行总耗时不少于20ms
+    uint64_t elapsed = *end ? *end - begin : 0;
+    bool ok = *count == 10 && *ms_count == 5 && elapsed >= 20000 &&
+              elapsed < 20000 + MAX_LATE_US * 2;
+    report(ok, "repeat",
+           "count=" + to_string(*count) + " ms_count=" + to_string(*ms_count) +
+               " elapsed=" + to_string(elapsed) + "us");
+
+    poller->Shutdown();
+    loop.join();
+}
+
+int main()
+{
+    Logger::Instance().AddChannel(std::make_shared<ConsoleChannel>());
+    Logger::Instance().SetWriter(
+        std::make_shared<AsyncLogWriter>(Logger::Instance()));
+
+    check_order();
+    check_earlier();
+    check_cancel();
+    check_repeat();
+
+    cout << (g_failed ? "failed" : "all passed") << endl;
+    return g_failed ? 1 : 0;
+}
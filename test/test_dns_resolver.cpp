@@ -0,0 +1,378 @@
+#include "net/dns_cache.h"
+#include "net/dns_resolver.h"
+#include "net/socket.h"
+#include "net/socket_utils.h"
+#include "poller/event_poller.h"
+#include "thread/semaphore.h"
+#include "utils/logger.h"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <atomic>
+#include <iostream>
+#include <netinet/in.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+
+using namespace std;
+using namespace common_library;
+
+/**
+ * DNSResolver测试，在127.0.0.1上启动一个桩DNS服务器，不依赖外部网络
+ * www.test     A 10.0.0.1 10.0.0.2, AAAA 2001:db8::1
+ * alias.test   CNAME + A 10.0.0.9
+ * v4only.test  只有A记录
+ * nx.test      NXDOMAIN
+ * fail.test    SERVFAIL
+ * slow.test    从不应答，验证超时
+ * flaky.test   每种记录的第一次查询不应答，验证重试
+ * short.test   A 10.0.0.5，TTL为1秒，验证DNSCache过期后返回旧结果并后台刷新
+ * n*.test      A 10.1.0.1，验证DNSCache的LRU淘汰
+ * spoof.test   应答中的问题域名被篡改，必须被丢弃并超时
+ * case.test    应答中的问题域名改为大写，仍然有效，A 10.0.0.7
+ */
+
+static atomic<bool> g_stub_running{true};
+static atomic<int>  g_flaky_count{0};
+static atomic<int>  g_query_count{0};
+static int          g_failed = 0;
+
+static void append_u16(string& out, uint16_t v)
+{
+    out.push_back(char(v >> 8));
+    out.push_back(char(v & 0xFF));
+}
+
+static void append_answer(string&     out,
+                          uint16_t    type,
+                          uint32_t    ttl,
+                          const void* rdata,
+                          uint16_t    len)
+{
+    // 名字使用指向问题区的压缩指针
+    append_u16(out, 0xC00C);
+    append_u16(out, type);
+    append_u16(out, 1);
+    append_u16(out, ttl >> 16);
+    append_u16(out, ttl & 0xFFFF);
+    append_u16(out, len);
+    out.append(static_cast<const char*>(rdata), len);
+}
+
+static void append_a(string& out, const char* ip, uint32_t ttl)
+{
+    in_addr addr;
+    inet_pton(AF_INET, ip, &addr);
+    append_answer(out, 1, ttl, &addr, 4);
+}
+
+static void append_aaaa(string& out, const char* ip, uint32_t ttl)
+{
+    in6_addr addr;
+    inet_pton(AF_INET6, ip, &addr);
+    append_answer(out, 28, ttl, &addr, 16);
+}
+
+static bool build_response(const uint8_t* req, size_t len, string& resp)
+{
+    if (len < 12) {
+        return false;
+    }
+
+    // 解析问题中的域名
+    string name;
+    size_t pos = 12;
+    while (pos < len && req[pos] != 0) {
+        if (!name.empty()) {
+            name += ".";
+        }
+        name.append(reinterpret_cast<const char*>(req + pos + 1), req[pos]);
+        pos += req[pos] + 1;
+    }
+    pos += 1;
+    if (pos + 4 > len) {
+        return false;
+    }
+    uint16_t qtype = (req[pos] << 8) | req[pos + 1];
+    pos += 4;
+    ++g_query_count;
+
+    if (name == "slow.test") {
+        return false;
+    }
+    if (name == "flaky.test" && g_flaky_count++ < 2) {
+        return false;
+    }
+
+    string   answers;
+    uint16_t count = 0;
+    uint16_t rcode = 0;
+    if (name == "www.test" || name == "flaky.test") {
+        if (qtype == 1) {
+            append_a(answers, "10.0.0.1", 300);
+            append_a(answers, "10.0.0.2", 60);
+            count = 2;
+        }
+        else {
+            append_aaaa(answers, "2001:db8::1", 120);
+            count = 1;
+        }
+    }
+    else if (name == "alias.test") {
+        const char cname[] = "\3www\4test";
+        append_answer(answers, 5, 30, cname, sizeof(cname));
+        count = 1;
+        if (qtype == 1) {
+            append_a(answers, "10.0.0.9", 30);
+            count = 2;
+        }
+    }
+    else if (name == "v4only.test") {
+        if (qtype == 1) {
+            append_a(answers, "10.0.0.3", 10);
+            count = 1;
+        }
+    }
+    else if (name == "short.test") {
+        if (qtype == 1) {
+            append_a(answers, "10.0.0.5", 1);
+            count = 1;
+        }
+    }
+    else if (name == "case.test") {
+        if (qtype == 1) {
+            append_a(answers, "10.0.0.7", 30);
+            count = 1;
+        }
+    }
+    else if (name[0] == 'n' && name != "nx.test") {
+        if (qtype == 1) {
+            append_a(answers, "10.1.0.1", 300);
+            count = 1;
+        }
+    }
+    else if (name == "fail.test") {
+        rcode = 2;
+    }
+    else {
+        rcode = 3;
+    }
+
+    resp.assign(reinterpret_cast<const char*>(req), 2);
+    append_u16(resp, 0x8180 | rcode);
+    append_u16(resp, 1);
+    append_u16(resp, count);
+    append_u16(resp, 0);
+    append_u16(resp, 0);
+    size_t question = resp.size();
+    resp.append(reinterpret_cast<const char*>(req + 12), pos - 12);
+    if (name == "spoof.test") {
+        resp[question + 1] = 'x';
+    }
+    else if (name == "case.test") {
+        std::transform(resp.begin() + question, resp.end(),
+                       resp.begin() + question, ::toupper);
+    }
+    resp += answers;
+    return true;
+}
+
+static void run_stub_server(int fd)
+{
+    uint8_t buf[1024];
+    while (g_stub_running) {
+        sockaddr_storage from;
+        socklen_t        len = sizeof(from);
+        ssize_t          n   = recvfrom(fd, buf, sizeof(buf), 0,
+                                        reinterpret_cast<sockaddr*>(&from), &len);
+        string           resp;
+        if (n > 0 && build_response(buf, n, resp)) {
+            sendto(fd, resp.data(), resp.size(), 0,
+                   reinterpret_cast<sockaddr*>(&from), len);
+        }
+    }
+}
+
+static string to_string(const vector<sockaddr_storage>& addrs)
+{
+    string str;
+    for (auto addr : addrs) {
+        if (!str.empty()) {
+            str += ",";
+        }
+        str += SocketUtils::GetIPFromAddr(&addr);
+    }
+    return str;
+}
+
+static void check(const DNSResolver::Ptr& resolver,
+                  const string&           host,
+                  int                     family,
+                  const string&           expect,
+                  SockErrCode             expect_err = ERR_SUCCESS)
+{
+    Semaphore   sem;
+    string      result;
+    SockErrCode code;
+    uint32_t    ttl = 0;
+
+    uint64_t begin = get_steady_milliseconds();
+    resolver->Resolve(
+        host,
+        [&](const SocketException&               err,
+            const vector<sockaddr_storage>& addrs, uint32_t ttl_sec) {
+            result = to_string(addrs);
+            code   = err.GetErrCode();
+            ttl    = ttl_sec;
+            sem.Post();
+        },
+        family);
+    sem.Wait();
+
+    bool ok = (result == expect && code == expect_err);
+    cout << (ok ? "[ok] " : "[failed] ") << host << " -> " << result
+         << " err=" << code << " ttl=" << ttl
+         << " cost=" << get_steady_milliseconds() - begin << "ms" << endl;
+    if (!ok) {
+        ++g_failed;
+    }
+}
+
+static void check_cache(const EventPoller::Ptr& poller,
+                        const string&           host,
+                        const string&           expect,
+                        int                     expect_queries)
+{
+    Semaphore sem;
+    string    result;
+    int       queries = g_query_count;
+
+    DNSCache::Instance().ParseAsync(
+        host, poller,
+        [&](const SocketException&, const vector<sockaddr_storage>& addrs,
+            uint32_t) {
+            result = to_string(addrs);
+            sem.Post();
+        });
+    sem.Wait();
+
+    // 等待可能的后台刷新
+    this_thread::sleep_for(chrono::milliseconds(50));
+    queries = g_query_count - queries;
+
+    bool ok = (result == expect && queries == expect_queries);
+    cout << (ok ? "[ok] " : "[failed] ") << "DNSCache " << host << " -> "
+         << result << " queries=" << queries << endl;
+    if (!ok) {
+        ++g_failed;
+    }
+}
+
+static void check_connect(const EventPoller::Ptr& poller)
+{
+    Socket::Ptr server = Socket::Create(poller);
+    if (!server->Listen(SOCK_TCP, 0, false, "127.0.0.1")) {
+        cout << "[failed] listen" << endl;
+        ++g_failed;
+        return;
+    }
+
+    Semaphore   sem;
+    SockErrCode code   = ERR_OTHER;
+    Socket::Ptr client = Socket::Create(poller);
+    client->Connect("localhost", server->GetLocalPort(),
+                    [&](const SocketException& err) {
+                        code = err.GetErrCode();
+                        sem.Post();
+                    });
+    sem.Wait();
+
+    cout << (code == ERR_SUCCESS ? "[ok] " : "[failed] ")
+         << "Socket::Connect(localhost) err=" << code << endl;
+    if (code != ERR_SUCCESS) {
+        ++g_failed;
+    }
+    poller->Sync([&]() {
+        client = nullptr;
+        server = nullptr;
+    });
+}
+
+int main()
+{
+    Logger::Instance().AddChannel(std::make_shared<ConsoleChannel>());
+    Logger::Instance().SetWriter(
+        std::make_shared<AsyncLogWriter>(Logger::Instance()));
+
+    int         stub_fd = socket(AF_INET, SOCK_DGRAM, 0);
+    sockaddr_in addr;
+    bzero(&addr, sizeof(addr));
+    addr.sin_family      = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bind(stub_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+    socklen_t len = sizeof(addr);
+    getsockname(stub_fd, reinterpret_cast<sockaddr*>(&addr), &len);
+    timeval tv = {0, 100000};
+    setsockopt(stub_fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    thread stub(run_stub_server, stub_fd);
+
+    EventPoller::Ptr poller = EventPoller::Create();
+    thread           loop([poller]() { poller->RunLoop(); });
+
+    DNSResolver::Ptr resolver = DNSResolver::Create(poller);
+    resolver->SetNameServers(
+        {"127.0.0.1:" + std::to_string(ntohs(addr.sin_port))});
+    resolver->SetTimeout(200, 2);
+
+    check(resolver, "www.test", AF_UNSPEC, "10.0.0.1,10.0.0.2,2001:db8::1");
+    check(resolver, "WWW.test.", AF_INET, "10.0.0.1,10.0.0.2");
+    check(resolver, "www.test", AF_INET6, "2001:db8::1");
+    check(resolver, "alias.test", AF_UNSPEC, "10.0.0.9");
+    check(resolver, "v4only.test", AF_UNSPEC, "10.0.0.3");
+    check(resolver, "nx.test", AF_UNSPEC, "", ERR_OTHER);
+    check(resolver, "fail.test", AF_UNSPEC, "", ERR_OTHER);
+    check(resolver, "slow.test", AF_UNSPEC, "", ERR_TIMEOUT);
+    check(resolver, "spoof.test", AF_UNSPEC, "", ERR_TIMEOUT);
+    check(resolver, "case.test", AF_INET, "10.0.0.7");
+    check(resolver, "flaky.test", AF_UNSPEC, "10.0.0.1,10.0.0.2,2001:db8::1");
+    check(resolver, "127.0.0.1", AF_UNSPEC, "127.0.0.1");
+    check(resolver, "::1", AF_UNSPEC, "::1");
+    check(resolver, "localhost", AF_INET, "127.0.0.1");
+    check(resolver, "bad..name", AF_UNSPEC, "", ERR_OTHER);
+
+    // DNSCache使用poller上的共享解析器，测试期间保持引用以保留配置
+    DNSResolver::Ptr shared = DNSResolver::Get(poller);
+    shared->SetNameServers(
+        {"127.0.0.1:" + std::to_string(ntohs(addr.sin_port))});
+    DNSCache::Instance().SetMaxSize(16);
+    check_cache(poller, "www.test", "10.0.0.1,10.0.0.2,2001:db8::1", 2);
+    check_cache(poller, "www.test", "10.0.0.1,10.0.0.2,2001:db8::1", 0);
+    check_cache(poller, "nx.test", "", 2);
+    check_cache(poller, "nx.test", "", 0);
+    check_cache(poller, "short.test", "10.0.0.5", 2);
+    this_thread::sleep_for(chrono::milliseconds(1100));
+    // 过期后先返回旧结果，同时后台刷新一次
+    check_cache(poller, "short.test", "10.0.0.5", 2);
+    check_cache(poller, "short.test", "10.0.0.5", 0);
+    for (int i = 0; i < 100; i++) {
+        check_cache(poller, "n" + std::to_string(i) + ".test", "10.1.0.1", 2);
+    }
+    size_t size = DNSCache::Instance().Size();
+    cout << (size <= 16 ? "[ok] " : "[failed] ") << "DNSCache size=" << size
+         << endl;
+    g_failed += (size <= 16 ? 0 : 1);
+
+    check_connect(poller);
+
+    resolver = nullptr;
+    shared   = nullptr;
+    poller->Shutdown();
+    loop.join();
+    g_stub_running = false;
+    stub.join();
+    close(stub_fd);
+
+    cout << (g_failed ? "failed" : "all passed") << endl;
+    return g_failed ? 1 : 0;
+}
@@ -0,0 +1,243 @@
+#include "poller/event_poller.h"
+#include "utils/histogram.h"
+#include "utils/logger.h"
+#include <atomic>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace common_library;
+
+/**
+ * EventPoller统计测试，每个用例使用独立的poller
+ * histogram  直方图的分桶边界、计数、总和、最大值、均值和百分位
+ * tasks      投递N个任务后任务计数增加N，每次唤醒执行数的总和与任务计数一致
+ * events     管道可读N次后事件计数至少增加N，每次等待事件数的总和与事件计数一致
+ * timing     未开启时不记录耗时，开启后记录排队时间和执行时间
+ * timer      延时任务记录延迟和执行时间，高精度延时任务记录微秒延迟
+ */
+
+#define TASK_COUNT   100
+#define EVENT_COUNT  20
+#define SLOW_TASK_MS 20
+
+static int g_failed = 0;
+
+static void report(bool ok, const string& name, const string& detail)
+{
+    cout << (ok ? "[ok] " : "[failed] ") << name << " " << detail << endl;
+    if (!ok) {
+        ++g_failed;
+    }
+}
+
+// 任务中读取时本轮计数尚未累加，等poller处理完本轮回到等待后再读取
+static EventPoller::Stats get_stats(const EventPoller::Ptr& poller)
+{
+    poller->Sync([]() {});
+    this_thread::sleep_for(chrono::milliseconds(10));
+    return poller->GetStats();
+}
+
+static void check_histogram()
+{
+    Histogram histogram;
+    for (uint64_t value : {0, 1, 2, 3, 4, 7, 8, 1000, 1023, 1024}) {
+        histogram.Record(value);
+    }
+    histogram.Record(uint64_t(1) << 40);
+    Histogram::Snapshot snap = histogram.GetSnapshot();
+
+    uint64_t sum = 0 + 1 + 2 + 3 + 4 + 7 + 8 + 1000 + 1023 + 1024 +
+                   (uint64_t(1) << 40);
+    // 第i个桶记录[2^(i-1), 2^i)，超出范围的值落在最后一个桶
+    bool buckets_ok = snap.buckets[0] == 1 && snap.buckets[1] == 1 &&
+                      snap.buckets[2] == 2 && snap.buckets[3] == 2 &&
+                      snap.buckets[4] == 1 && snap.buckets[10] == 2 &&
+                      snap.buckets[11] == 1 &&
+                      snap.buckets[HISTOGRAM_BUCKETS - 1] == 1;
+    bool totals_ok = snap.count == 11 && snap.sum == sum &&
+                     snap.max == (uint64_t(1) << 40) &&
+                     snap.Mean() == sum / 11;
+    // 百分位返回所在桶的上边界，最高的百分位不超过最大值
+    bool percentile_ok = snap.Percentile(0) == 0 &&
+                         snap.Percentile(50) == 7 &&
+                         snap.Percentile(80) == 1023 &&
+                         snap.Percentile(100) == snap.max &&
+                         Histogram::Snapshot().Percentile(50) == 0;
+
+    report(buckets_ok && totals_ok && percentile_ok, "histogram",
+           "count=" + to_string(snap.count) +
+               " p50=" + to_string(snap.Percentile(50)) +
+               " p80=" + to_string(snap.Percentile(80)));
+}
+
+static void check_tasks()
+{
+    EventPoller::Ptr poller = EventPoller::Create();
+    thread           loop([poller]() { poller->RunLoop(); });
+
+    EventPoller::Stats before   = get_stats(poller);
+    auto               executed = make_shared<atomic<int>>(0);
+    for (int i = 0; i < TASK_COUNT; i++) {
+        poller->Post([executed]() { ++*executed; });
+    }
+    EventPoller::Stats after = get_stats(poller);
+
+    // 前后两次get_stats投递的同步任务也计入其中
+    uint64_t tasks = after.tasks - before.tasks;
+    bool ok = *executed == TASK_COUNT && tasks >= TASK_COUNT &&
+              tasks <= TASK_COUNT + 2 &&
+              after.tasks_per_drain.sum == after.tasks &&
+              after.loop_iterations > before.loop_iterations;
+    report(ok, "tasks",
+           "tasks=" + to_string(tasks) +
+               " drains=" + to_string(after.tasks_per_drain.count -
+                                      before.tasks_per_drain.count));
+
+    poller->Shutdown();
+    loop.join();
+}
+
+static void check_events()
+{
+    EventPoller::Ptr poller = EventPoller::Create();
+    thread           loop([poller]() { poller->RunLoop(); });
+
+    int fds[2];
+    if (pipe2(fds, O_NONBLOCK | O_CLOEXEC) != 0) {
+        report(false, "events", "pipe failed");
+        poller->Shutdown();
+        loop.join();
+        return;
+    }
+
+    auto readable = make_shared<atomic<int>>(0);
+    int  read_fd  = fds[0];
+    poller->AddEvent(read_fd, PE_READ, [readable, read_fd](int) {
+        char buf[16];
+        while (read(read_fd, buf, sizeof(buf)) > 0) {
+        }
+        ++*readable;
+    });
+
+    EventPoller::Stats before = get_stats(poller);
+    for (int i = 0; i < EVENT_COUNT; i++) {
+        int expect = *readable + 1;
+        if (write(fds[1], "x", 1) != 1) {
+            break;
+        }
+        for (int n = 0; n < 1000 && *readable < expect; n++) {
+            this_thread::sleep_for(chrono::milliseconds(1));
+        }
+    }
+    EventPoller::Stats after = get_stats(poller);
+
+    uint64_t events = after.events - before.events;
+    bool ok = *readable == EVENT_COUNT && events >= EVENT_COUNT &&
+              after.events_per_wait.sum == after.events &&
+              after.events_per_wait.count <= after.loop_iterations;
+    report(ok, "events",
+           "readable=" + to_string(*readable) +
+               " events=" + to_string(events));
+
+    poller->DelEvent(read_fd);
+    poller->Shutdown();
+    loop.join();
+    close(fds[0]);
+    close(fds[1]);
+}
+
+// 投递一个慢任务和紧随其后的一个任务，后者的排队时间不小于慢任务耗时
+static void post_slow_pair(const EventPoller::Ptr& poller)
+{
+    poller->Post([]() {
+        this_thread::sleep_for(chrono::milliseconds(SLOW_TASK_MS));
+    });
+    poller->Post([]() {});
+    poller->Sync([]() {});
+}
+
+static void check_timing()
+{
+    EventPoller::Ptr poller = EventPoller::Create();
+    thread           loop([poller]() { poller->RunLoop(); });
+
+    post_slow_pair(poller);
+    EventPoller::Stats disabled = get_stats(poller);
+
+    poller->EnableStats(true);
+    post_slow_pair(poller);
+    EventPoller::Stats enabled = get_stats(poller);
+
+    uint64_t slow_us = SLOW_TASK_MS * 1000;
+    bool     off_ok  = disabled.queue_delay_us.count == 0 &&
+                  disabled.task_us.count == 0 && disabled.tasks > 0;
+    bool on_ok = enabled.task_us.count >= 2 && enabled.task_us.max >= slow_us &&
+                 enabled.queue_delay_us.count >= 2 &&
+                 enabled.queue_delay_us.max >= slow_us;
+    report(off_ok && on_ok, "timing",
+           "disabled: tasks=" + to_string(disabled.task_us.count) +
+               " enabled: tasks=" + to_string(enabled.task_us.count) +
+               " task_max=" + to_string(enabled.task_us.max) +
+               "us delay_max=" + to_string(enabled.queue_delay_us.max) +
+               "us");
+
+    poller->Shutdown();
+    loop.join();
+}
+
+static void check_timer()
+{
+    EventPoller::Ptr poller = EventPoller::Create();
+    thread           loop([poller]() { poller->RunLoop(); });
+    poller->EnableStats(true);
+
+    auto fired = make_shared<atomic<int>>(0);
+    poller->DoDelayTask(10, [fired]() -> uint64_t {
+        ++*fired;
+        return 0;
+    });
+    poller->DoDelayTaskUS(500, [fired]() -> uint64_t {
+        ++*fired;
+        return 0;
+    });
+    for (int n = 0; n < 1000 && *fired < 2; n++) {
+        this_thread::sleep_for(chrono::milliseconds(1));
+    }
+    EventPoller::Stats stats = get_stats(poller);
+
+    // 空闲的poller上延迟应当很小，这里只排除明显异常的值
+    bool ok = *fired == 2 && stats.timer_late_ms.count == 1 &&
+              stats.timer_late_ms.max < 100 &&
+              stats.timer_late_us.count == 1 &&
+              stats.timer_late_us.max < 100000 &&
+              stats.delay_task_us.count == 2;
+    report(ok, "timer",
+           "late_ms=" + to_string(stats.timer_late_ms.max) +
+               " late_us=" + to_string(stats.timer_late_us.max) +
+               " delay_tasks=" + to_string(stats.delay_task_us.count));
+
+    poller->Shutdown();
+    loop.join();
+}
+
+int main()
+{
+    Logger::Instance().AddChannel(std::make_shared<ConsoleChannel>());
+    Logger::Instance().SetWriter(
+        std::make_shared<AsyncLogWriter>(Logger::Instance()));
+
+    check_histogram();
+    check_tasks();
+    check_events();
+    check_timing();
+    check_timer();
+
+    cout << (g_failed ? "failed" : "all passed") << endl;
+    return g_failed ? 1 : 0;
+}
@@ -0,0 +1,183 @@
+#include "thread/semaphore.h"
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace common_library;
+
+/**
+ * futex信号量测试
+ * count     Post的计数累加，TryWait逐个取走，计数为0时返回false
+ * wake      自旋后进入休眠的等待者被Post唤醒
+ * timeout   WaitFor在计数为0时按时超时，期间Post则提前返回
+ * multi     多个生产者和消费者，Post与Wait的总数一致且都能返回
+ * stack     等待者返回后立即销毁栈上的信号量，Post方不再访问对象
+ */
+
+// 判断线程仍在阻塞前等待的时间
+#define BLOCK_CHECK_MS 50
+#define MULTI_THREADS  4
+#define MULTI_COUNT    20000
+#define STACK_ROUNDS   2000
+
+static int g_failed = 0;
+
+static void report(bool ok, const string& name, const string& detail)
+{
+    cout << (ok ? "[ok] " : "[failed] ") << name << " " << detail << endl;
+    if (!ok) {
+        ++g_failed;
+    }
+}
+
+static uint64_t now_ms()
+{
+    return chrono::duration_cast<chrono::milliseconds>(
+               chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+static void check_count()
+{
+    Semaphore sem;
+    bool      empty = !sem.TryWait();
+    sem.Post(3);
+    sem.Post();
+
+    int taken = 0;
+    while (sem.TryWait()) {
+        ++taken;
+    }
+    report(empty && taken == 4, "count", "taken=" + to_string(taken));
+}
+
+static void check_wake()
+{
+    Semaphore    sem;
+    atomic<bool> done{false};
+    thread       waiter([&sem, &done]() {
+        sem.Wait();
+        done = true;
+    });
+    this_thread::sleep_for(chrono::milliseconds(BLOCK_CHECK_MS));
+    bool blocked = !done;
+
+    uint64_t begin = now_ms();
+    sem.Post();
+    waiter.join();
+    uint64_t elapsed = now_ms() - begin;
+
+    report(blocked && done && elapsed < 100 && !sem.TryWait(), "wake",
+           "blocked=" + to_string(blocked) +
+               " elapsed=" + to_string(elapsed) + "ms");
+}
+
+static void check_timeout()
+{
+    Semaphore sem;
+    bool      zero_ok = !sem.WaitFor(0);
+
+    // 没有Post时等满超时时间
+    uint64_t begin     = now_ms();
+    bool     waited    = sem.WaitFor(BLOCK_CHECK_MS);
+    uint64_t timed_out = now_ms() - begin;
+
+    // 等待期间Post，提前返回true
+    thread poster([&sem]() {
+        this_thread::sleep_for(chrono::milliseconds(20));
+        sem.Post();
+    });
+    begin          = now_ms();
+    bool     woken = sem.WaitFor(1000);
+    uint64_t early = now_ms() - begin;
+    poster.join();
+
+    bool ok = zero_ok && !waited && timed_out >= BLOCK_CHECK_MS &&
+              timed_out < BLOCK_CHECK_MS + 100 && woken && early < 500;
+    report(ok, "timeout",
+           "timed_out=" + to_string(timed_out) +
+               "ms woken=" + to_string(early) + "ms");
+}
+
+static void check_multi()
+{
+    Semaphore   sem;
+    atomic<int> consumed{0};
+
+    vector<thread> threads;
+    for (int i = 0; i < MULTI_THREADS; i++) {
+        threads.emplace_back([&sem, &consumed]() {
+            for (int j = 0; j < MULTI_COUNT; j++) {
+                sem.Wait();
+                ++consumed;
+            }
+        });
+    }
+    // 一部分逐个Post，一部分批量Post
+    for (int i = 0; i < MULTI_THREADS; i++) {
+        threads.emplace_back([&sem, i]() {
+            if (i % 2 == 0) {
+                for (int j = 0; j < MULTI_COUNT; j++) {
+                    sem.Post();
+                }
+                return;
+            }
+            for (int j = 0; j < MULTI_COUNT; j += 100) {
+                sem.Post(100);
+                this_thread::yield();
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    bool ok = consumed == MULTI_THREADS * MULTI_COUNT && !sem.TryWait();
+    report(ok, "multi", "consumed=" + to_string(consumed));
+}
+
+static void check_stack()
+{
+    atomic<Semaphore*> slot{nullptr};
+    atomic<bool>       stop{false};
+    thread             poster([&slot, &stop]() {
+        while (!stop) {
+            Semaphore* sem = slot.exchange(nullptr);
+            if (sem) {
+                sem->Post();
+            }
+            else {
+                this_thread::yield();
+            }
+        }
+    });
+
+    int rounds = 0;
+    for (; rounds < STACK_ROUNDS; rounds++) {
+        Semaphore sem;
+        slot.store(&sem);
+        if (!sem.WaitFor(1000)) {
+            break;
+        }
+    }
+    stop = true;
+    poster.join();
+
+    report(rounds == STACK_ROUNDS, "stack", "rounds=" + to_string(rounds));
+}
+
+int main()
+{
+    check_count();
+    check_wake();
+    check_timeout();
+    check_multi();
+    check_stack();
+
+    cout << (g_failed ? "failed" : "all passed") << endl;
+    return g_failed ? 1 : 0;
+}
@@ -0,0 +1,402 @@
+#include "net/socket.h"
+#include "poller/event_poller.h"
+#include "thread/semaphore.h"
+#include "utils/logger.h"
+#include <atomic>
+#include <fcntl.h>
+#include <functional>
+#include <iostream>
+#include <stdlib.h>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using namespace std;
+using namespace common_library;
+
+/**
+ * Socket::SendFile测试，所有socket在同一个poller，走127.0.0.1，逐字节校验
+ * mixed      Send与SendFile交替入队，文件数据与普通数据保持调用顺序
+ * pipe       管道开始时为空，写端每隔几毫秒写入一段，验证等待管道可读后继续
+ * truncated  发送期间文件被截断，回调错误，对端只收到截断前的数据
+ * chunked    超过SOCKET_SENDFILE_CHUNK_SIZE的稀疏文件拆成多段，校验长度和末尾数据
+ * large      普通数据加超过2GiB的稀疏文件，队列长度超过int范围仍完整发出
+ */
+
+#define FILE_SIZE (3 * 1024 * 1024 + 123)
+
+static int g_failed = 0;
+
+// 只在poller线程中访问
+static vector<Socket::Ptr>                g_peers;
+static function<void(Socket::Ptr& peer)> g_on_accept;
+
+struct Received
+{
+    // keep为false时只保留末尾几个字节
+    bool     keep  = true;
+    uint64_t bytes = 0;
+    string   data;
+};
+
+struct Connection
+{
+    Socket::Ptr             client;
+    Socket::Ptr             peer;
+    shared_ptr<Received>    received;
+    shared_ptr<atomic<int>> err_code;
+};
+
+static void report(bool ok, const string& name, const string& detail)
+{
+    cout << (ok ? "[ok] " : "[failed] ") << name << " " << detail << endl;
+    if (!ok) {
+        ++g_failed;
+    }
+}
+
+static Connection connect_peer(const EventPoller::Ptr& poller,
+                               uint16_t                port,
+                               bool                    peer_recv,
+                               bool                    keep = true)
+{
+    Connection conn;
+    conn.received       = make_shared<Received>();
+    conn.received->keep = keep;
+    conn.err_code       = make_shared<atomic<int>>(ERR_SUCCESS);
+
+    // 连接完成和accept各Post一次
+    Semaphore sem;
+    poller->Sync([&]() {
+        g_on_accept = [&conn, &sem, peer_recv](Socket::Ptr& peer) {
+            auto received = conn.received;
+            peer->EnableRecv(peer_recv);
+            peer->SetOnRead([received](const Buffer::Ptr& buf,
+                                       sockaddr_storage*, socklen_t) {
+                received->bytes += buf->Size();
+                received->data.append(buf->Data(), buf->Size());
+                if (!received->keep && received->data.size() > 64) {
+                    received->data.erase(0, received->data.size() - 64);
+                }
+            });
+            conn.peer = peer;
+            sem.Post();
+        };
+
+        auto err_code = conn.err_code;
+        conn.client   = Socket::Create(poller);
+        conn.client->SetOnError([err_code](const SocketException& err) {
+            *err_code = err.GetErrCode();
+        });
+        conn.client->Connect("127.0.0.1", port,
+                             [&sem](const SocketException&) { sem.Post(); });
+    });
+    sem.Wait();
+    sem.Wait();
+    poller->Sync([]() { g_on_accept = nullptr; });
+    return conn;
+}
+
+// 在poller线程中检查cond，最多等待timeout_ms
+static bool wait_until(const EventPoller::Ptr& poller,
+                       const function<bool()>& cond,
+                       uint64_t                timeout_ms = 10000)
+{
+    uint64_t begin = get_steady_milliseconds();
+    while (get_steady_milliseconds() - begin < timeout_ms) {
+        bool done = false;
+        poller->Sync([&]() { done = cond(); });
+        if (done) {
+            return true;
+        }
+        this_thread::sleep_for(chrono::milliseconds(10));
+    }
+    return false;
+}
+
+// 创建已删除目录项的临时文件，关闭后自动释放
+static int create_temp_file()
+{
+    char path[] = "/tmp/test_send_file_XXXXXX";
+    int  fd     = mkstemp(path);
+    if (fd != -1) {
+        unlink(path);
+    }
+    return fd;
+}
+
+static string make_pattern(size_t size)
+{
+    string data(size, 0);
+    for (size_t i = 0; i < size; i++) {
+        data[i] = char(i * 7 + i / 251);
+    }
+    return data;
+}
+
+static string close_and_wait(const EventPoller::Ptr& poller,
+                             Connection&             conn,
+                             size_t                  expect_size)
+{
+    // 出错关闭后发送队列不再变化，只等待对端收完
+    wait_until(poller, [&]() {
+        return conn.received->bytes >= expect_size &&
+               (conn.client->GetSendQueueBytes() == 0 ||
+                *conn.err_code != ERR_SUCCESS);
+    });
+
+    string data;
+    poller->Sync([&]() {
+        data        = conn.received->data;
+        conn.client = nullptr;
+    });
+    return data;
+}
+
+static void check_mixed(const EventPoller::Ptr& poller, uint16_t port)
+{
+    string data = make_pattern(FILE_SIZE);
+    int    fd   = create_temp_file();
+    if (fd == -1 || write(fd, data.data(), data.size()) != FILE_SIZE) {
+        report(false, "mixed", "create file failed");
+        if (fd != -1) {
+            close(fd);
+        }
+        return;
+    }
+
+    string expect = "HEAD" + data.substr(100) + "MID" + data.substr(5, 1000) +
+                    "TAIL";
+    Connection conn = connect_peer(poller, port, true);
+    int        ret1 = -1, ret2 = -1;
+    poller->Sync([&]() {
+        conn.client->Send("HEAD", 4);
+        ret1 = conn.client->SendFile(fd, 100);
+        conn.client->Send("MID", 3);
+        ret2 = conn.client->SendFile(fd, 5, 1000);
+        conn.client->Send("TAIL", 4);
+    });
+    // SendFile内部dup了fd，入队后即可关闭
+    close(fd);
+
+    string received = close_and_wait(poller, conn, expect.size());
+    bool   ok       = ret1 == 0 && ret2 == 0 && received == expect &&
+              *conn.err_code == ERR_SUCCESS;
+    report(ok, "mixed",
+           "received=" + to_string(received.size()) + "/" +
+               to_string(expect.size()) + " err=" + to_string(*conn.err_code));
+}
+
+static void check_pipe(const EventPoller::Ptr& poller, uint16_t port)
+{
+    int pipe_fd[2];
+    if (pipe(pipe_fd) == -1) {
+        report(false, "pipe", "create pipe failed");
+        return;
+    }
+
+    string expect = "PIPE:";
+    for (int i = 0; i < 50; i++) {
+        expect += string(1000, 'a' + i % 26);
+    }
+    expect += "TAIL";
+
+    Connection conn = connect_peer(poller, port, true);
+    int        ret  = -1;
+    poller->Sync([&]() {
+        conn.client->Send("PIPE:", 5);
+        ret = conn.client->SendFile(pipe_fd[0], 0, 50 * 1000);
+        conn.client->Send("TAIL", 4);
+    });
+    close(pipe_fd[0]);
+
+    // 管道开始时为空，分多次写入
+    thread writer([&pipe_fd]() {
+        for (int i = 0; i < 50; i++) {
+            string data(1000, 'a' + i % 26);
+            if (write(pipe_fd[1], data.data(), data.size()) == -1) {
+                break;
+            }
+            this_thread::sleep_for(chrono::milliseconds(2));
+        }
+        close(pipe_fd[1]);
+    });
+
+    string received = close_and_wait(poller, conn, expect.size());
+    writer.join();
+    bool ok = ret == 0 && received == expect && *conn.err_code == ERR_SUCCESS;
+    report(ok, "pipe",
+           "received=" + to_string(received.size()) + "/" +
+               to_string(expect.size()) + " err=" + to_string(*conn.err_code));
+}
+
+static void check_truncated(const EventPoller::Ptr& poller, uint16_t port)
+{
+    string data = make_pattern(FILE_SIZE);
+    int    fd   = create_temp_file();
+    if (fd == -1 || write(fd, data.data(), data.size()) != FILE_SIZE) {
+        report(false, "truncated", "create file failed");
+        if (fd != -1) {
+            close(fd);
+        }
+        return;
+    }
+
+    // 对端暂停读取，文件只能发出一部分，剩余部分排队时截断文件
+    size_t     keep_size = 2 * 1024 * 1024;
+    Connection conn      = connect_peer(poller, port, false);
+    int        ret       = -1;
+    uint64_t   queued    = 0;
+    poller->Sync([&]() {
+        ret    = conn.client->SendFile(fd, 0);
+        queued = conn.client->GetSendQueueBytes();
+    });
+    if (ftruncate(fd, keep_size) == -1) {
+        report(false, "truncated", "ftruncate failed");
+    }
+    close(fd);
+    conn.peer->EnableRecv(true);
+
+    bool failed = wait_until(
+        poller, [&]() { return *conn.err_code != ERR_SUCCESS; }, 5000);
+    string received = close_and_wait(poller, conn, keep_size);
+
+    bool ok = ret == 0 && queued > 0 && failed &&
+              *conn.err_code == ERR_OTHER &&
+              received == data.substr(0, keep_size);
+    report(ok, "truncated",
+           "queued=" + to_string(queued) + " received=" +
+               to_string(received.size()) + " err=" +
+               to_string(*conn.err_code));
+}
+
+static void check_chunked(const EventPoller::Ptr& poller, uint16_t port)
+{
+    // 稀疏文件，只有末尾写入标记，超过一个分段的长度
+    uint64_t size   = uint64_t(SOCKET_SENDFILE_CHUNK_SIZE) + 4096;
+    string   marker = "END-OF-FILE";
+    int      fd     = create_temp_file();
+    if (fd == -1 || ftruncate(fd, size) == -1 ||
+        pwrite(fd, marker.data(), marker.size(), size - marker.size()) !=
+            (ssize_t)marker.size()) {
+        report(false, "chunked", "create file failed");
+        if (fd != -1) {
+            close(fd);
+        }
+        return;
+    }
+
+    Connection conn = connect_peer(poller, port, true, false);
+    int        ret  = -1;
+    poller->Sync([&]() { ret = conn.client->SendFile(fd); });
+    close(fd);
+
+    uint64_t begin = get_steady_milliseconds();
+    wait_until(
+        poller, [&]() { return conn.received->bytes >= size; }, 60000);
+    uint64_t cost = get_steady_milliseconds() - begin;
+
+    uint64_t bytes = 0;
+    string   tail;
+    poller->Sync([&]() {
+        bytes       = conn.received->bytes;
+        tail        = conn.received->data;
+        conn.client = nullptr;
+    });
+
+    bool ok = ret == 0 && bytes == size &&
+              tail.size() >= marker.size() &&
+              tail.compare(tail.size() - marker.size(), marker.size(),
+                           marker) == 0 &&
+              *conn.err_code == ERR_SUCCESS;
+    report(ok, "chunked",
+           "received=" + to_string(bytes) + "/" + to_string(size) +
+               " cost=" + to_string(cost) + "ms");
+}
+
+static void check_large(const EventPoller::Ptr& poller, uint16_t port)
+{
+    // 与HEAD合计超过INT_MAX，发送队列的剩余长度需要64位
+    uint64_t size   = 3 * uint64_t(SOCKET_SENDFILE_CHUNK_SIZE) + 4096;
+    string   marker = "END-OF-LARGE";
+    int      fd     = create_temp_file();
+    if (fd == -1 || ftruncate(fd, size) == -1 ||
+        pwrite(fd, marker.data(), marker.size(), size - marker.size()) !=
+            (ssize_t)marker.size()) {
+        report(false, "large", "create file failed");
+        if (fd != -1) {
+            close(fd);
+        }
+        return;
+    }
+
+    uint64_t   expect = 4 + size;
+    Connection conn   = connect_peer(poller, port, true, false);
+    int        ret    = -1;
+    poller->Sync([&]() {
+        conn.client->Send("HEAD", 4);
+        ret = conn.client->SendFile(fd);
+    });
+    close(fd);
+
+    uint64_t begin = get_steady_milliseconds();
+    wait_until(
+        poller, [&]() { return conn.received->bytes >= expect; }, 120000);
+    uint64_t cost = get_steady_milliseconds() - begin;
+
+    uint64_t bytes = 0;
+    string   tail;
+    poller->Sync([&]() {
+        bytes       = conn.received->bytes;
+        tail        = conn.received->data;
+        conn.client = nullptr;
+    });
+
+    bool ok = ret == 0 && bytes == expect &&
+              tail.size() >= marker.size() &&
+              tail.compare(tail.size() - marker.size(), marker.size(),
+                           marker) == 0 &&
+              *conn.err_code == ERR_SUCCESS;
+    report(ok, "large",
+           "received=" + to_string(bytes) + "/" + to_string(expect) +
+               " cost=" + to_string(cost) + "ms");
+}
+
+int main()
+{
+    Logger::Instance().AddChannel(std::make_shared<ConsoleChannel>());
+    Logger::Instance().SetWriter(
+        std::make_shared<AsyncLogWriter>(Logger::Instance()));
+
+    EventPoller::Ptr poller = EventPoller::Create();
+    thread           loop([poller]() { poller->RunLoop(); });
+
+    Socket::Ptr server = Socket::Create(poller);
+    poller->Sync([&]() {
+        server->SetOnAccept([](Socket::Ptr& peer) {
+            g_peers.emplace_back(peer);
+            if (g_on_accept) {
+                g_on_accept(peer);
+            }
+        });
+        server->Listen(SOCK_TCP, 0, false, "127.0.0.1");
+    });
+    uint16_t port = server->GetLocalPort();
+
+    check_mixed(poller, port);
+    check_pipe(poller, port);
+    check_truncated(poller, port);
+    check_chunked(poller, port);
+    check_large(poller, port);
+
+    poller->Sync([&]() {
+        g_peers.clear();
+        server = nullptr;
+    });
+    poller->Shutdown();
+    loop.join();
+
+    cout << (g_failed ? "failed" : "all passed") << endl;
+    return g_failed ? 1 : 0;
+}
@@ -0,0 +1,191 @@
+#include "net/socket.h"
+#include "poller/event_poller.h"
+#include "thread/semaphore.h"
+#include "utils/logger.h"
+#include <atomic>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace common_library;
+
+/**
+ * Socket::SetSendTimeout测试，客户端和服务端在同一个poller，走127.0.0.1
+ * stalled   对端暂停读取，发送队列积压，超时后回调ERR_TIMEOUT并清空队列
+ * healthy   对端正常读取，发送完成后不会误报超时
+ * disabled  开启后又关闭超时，对端暂停读取，队列保持积压且不回调错误
+ */
+
+#define SEND_TIMEOUT_SEC 1
+#define CHUNK_SIZE       (1024 * 1024)
+
+static int g_failed = 0;
+
+// 只在poller线程中访问
+static vector<Socket::Ptr> g_peers;
+static bool                g_peer_recv = true;
+static atomic<uint64_t>    g_peer_read{0};
+
+static void report(bool ok, const string& name, const string& detail)
+{
+    cout << (ok ? "[ok] " : "[failed] ") << name << " " << detail << endl;
+    if (!ok) {
+        ++g_failed;
+    }
+}
+
+static Socket::Ptr connect_client(const EventPoller::Ptr& poller,
+                                  uint16_t                port,
+                                  bool                    peer_recv,
+                                  uint32_t                timeout_sec,
+                                  atomic<int>&            err_code,
+                                  atomic<uint64_t>&       err_ms)
+{
+    Semaphore   sem;
+    Socket::Ptr client = Socket::Create(poller);
+    poller->Sync([&]() {
+        g_peer_recv = peer_recv;
+        client->SetSendTimeout(timeout_sec);
+        client->SetOnError([&err_code, &err_ms](const SocketException& err) {
+            err_ms   = get_steady_milliseconds();
+            err_code = err.GetErrCode();
+        });
+        client->Connect("127.0.0.1", port,
+                        [&sem](const SocketException&) { sem.Post(); });
+    });
+    sem.Wait();
+    return client;
+}
+
+// 在poller线程中发送，直到内核缓冲写满、数据进入发送队列
+static uint64_t fill_send_queue(const EventPoller::Ptr& poller,
+                                const Socket::Ptr&      client)
+{
+    auto chunk = make_shared<BufferRaw>();
+    chunk->Assign(string(CHUNK_SIZE, 'x').data(), CHUNK_SIZE);
+
+    uint64_t queued = 0;
+    poller->Sync([&]() {
+        for (int i = 0; i < 256 && client->GetSendQueueBytes() == 0; i++) {
+            client->Send(chunk);
+        }
+        queued = client->GetSendQueueBytes();
+    });
+    return queued;
+}
+
+static void check_stalled(const EventPoller::Ptr& poller, uint16_t port)
+{
+    atomic<int>      err_code{ERR_SUCCESS};
+    atomic<uint64_t> err_ms{0};
+    Socket::Ptr      client =
+        connect_client(poller, port, false, SEND_TIMEOUT_SEC, err_code, err_ms);
+
+    uint64_t queued = fill_send_queue(poller, client);
+    uint64_t begin  = get_steady_milliseconds();
+    while (!err_ms && get_steady_milliseconds() - begin < 5000) {
+        this_thread::sleep_for(chrono::milliseconds(10));
+    }
+
+    uint64_t left = 0;
+    poller->Sync([&]() { left = client->GetSendQueueBytes(); });
+    uint64_t cost = err_ms ? err_ms - begin : 0;
+
+    // 检查周期为POLLER_SWEEP_MS，超时时刻在[timeout, timeout + 周期]之间
+    bool ok = queued > 0 && err_code == ERR_TIMEOUT && left == 0 &&
+              cost + 50 >= SEND_TIMEOUT_SEC * 1000 &&
+              cost <= SEND_TIMEOUT_SEC * 1000 + POLLER_SWEEP_MS + 500;
+    report(ok, "stalled",
+           "queued=" + to_string(queued) + " err=" + to_string(err_code) +
+               " left=" + to_string(left) + " cost=" + to_string(cost) +
+               "ms");
+    poller->Sync([&]() { client = nullptr; });
+}
+
+static void check_healthy(const EventPoller::Ptr& poller, uint16_t port)
+{
+    atomic<int>      err_code{ERR_SUCCESS};
+    atomic<uint64_t> err_ms{0};
+    Socket::Ptr      client =
+        connect_client(poller, port, true, SEND_TIMEOUT_SEC, err_code, err_ms);
+
+    uint64_t read_begin = g_peer_read;
+    uint64_t queued     = fill_send_queue(poller, client);
+
+    // 等待对端读完所有数据，再等待超过超时时间
+    uint64_t begin = get_steady_milliseconds();
+    uint64_t left  = 1;
+    while (left && get_steady_milliseconds() - begin < 5000) {
+        this_thread::sleep_for(chrono::milliseconds(10));
+        poller->Sync([&]() { left = client->GetSendQueueBytes(); });
+    }
+    this_thread::sleep_for(
+        chrono::milliseconds(SEND_TIMEOUT_SEC * 1000 + POLLER_SWEEP_MS));
+
+    bool ok = queued > 0 && left == 0 && err_code == ERR_SUCCESS;
+    report(ok, "healthy",
+           "queued=" + to_string(queued) + " left=" + to_string(left) +
+               " err=" + to_string(err_code) +
+               " read=" + to_string(g_peer_read - read_begin));
+    poller->Sync([&]() { client = nullptr; });
+}
+
+static void check_disabled(const EventPoller::Ptr& poller, uint16_t port)
+{
+    atomic<int>      err_code{ERR_SUCCESS};
+    atomic<uint64_t> err_ms{0};
+    Socket::Ptr      client =
+        connect_client(poller, port, false, SEND_TIMEOUT_SEC, err_code, err_ms);
+    poller->Sync([&]() { client->SetSendTimeout(0); });
+
+    uint64_t queued = fill_send_queue(poller, client);
+    this_thread::sleep_for(
+        chrono::milliseconds(SEND_TIMEOUT_SEC * 1000 + POLLER_SWEEP_MS * 2));
+
+    uint64_t left = 0;
+    poller->Sync([&]() { left = client->GetSendQueueBytes(); });
+
+    bool ok = queued > 0 && left > 0 && err_code == ERR_SUCCESS;
+    report(ok, "disabled",
+           "queued=" + to_string(queued) + " left=" + to_string(left) +
+               " err=" + to_string(err_code));
+    poller->Sync([&]() { client = nullptr; });
+}
+
+int main()
+{
+    Logger::Instance().AddChannel(std::make_shared<ConsoleChannel>());
+    Logger::Instance().SetWriter(
+        std::make_shared<AsyncLogWriter>(Logger::Instance()));
+
+    EventPoller::Ptr poller = EventPoller::Create();
+    thread           loop([poller]() { poller->RunLoop(); });
+
+    Socket::Ptr server = Socket::Create(poller);
+    poller->Sync([&]() {
+        server->SetOnAccept([](Socket::Ptr& peer) {
+            peer->EnableRecv(g_peer_recv);
+            peer->SetOnRead([](const Buffer::Ptr& buf, sockaddr_storage*,
+                               socklen_t) { g_peer_read += buf->Size(); });
+            g_peers.emplace_back(peer);
+        });
+        server->Listen(SOCK_TCP, 0, false, "127.0.0.1");
+    });
+    uint16_t port = server->GetLocalPort();
+
+    check_stalled(poller, port);
+    check_healthy(poller, port);
+    check_disabled(poller, port);
+
+    poller->Sync([&]() {
+        g_peers.clear();
+        server = nullptr;
+    });
+    poller->Shutdown();
+    loop.join();
+
+    cout << (g_failed ? "failed" : "all passed") << endl;
+    return g_failed ? 1 : 0;
+}
@@ -0,0 +1,450 @@
+#include "net/socket.h"
+#include "poller/event_poller.h"
+#include "thread/semaphore.h"
+#include "utils/logger.h"
+#include <atomic>
+#include <functional>
+#include <iostream>
+#include <stdlib.h>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using namespace std;
+using namespace common_library;
+
+/**
+ * 发送队列水位、反压和硬上限测试，所有socket在同一个poller，走127.0.0.1
+ * watermark     对端暂停读取时达到高水位回调true，恢复读取后降到低水位回调false
+ * backpressure  代理场景，下游积压时暂停上游读取，下游恢复后继续，数据完整转发
+ * drop          超过上限的数据被丢弃并计数，连接保持，其余数据完整到达
+ * close         超过上限时关闭连接并回调ERR_OTHER
+ * batch         多个buffer的Send和多段SendFile整体入队或整体丢弃
+ * relay         默认设置下直接转发读回调的Buffer，下游积压期间内容不被后续读取覆盖
+ */
+
+#define CHUNK_SIZE     (1024 * 1024)
+#define LOW_WATERMARK  (1 * CHUNK_SIZE)
+#define HIGH_WATERMARK (4 * CHUNK_SIZE)
+#define QUEUE_LIMIT    (2 * CHUNK_SIZE)
+
+static int g_failed = 0;
+
+// 只在poller线程中访问
+static vector<Socket::Ptr>                g_peers;
+static function<void(Socket::Ptr& peer)> g_on_accept;
+
+struct Connection
+{
+    Socket::Ptr client;
+    // 服务端accept得到的socket
+    Socket::Ptr                  peer;
+    shared_ptr<atomic<uint64_t>> peer_read;
+};
+
+static void report(bool ok, const string& name, const string& detail)
+{
+    cout << (ok ? "[ok] " : "[failed] ") << name << " " << detail << endl;
+    if (!ok) {
+        ++g_failed;
+    }
+}
+
+static Connection connect_peer(const EventPoller::Ptr& poller,
+                               uint16_t                port,
+                               bool                    peer_recv)
+{
+    Connection conn;
+    conn.peer_read = make_shared<atomic<uint64_t>>(0);
+
+    // 连接完成和accept各Post一次
+    Semaphore sem;
+    poller->Sync([&]() {
+        g_on_accept = [&conn, &sem, peer_recv](Socket::Ptr& peer) {
+            auto read = conn.peer_read;
+            peer->EnableRecv(peer_recv);
+            peer->SetOnRead(
+                [read](const Buffer::Ptr& buf, sockaddr_storage*, socklen_t) {
+                    *read += buf->Size();
+                });
+            conn.peer = peer;
+            sem.Post();
+        };
+        conn.client = Socket::Create(poller);
+        conn.client->Connect("127.0.0.1", port,
+                             [&sem](const SocketException&) { sem.Post(); });
+    });
+    sem.Wait();
+    sem.Wait();
+    poller->Sync([]() { g_on_accept = nullptr; });
+    return conn;
+}
+
+// 在poller线程中一次性投递count个块，期间对端不会读取
+static void send_chunks(const EventPoller::Ptr& poller,
+                        const Socket::Ptr&      client,
+                        int                     count)
+{
+    auto chunk = make_shared<BufferRaw>();
+    chunk->Assign(string(CHUNK_SIZE, 'x').data(), CHUNK_SIZE);
+    poller->Sync([&]() {
+        for (int i = 0; i < count; i++) {
+            client->Send(chunk);
+        }
+    });
+}
+
+// 在poller线程中检查cond，最多等待timeout_ms
+static bool wait_until(const EventPoller::Ptr& poller,
+                       const function<bool()>& cond,
+                       uint64_t                timeout_ms = 10000)
+{
+    uint64_t begin = get_steady_milliseconds();
+    while (get_steady_milliseconds() - begin < timeout_ms) {
+        bool done = false;
+        poller->Sync([&]() { done = cond(); });
+        if (done) {
+            return true;
+        }
+        this_thread::sleep_for(chrono::milliseconds(10));
+    }
+    return false;
+}
+
+static string to_string(const vector<bool>& events)
+{
+    string str;
+    for (bool high : events) {
+        str += high ? "H" : "L";
+    }
+    return str;
+}
+
+static void check_watermark(const EventPoller::Ptr& poller, uint16_t port)
+{
+    Connection   conn = connect_peer(poller, port, false);
+    vector<bool> events;
+    poller->Sync([&]() {
+        conn.client->SetSendWatermark(
+            LOW_WATERMARK, HIGH_WATERMARK,
+            [&events](bool high) { events.emplace_back(high); });
+    });
+
+    send_chunks(poller, conn.client, 16);
+    string   paused;
+    uint64_t queued = 0;
+    poller->Sync([&]() {
+        paused = to_string(events);
+        queued = conn.client->GetSendQueueBytes();
+    });
+
+    conn.peer->EnableRecv(true);
+    bool drained = wait_until(poller, [&]() {
+        return conn.client->GetSendQueueBytes() == 0 &&
+               *conn.peer_read == 16 * CHUNK_SIZE;
+    });
+
+    string resumed;
+    poller->Sync([&]() { resumed = to_string(events); });
+    bool ok = paused == "H" && queued >= HIGH_WATERMARK && drained &&
+              resumed == "HL";
+    report(ok, "watermark",
+           "paused=" + paused + " queued=" + std::to_string(queued) +
+               " resumed=" + resumed +
+               " read=" + std::to_string(*conn.peer_read));
+
+    poller->Sync([&]() { conn.client = nullptr; });
+}
+
+static void check_backpressure(const EventPoller::Ptr& poller, uint16_t port)
+{
+    // source -> upstream(代理读) ... downstream(代理写) -> sink
+    Connection sink   = connect_peer(poller, port, false);
+    Connection source = connect_peer(poller, port, true);
+
+    Socket::Ptr downstream = sink.client;
+    Socket::Ptr upstream   = source.peer;
+    auto        forwarded  = make_shared<atomic<uint64_t>>(0);
+    bool        high       = false;
+    poller->Sync([&]() {
+        downstream->SetSendWatermark(LOW_WATERMARK, HIGH_WATERMARK,
+                                     [&high](bool is_high) { high = is_high; });
+        downstream->SetBackpressureSource(upstream);
+        // 转发的是读缓冲本身，需要交出所有权
+        upstream->SetReadBufferTransfer(true);
+        upstream->SetOnRead([downstream, forwarded](const Buffer::Ptr& buf,
+                                                    sockaddr_storage*,
+                                                    socklen_t) {
+            *forwarded += buf->Size();
+            downstream->Send(buf);
+        });
+    });
+
+    uint64_t total = 32 * CHUNK_SIZE;
+    send_chunks(poller, source.client, 32);
+    bool reached_high = wait_until(poller, [&]() { return high; });
+
+    // 上游暂停后转发量不再增长
+    this_thread::sleep_for(chrono::milliseconds(100));
+    uint64_t before = *forwarded;
+    this_thread::sleep_for(chrono::milliseconds(300));
+    uint64_t after = *forwarded;
+
+    sink.peer->EnableRecv(true);
+    bool done = wait_until(poller, [&]() { return *sink.peer_read == total; });
+
+    bool ok = reached_high && before == after && before < total && done &&
+              !high && *forwarded == total;
+    report(ok, "backpressure",
+           "paused_at=" + std::to_string(before) +
+               " forwarded=" + std::to_string(*forwarded) +
+               " sink_read=" + std::to_string(*sink.peer_read));
+
+    poller->Sync([&]() {
+        // 读回调持有downstream，先解除
+        upstream->SetOnRead(nullptr);
+        downstream->SetBackpressureSource(nullptr);
+        downstream    = nullptr;
+        upstream      = nullptr;
+        sink.client   = nullptr;
+        source.client = nullptr;
+    });
+}
+
+static void check_drop(const EventPoller::Ptr& poller, uint16_t port)
+{
+    Connection  conn = connect_peer(poller, port, false);
+    atomic<int> err_code{ERR_SUCCESS};
+    poller->Sync([&]() {
+        conn.client->SetSendQueueLimit(QUEUE_LIMIT);
+        conn.client->SetOnError([&err_code](const SocketException& err) {
+            err_code = err.GetErrCode();
+        });
+    });
+
+    send_chunks(poller, conn.client, 16);
+    uint64_t queued  = 0;
+    uint64_t dropped = 0;
+    poller->Sync([&]() {
+        queued  = conn.client->GetSendQueueBytes();
+        dropped = conn.client->GetSendDroppedBytes();
+    });
+
+    conn.peer->EnableRecv(true);
+    uint64_t expect = 16 * CHUNK_SIZE - dropped;
+    bool     done =
+        wait_until(poller, [&]() { return *conn.peer_read == expect; });
+
+    bool ok = dropped > 0 && queued <= QUEUE_LIMIT && done &&
+              err_code == ERR_SUCCESS;
+    report(ok, "drop",
+           "queued=" + std::to_string(queued) +
+               " dropped=" + std::to_string(dropped) +
+               " read=" + std::to_string(*conn.peer_read) +
+               " err=" + std::to_string(err_code));
+
+    poller->Sync([&]() { conn.client = nullptr; });
+}
+
+static void check_batch(const EventPoller::Ptr& poller, uint16_t port)
+{
+    Connection conn = connect_peer(poller, port, false);
+    poller->Sync([&]() { conn.client->SetSendQueueLimit(QUEUE_LIMIT); });
+
+    auto chunk = make_shared<BufferRaw>();
+    chunk->Assign(string(CHUNK_SIZE, 'x').data(), CHUNK_SIZE);
+    auto small = make_shared<BufferRaw>();
+    small->Assign(string(CHUNK_SIZE / 4, 'y').data(), CHUNK_SIZE / 4);
+
+    // 稀疏文件，按SOCKET_SENDFILE_CHUNK_SIZE拆成两段，第二段很小
+    uint64_t file_size = uint64_t(SOCKET_SENDFILE_CHUNK_SIZE) + 4096;
+    char     path[]    = "/tmp/test_send_watermark_XXXXXX";
+    int      fd        = mkstemp(path);
+    if (fd != -1) {
+        unlink(path);
+    }
+    if (fd == -1 || ftruncate(fd, file_size) == -1) {
+        report(false, "batch", "create file failed");
+        if (fd != -1) {
+            close(fd);
+        }
+        poller->Sync([&]() { conn.client = nullptr; });
+        return;
+    }
+
+    uint64_t sent = 0, before = 0;
+    uint64_t big_dropped = 0, big_queued = 0;
+    uint64_t file_dropped = 0, file_queued = 0;
+    uint64_t small_queued = 0;
+    int      big_ret = 0, file_ret = 0, small_ret = -1;
+    poller->Sync([&]() {
+        // 先写满内核缓冲，使后续数据进入发送队列
+        for (int i = 0; i < 256 && conn.client->GetSendQueueBytes() == 0;
+             i++) {
+            conn.client->Send(chunk);
+            sent += CHUNK_SIZE;
+        }
+        before = conn.client->GetSendQueueBytes();
+
+        // 整批超过上限，一个都不入队
+        big_ret     = conn.client->Send({chunk, chunk, small});
+        big_dropped = conn.client->GetSendDroppedBytes();
+        big_queued  = conn.client->GetSendQueueBytes();
+
+        file_ret     = conn.client->SendFile(fd);
+        file_dropped = conn.client->GetSendDroppedBytes() - big_dropped;
+        file_queued  = conn.client->GetSendQueueBytes();
+
+        // 整批未超过上限，全部入队
+        small_ret    = conn.client->Send({small, small});
+        small_queued = conn.client->GetSendQueueBytes();
+    });
+    close(fd);
+
+    conn.peer->EnableRecv(true);
+    uint64_t expect = sent + 2 * small->Size();
+    bool     done =
+        wait_until(poller, [&]() { return *conn.peer_read == expect; });
+
+    bool ok = before > 0 && before <= QUEUE_LIMIT / 2 && big_ret == -1 &&
+              big_dropped == 2 * CHUNK_SIZE + small->Size() &&
+              big_queued == before && file_ret == -1 &&
+              file_dropped == file_size && file_queued == before &&
+              small_ret == 0 && small_queued == before + 2 * small->Size() &&
+              done;
+    report(ok, "batch",
+           "queued=" + std::to_string(before) +
+               " dropped=" + std::to_string(big_dropped) + "+" +
+               std::to_string(file_dropped) +
+               " read=" + std::to_string(*conn.peer_read) + "/" +
+               std::to_string(expect));
+
+    poller->Sync([&]() { conn.client = nullptr; });
+}
+
+static void check_relay(const EventPoller::Ptr& poller, uint16_t port)
+{
+    // source -> upstream(代理读) ... downstream(代理写) -> sink
+    Connection sink   = connect_peer(poller, port, false);
+    Connection source = connect_peer(poller, port, true);
+
+    Socket::Ptr downstream = sink.client;
+    Socket::Ptr upstream   = source.peer;
+    string      received;
+    poller->Sync([&]() {
+        sink.peer->SetOnRead(
+            [&received](const Buffer::Ptr& buf, sockaddr_storage*, socklen_t) {
+                received.append(buf->Data(), buf->Size());
+            });
+        // 不调用SetReadBufferTransfer，使用默认设置
+        upstream->SetOnRead([downstream](const Buffer::Ptr& buf,
+                                         sockaddr_storage*, socklen_t) {
+            downstream->Send(buf);
+        });
+    });
+
+    // 每块内容不同，被覆盖时可以发现
+    string expect;
+    poller->Sync([&]() {
+        for (int i = 0; i < 8; i++) {
+            string data(CHUNK_SIZE, 0);
+            for (size_t j = 0; j < data.size(); j++) {
+                data[j] = char(j * 7 + j / 251 + i);
+            }
+            expect += data;
+            source.client->Send(data.data(), data.size());
+        }
+    });
+
+    // 下游对端暂停读取，数据在downstream队列中积压
+    bool queued = wait_until(poller, [&]() {
+        return downstream->GetSendQueueBytes() > 0 &&
+               source.client->GetSendQueueBytes() == 0;
+    });
+    sink.peer->EnableRecv(true);
+    bool done =
+        wait_until(poller, [&]() { return received.size() >= expect.size(); });
+
+    bool match = false;
+    poller->Sync([&]() { match = received == expect; });
+    bool ok = queued && done && match;
+    report(ok, "relay",
+           "received=" + std::to_string(received.size()) + "/" +
+               std::to_string(expect.size()) +
+               " match=" + std::to_string(match));
+
+    poller->Sync([&]() {
+        upstream->SetOnRead(nullptr);
+        sink.peer->SetOnRead(nullptr);
+        downstream    = nullptr;
+        upstream      = nullptr;
+        sink.client   = nullptr;
+        source.client = nullptr;
+    });
+}
+
+static void check_close(const EventPoller::Ptr& poller, uint16_t port)
+{
+    Connection  conn = connect_peer(poller, port, false);
+    atomic<int> err_code{ERR_SUCCESS};
+    poller->Sync([&]() {
+        conn.client->SetSendQueueLimit(QUEUE_LIMIT, true);
+        conn.client->SetOnError([&err_code](const SocketException& err) {
+            err_code = err.GetErrCode();
+        });
+    });
+
+    send_chunks(poller, conn.client, 16);
+    bool closed =
+        wait_until(poller, [&]() { return err_code != ERR_SUCCESS; }, 1000);
+
+    uint64_t dropped = 0;
+    poller->Sync([&]() { dropped = conn.client->GetSendDroppedBytes(); });
+
+    bool ok = closed && err_code == ERR_OTHER && dropped == 0;
+    report(ok, "close",
+           "err=" + std::to_string(err_code) +
+               " dropped=" + std::to_string(dropped));
+
+    poller->Sync([&]() { conn.client = nullptr; });
+}
+
+int main()
+{
+    Logger::Instance().AddChannel(std::make_shared<ConsoleChannel>());
+    Logger::Instance().SetWriter(
+        std::make_shared<AsyncLogWriter>(Logger::Instance()));
+
+    EventPoller::Ptr poller = EventPoller::Create();
+    thread           loop([poller]() { poller->RunLoop(); });
+
+    Socket::Ptr server = Socket::Create(poller);
+    poller->Sync([&]() {
+        server->SetOnAccept([](Socket::Ptr& peer) {
+            g_peers.emplace_back(peer);
+            if (g_on_accept) {
+                g_on_accept(peer);
+            }
+        });
+        server->Listen(SOCK_TCP, 0, false, "127.0.0.1");
+    });
+    uint16_t port = server->GetLocalPort();
+
+    check_watermark(poller, port);
+    check_backpressure(poller, port);
+    check_drop(poller, port);
+    check_close(poller, port);
+    check_batch(poller, port);
+    check_relay(poller, port);
+
+    poller->Sync([&]() {
+        g_peers.clear();
+        server = nullptr;
+    });
+    poller->Shutdown();
+    loop.join();
+
+    cout << (g_failed ? "failed" : "all passed") << endl;
+    return g_failed ? 1 : 0;
+}
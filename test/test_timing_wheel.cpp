@@ -0,0 +1,220 @@
+#include "poller/timing_wheel.h"
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace common_library;
+
+/**
+ * TimingWheel测试，直接驱动时间轮，不依赖真实时钟
+ * exact     按NextTimeoutMS推进，各层级和超出范围的节点都恰好在到期时刻触发
+ * random    随机步长推进，节点不提前触发，且在跨过到期时刻的那次推进中触发
+ * cancel    级联前后删除的节点不再触发，Size立即减少
+ * reentry   回调中重新加入自身并删除其他节点
+ */
+
+#define START_MS 123456789ULL
+
+static int g_failed = 0;
+
+struct TestNode : public TimingWheelNode
+{
+    uint64_t expire   = 0;
+    uint64_t fired_at = 0;
+    int      fired    = 0;
+};
+
+static void report(bool ok, const string& name, const string& detail)
+{
+    cout << (ok ? "[ok] " : "[failed] ") << name << " " << detail << endl;
+    if (!ok) {
+        ++g_failed;
+    }
+}
+
+// 固定种子的伪随机数，结果可重现
+static uint64_t next_rand(uint64_t& seed)
+{
+    seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+    return seed >> 33;
+}
+
+static void check_exact()
+{
+    // 覆盖第0层、各层边界、级联点前后以及超出2^32毫秒的节点
+    // 有高层节点时每256ms级联一次，步数约为最大延时/256
+    vector<uint64_t> delays = {0,        1,         255,
+                               256,      257,       16383,
+                               16384,    16385,     1048575,
+                               1048576,  1048577,   67108863,
+                               67108864, 67108865,  (1ULL << 32) - 1,
+                               1ULL << 32, (1ULL << 32) + 5};
+
+    TimingWheel      wheel(START_MS);
+    vector<TestNode> nodes(delays.size());
+    for (size_t i = 0; i < delays.size(); i++) {
+        nodes[i].expire = START_MS + delays[i];
+        wheel.Add(&nodes[i], nodes[i].expire);
+    }
+
+    uint64_t now   = START_MS;
+    uint64_t steps = 0;
+    auto     fire  = [&now](TimingWheelNode* node) {
+        TestNode* n = static_cast<TestNode*>(node);
+        n->fired_at = now;
+        ++n->fired;
+    };
+    wheel.Advance(now, fire);
+    while (!wheel.Empty() && steps < (1 << 25)) {
+        now += wheel.NextTimeoutMS(now);
+        wheel.Advance(now, fire);
+        ++steps;
+    }
+
+    int bad = 0;
+    for (TestNode& node : nodes) {
+        if (node.fired != 1 || node.fired_at != node.expire) {
+            ++bad;
+        }
+    }
+    report(bad == 0 && wheel.Empty(), "exact",
+           "nodes=" + to_string(nodes.size()) + " bad=" + to_string(bad) +
+               " steps=" + to_string(steps));
+}
+
+static void check_random()
+{
+    uint64_t         seed = 1;
+    TimingWheel      wheel(START_MS);
+    vector<TestNode> nodes(20000);
+    for (TestNode& node : nodes) {
+        // 大部分在前几层，少量跨越更高层
+        uint64_t range = (next_rand(seed) % 4 == 0) ? (1ULL << 26) : 70000;
+        node.expire    = START_MS + next_rand(seed) % range;
+        wheel.Add(&node, node.expire);
+    }
+
+    uint64_t prev  = START_MS;
+    uint64_t now   = START_MS;
+    int      early = 0;
+    int      late  = 0;
+    while (!wheel.Empty()) {
+        prev = now;
+        now += 1 + next_rand(seed) % 5000;
+        wheel.Advance(now, [&](TimingWheelNode* node) {
+            TestNode* n = static_cast<TestNode*>(node);
+            ++n->fired;
+            if (n->expire > now) {
+                ++early;
+            }
+            // 上一次推进时已经到期却没有触发
+            if (n->expire <= prev) {
+                ++late;
+            }
+        });
+    }
+
+    int missed = 0;
+    for (TestNode& node : nodes) {
+        if (node.fired != 1) {
+            ++missed;
+        }
+    }
+    report(early == 0 && late == 0 && missed == 0, "random",
+           "early=" + to_string(early) + " late=" + to_string(late) +
+               " missed=" + to_string(missed));
+}
+
+static void check_cancel()
+{
+    uint64_t         seed = 7;
+    TimingWheel      wheel(START_MS);
+    vector<TestNode> nodes(10000);
+    for (TestNode& node : nodes) {
+        node.expire = START_MS + 1 + next_rand(seed) % (1ULL << 22);
+        wheel.Add(&node, node.expire);
+    }
+
+    // 先删除一半，推进一段时间(发生级联)后再删除剩余中的一部分
+    uint64_t removed = 0;
+    for (size_t i = 0; i < nodes.size(); i += 2) {
+        wheel.Remove(&nodes[i]);
+        ++removed;
+    }
+    bool size_ok = wheel.Size() == nodes.size() - removed;
+
+    uint64_t now = START_MS + (1ULL << 20);
+    wheel.Advance(now, [](TimingWheelNode* node) {
+        ++static_cast<TestNode*>(node)->fired;
+    });
+
+    vector<bool> canceled(nodes.size(), false);
+    for (size_t i = 0; i < nodes.size(); i++) {
+        canceled[i] = i % 2 == 0;
+        if (i % 3 == 1 && nodes[i].IsLinked()) {
+            wheel.Remove(&nodes[i]);
+            canceled[i] = true;
+        }
+    }
+    wheel.Advance(START_MS + (1ULL << 23), [](TimingWheelNode* node) {
+        ++static_cast<TestNode*>(node)->fired;
+    });
+
+    // 第二次删除只针对仍在时间轮中的节点，删除的节点都没有触发过
+    int bad = 0;
+    for (size_t i = 0; i < nodes.size(); i++) {
+        int expect = canceled[i] ? 0 : 1;
+        if (nodes[i].fired != expect || nodes[i].IsLinked()) {
+            ++bad;
+        }
+    }
+    report(size_ok && bad == 0 && wheel.Empty(), "cancel",
+           "removed=" + to_string(removed) + " bad=" + to_string(bad) +
+               " left=" + to_string(wheel.Size()));
+}
+
+static void check_reentry()
+{
+    TimingWheel wheel(START_MS);
+    TestNode    periodic;
+    TestNode    victim;
+    periodic.expire = START_MS + 10;
+    victim.expire   = START_MS + 1000;
+    wheel.Add(&periodic, periodic.expire);
+    wheel.Add(&victim, victim.expire);
+
+    // 周期节点每10ms触发一次，第5次时删除victim
+    uint64_t now = START_MS;
+    while (now < START_MS + 2000) {
+        now += 1;
+        wheel.Advance(now, [&](TimingWheelNode* node) {
+            TestNode* n = static_cast<TestNode*>(node);
+            ++n->fired;
+            if (n != &periodic) {
+                return;
+            }
+            if (n->fired == 5) {
+                wheel.Remove(&victim);
+            }
+            n->expire += 10;
+            wheel.Add(n, n->expire);
+        });
+    }
+
+    bool ok = periodic.fired == 200 && victim.fired == 0 && wheel.Size() == 1;
+    report(ok, "reentry",
+           "periodic=" + to_string(periodic.fired) +
+               " victim=" + to_string(victim.fired));
+}
+
+int main()
+{
+    check_exact();
+    check_random();
+    check_cancel();
+    check_reentry();
+
+    cout << (g_failed ? "failed" : "all passed") << endl;
+    return g_failed ? 1 : 0;
+}
@@ -0,0 +1,267 @@
+#include "net/socket.h"
+#include "poller/event_poller.h"
+#include "thread/semaphore.h"
+#include "utils/logger.h"
+#include <arpa/inet.h>
+#include <iostream>
+#include <memory>
+#include <netinet/in.h>
+#include <string.h>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using namespace std;
+using namespace common_library;
+
+/**
+ * UDP recvmmsg批量接收测试，走127.0.0.1
+ * 发送前阻塞poller使数据报积压在接收缓存中，每次recvmmsg取到的个数可预期
+ * batch     积压的数据报按批量大小分批回调，最后一批不满，内容和顺序不变
+ * single    未设置BatchReadCB时逐个回调ReadCB
+ * truncate  超过packet_size的数据报被丢弃，前后的数据报正常到达
+ * resize    回调中修改批量大小，之后按新的大小接收
+ */
+
+#define PACKET_COUNT 60
+#define BATCH_SIZE   8
+
+static int g_failed = 0;
+
+static void report(bool ok, const string& name, const string& detail)
+{
+    cout << (ok ? "[ok] " : "[failed] ") << name << " " << detail << endl;
+    if (!ok) {
+        ++g_failed;
+    }
+}
+
+// 只在poller线程中修改
+struct Received
+{
+    typedef std::shared_ptr<Received> Ptr;
+
+    vector<string> packets;
+    vector<size_t> batches;
+};
+
+// 第i个数据报的内容，长度在10~209之间变化
+static string make_packet(int i)
+{
+    string packet = "packet " + to_string(i) + " ";
+    packet.resize(10 + i * 37 % 200, static_cast<char>('a' + i % 26));
+    return packet;
+}
+
+// 连接到port的普通UDP socket，用于发送
+static int create_sender(uint16_t port)
+{
+    int         fd = socket(AF_INET, SOCK_DGRAM, 0);
+    sockaddr_in addr;
+    bzero(&addr, sizeof(addr));
+    addr.sin_family      = AF_INET;
+    addr.sin_port        = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+    return fd;
+}
+
+static Socket::Ptr create_receiver(const EventPoller::Ptr& poller,
+                                   const Received::Ptr&    received,
+                                   uint32_t                packet_size,
+                                   bool                    batch_cb)
+{
+    Socket::Ptr sock = Socket::Create(poller);
+    sock->SetRecvBatch(BATCH_SIZE, packet_size);
+    if (batch_cb) {
+        sock->SetOnBatchRead([received](const vector<UdpPacket>& packets) {
+            for (const UdpPacket& packet : packets) {
+                received->packets.push_back(packet.buffer->ToString());
+            }
+            received->batches.push_back(packets.size());
+        });
+    }
+    else {
+        sock->SetOnRead(
+            [received](const Buffer::Ptr& buf, sockaddr_storage*, socklen_t) {
+                received->packets.push_back(buf->ToString());
+            });
+    }
+    if (!sock->Listen(SOCK_UDP, 0, false, "127.0.0.1")) {
+        return nullptr;
+    }
+    return sock;
+}
+
+// 阻塞poller期间发送packets，之后等待收到expect个数据报
+static void send_blocked(const EventPoller::Ptr& poller,
+                         uint16_t                port,
+                         const vector<string>&   packets,
+                         const Received::Ptr&    received,
+                         size_t                  expect)
+{
+    Semaphore blocked;
+    Semaphore release;
+    poller->Post([&blocked, &release]() {
+        blocked.Post();
+        release.Wait();
+    });
+    blocked.Wait();
+
+    int fd = create_sender(port);
+    for (const string& packet : packets) {
+        send(fd, packet.data(), packet.size(), 0);
+    }
+    close(fd);
+    release.Post();
+
+    size_t size = 0;
+    for (int i = 0; i < 1000 && size < expect; i++) {
+        poller->Sync([&size, received]() { size = received->packets.size(); });
+        if (size < expect) {
+            this_thread::sleep_for(chrono::milliseconds(1));
+        }
+    }
+}
+
+static string batches_string(const vector<size_t>& batches)
+{
+    string str;
+    for (size_t size : batches) {
+        str += (str.empty() ? "" : ",") + to_string(size);
+    }
+    return str;
+}
+
+static void check_batch(const EventPoller::Ptr& poller)
+{
+    auto        received = make_shared<Received>();
+    Socket::Ptr sock     = create_receiver(poller, received, 2048, true);
+    if (!sock) {
+        report(false, "batch", "listen failed");
+        return;
+    }
+
+    vector<string> packets;
+    for (int i = 0; i < PACKET_COUNT; i++) {
+        packets.push_back(make_packet(i));
+    }
+    send_blocked(poller, sock->GetLocalPort(), packets, received,
+                 packets.size());
+
+    // 7批满的和最后不满的一批4个
+    vector<size_t> expect(PACKET_COUNT / BATCH_SIZE, BATCH_SIZE);
+    expect.push_back(PACKET_COUNT % BATCH_SIZE);
+    bool ok = false;
+    poller->Sync([&]() {
+        ok = received->packets == packets && received->batches == expect;
+    });
+    report(ok, "batch",
+           "received=" + to_string(received->packets.size()) +
+               " batches=" + batches_string(received->batches));
+
+    poller->Sync([&sock]() { sock = nullptr; });
+}
+
+static void check_single(const EventPoller::Ptr& poller)
+{
+    auto        received = make_shared<Received>();
+    Socket::Ptr sock     = create_receiver(poller, received, 2048, false);
+    if (!sock) {
+        report(false, "single", "listen failed");
+        return;
+    }
+
+    vector<string> packets;
+    for (int i = 0; i < BATCH_SIZE * 2 + 3; i++) {
+        packets.push_back(make_packet(i));
+    }
+    send_blocked(poller, sock->GetLocalPort(), packets, received,
+                 packets.size());
+
+    bool ok = false;
+    poller->Sync([&]() { ok = received->packets == packets; });
+    report(ok, "single", "received=" + to_string(received->packets.size()));
+
+    poller->Sync([&sock]() { sock = nullptr; });
+}
+
+static void check_truncate(const EventPoller::Ptr& poller)
+{
+    auto        received = make_shared<Received>();
+    Socket::Ptr sock     = create_receiver(poller, received, 256, true);
+    if (!sock) {
+        report(false, "truncate", "listen failed");
+        return;
+    }
+
+    vector<string> packets = {string(100, 'a'), string(300, 'b'),
+                              string(256, 'c'), string(257, 'd'),
+                              string(10, 'e')};
+    send_blocked(poller, sock->GetLocalPort(), packets, received, 3);
+
+    vector<string> expect = {packets[0], packets[2], packets[4]};
+    bool           ok     = false;
+    poller->Sync([&]() { ok = received->packets == expect; });
+    report(ok, "truncate", "received=" + to_string(received->packets.size()));
+
+    poller->Sync([&sock]() { sock = nullptr; });
+}
+
+static void check_resize(const EventPoller::Ptr& poller)
+{
+    auto        received = make_shared<Received>();
+    Socket::Ptr sock     = Socket::Create(poller);
+    sock->SetRecvBatch(BATCH_SIZE);
+    Socket* raw = sock.get();
+    sock->SetOnBatchRead([received, raw](const vector<UdpPacket>& packets) {
+        for (const UdpPacket& packet : packets) {
+            received->packets.push_back(packet.buffer->ToString());
+        }
+        received->batches.push_back(packets.size());
+        raw->SetRecvBatch(3);
+    });
+    if (!sock->Listen(SOCK_UDP, 0, false, "127.0.0.1")) {
+        report(false, "resize", "listen failed");
+        return;
+    }
+
+    vector<string> packets;
+    for (int i = 0; i < 20; i++) {
+        packets.push_back(make_packet(i));
+    }
+    send_blocked(poller, sock->GetLocalPort(), packets, received,
+                 packets.size());
+
+    vector<size_t> expect = {BATCH_SIZE, 3, 3, 3, 3};
+    bool           ok     = false;
+    poller->Sync([&]() {
+        ok = received->packets == packets && received->batches == expect;
+    });
+    report(ok, "resize", "batches=" + batches_string(received->batches));
+
+    poller->Sync([&sock]() { sock = nullptr; });
+}
+
+int main()
+{
+    Logger::Instance().AddChannel(std::make_shared<ConsoleChannel>());
+    Logger::Instance().SetWriter(
+        std::make_shared<AsyncLogWriter>(Logger::Instance()));
+
+    EventPoller::Ptr poller = EventPoller::Create();
+    thread           loop([poller]() { poller->RunLoop(); });
+
+    check_batch(poller);
+    check_single(poller);
+    check_truncate(poller);
+    check_resize(poller);
+
+    poller->Shutdown();
+    loop.join();
+
+    cout << (g_failed ? "failed" : "all passed") << endl;
+    return g_failed ? 1 : 0;
+}
@@ -0,0 +1,260 @@
+#include "net/socket.h"
+#include "poller/event_poller.h"
+#include "utils/logger.h"
+#include <arpa/inet.h>
+#include <iostream>
+#include <memory>
+#include <netinet/in.h>
+#include <poll.h>
+#include <string.h>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using namespace std;
+using namespace common_library;
+
+/**
+ * UDP分段发送和GRO接收测试，走127.0.0.1
+ * 内核不支持UDP_SEGMENT时在用户态切分，对端看到的数据报与内核切分相同
+ * segment   一次Send的数据按分段大小切成多个数据报，最后一个不满，内容顺序不变
+ * large     超过单次GSO上限的数据分多次交给内核，所有分段完整到达
+ * disable   关闭分段后一次Send只发出一个数据报
+ * gro       开启GRO的Socket收到合并的数据报后拆分，逐个回调，批量接收时也一样
+ */
+
+#define SEGMENT_SIZE 1000
+
+static int g_failed = 0;
+
+static void report(bool ok, const string& name, const string& detail)
+{
+    cout << (ok ? "[ok] " : "[failed] ") << name << " " << detail << endl;
+    if (!ok) {
+        ++g_failed;
+    }
+}
+
+// 长度为size的数据，内容随位置变化，错位或丢失都能发现
+static string make_payload(size_t size)
+{
+    string payload(size, '\0');
+    for (size_t i = 0; i < size; i++) {
+        payload[i] = static_cast<char>('a' + (i * 7 + i / 251) % 26);
+    }
+    return payload;
+}
+
+// 按分段大小切分payload得到的数据报
+static vector<string> split_payload(const string& payload, size_t segment)
+{
+    vector<string> packets;
+    for (size_t offset = 0; offset < payload.size(); offset += segment) {
+        packets.push_back(payload.substr(offset, segment));
+    }
+    return packets;
+}
+
+// 绑定127.0.0.1随机端口的普通UDP socket，接收缓存足够容纳所有数据报
+static int create_receiver(sockaddr_storage& addr, socklen_t& len)
+{
+    int         fd = socket(AF_INET, SOCK_DGRAM, 0);
+    sockaddr_in local;
+    bzero(&local, sizeof(local));
+    local.sin_family      = AF_INET;
+    local.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bind(fd, reinterpret_cast<sockaddr*>(&local), sizeof(local));
+    int rcvbuf = 4 * 1024 * 1024;
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+
+    len = sizeof(addr);
+    getsockname(fd, reinterpret_cast<sockaddr*>(&addr), &len);
+    return fd;
+}
+
+// 等待收到expect个数据报，最多等待timeout_ms
+static vector<string> recv_packets(int fd, size_t expect, int timeout_ms)
+{
+    vector<string> packets;
+    char           buf[65536];
+    while (packets.size() < expect) {
+        struct pollfd pfd = {fd, POLLIN, 0};
+        if (poll(&pfd, 1, timeout_ms) <= 0) {
+            break;
+        }
+        ssize_t n;
+        while ((n = recv(fd, buf, sizeof(buf), MSG_DONTWAIT)) >= 0) {
+            packets.emplace_back(buf, n);
+        }
+    }
+    return packets;
+}
+
+static Socket::Ptr create_sender(const EventPoller::Ptr& poller,
+                                 uint16_t                segment)
+{
+    Socket::Ptr sock = Socket::Create(poller);
+    sock->SetSendSegment(segment);
+    if (!sock->Listen(SOCK_UDP, 0, false, "127.0.0.1")) {
+        return nullptr;
+    }
+    return sock;
+}
+
+static string sizes_string(const vector<string>& packets)
+{
+    string str;
+    for (size_t i = 0; i < packets.size() && i < 3; i++) {
+        str += (i ? "," : "") + to_string(packets[i].size());
+    }
+    if (packets.size() > 3) {
+        str += ",...," + to_string(packets.back().size());
+    }
+    return str;
+}
+
+// 发送payload，对端收到的数据报应与expect一致
+static void check_send(const EventPoller::Ptr& poller,
+                       const string&           name,
+                       uint16_t                segment,
+                       const string&           payload,
+                       const vector<string>&   expect)
+{
+    sockaddr_storage addr;
+    socklen_t        len;
+    int              recv_fd = create_receiver(addr, len);
+    Socket::Ptr      sock    = create_sender(poller, segment);
+    if (!sock) {
+        report(false, name, "listen failed");
+        close(recv_fd);
+        return;
+    }
+
+    poller->Sync(
+        [&]() { sock->Send(payload.data(), payload.size(), &addr, len); });
+    vector<string> received = recv_packets(recv_fd, expect.size(), 1000);
+
+    report(received == expect, name,
+           "packets=" + to_string(received.size()) +
+               " sizes=" + sizes_string(received));
+
+    poller->Sync([&sock]() { sock = nullptr; });
+    close(recv_fd);
+}
+
+static void check_disable(const EventPoller::Ptr& poller)
+{
+    sockaddr_storage addr;
+    socklen_t        len;
+    int              recv_fd = create_receiver(addr, len);
+    Socket::Ptr      sock    = create_sender(poller, SEGMENT_SIZE);
+    if (!sock) {
+        report(false, "disable", "listen failed");
+        close(recv_fd);
+        return;
+    }
+
+    string payload = make_payload(SEGMENT_SIZE * 3);
+    poller->Sync([&]() {
+        sock->SetSendSegment(0);
+        sock->Send(payload.data(), payload.size(), &addr, len);
+    });
+    vector<string> received = recv_packets(recv_fd, 1, 1000);
+
+    // 多等一会，确认没有多余的数据报
+    vector<string> extra = recv_packets(recv_fd, 1, 50);
+    report(received == vector<string>({payload}) && extra.empty(), "disable",
+           "packets=" + to_string(received.size() + extra.size()) +
+               " sizes=" + sizes_string(received));
+
+    poller->Sync([&sock]() { sock = nullptr; });
+    close(recv_fd);
+}
+
+// 只在poller线程中修改
+struct Received
+{
+    typedef std::shared_ptr<Received> Ptr;
+
+    vector<string> packets;
+};
+
+static void check_gro(const EventPoller::Ptr& poller, bool batch)
+{
+    string name     = batch ? "gro batch" : "gro";
+    auto   received = make_shared<Received>();
+
+    Socket::Ptr receiver = Socket::Create(poller);
+    receiver->SetRecvGRO(true);
+    if (batch) {
+        receiver->SetRecvBatch(8);
+    }
+    receiver->SetOnRead(
+        [received](const Buffer::Ptr& buf, sockaddr_storage*, socklen_t) {
+            received->packets.push_back(buf->ToString());
+        });
+    Socket::Ptr sender = create_sender(poller, SEGMENT_SIZE);
+    if (!sender || !receiver->Listen(SOCK_UDP, 0, false, "127.0.0.1")) {
+        report(false, name, "listen failed");
+        return;
+    }
+
+    sockaddr_in dest;
+    bzero(&dest, sizeof(dest));
+    dest.sin_family      = AF_INET;
+    dest.sin_port        = htons(receiver->GetLocalPort());
+    dest.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    sockaddr_storage addr;
+    memcpy(&addr, &dest, sizeof(dest));
+
+    string payload = make_payload(SEGMENT_SIZE * 20 + 300);
+    poller->Sync([&]() {
+        sender->Send(payload.data(), payload.size(), &addr, sizeof(dest));
+    });
+
+    vector<string> expect = split_payload(payload, SEGMENT_SIZE);
+    vector<string> packets;
+    for (int i = 0; i < 1000 && packets.size() < expect.size(); i++) {
+        this_thread::sleep_for(chrono::milliseconds(1));
+        poller->Sync([&packets, received]() { packets = received->packets; });
+    }
+
+    report(packets == expect, name,
+           "packets=" + to_string(packets.size()) +
+               " sizes=" + sizes_string(packets));
+
+    poller->Sync([&]() {
+        sender   = nullptr;
+        receiver = nullptr;
+    });
+}
+
+int main()
+{
+    Logger::Instance().AddChannel(std::make_shared<ConsoleChannel>());
+    Logger::Instance().SetWriter(
+        std::make_shared<AsyncLogWriter>(Logger::Instance()));
+
+    EventPoller::Ptr poller = EventPoller::Create();
+    thread           loop([poller]() { poller->RunLoop(); });
+
+    string payload = make_payload(SEGMENT_SIZE * 10 + 500);
+    check_send(poller, "segment", SEGMENT_SIZE, payload,
+               split_payload(payload, SEGMENT_SIZE));
+
+    // 1400字节的分段每次最多交给内核46个
+    string large = make_payload(200000);
+    check_send(poller, "large", 1400, large, split_payload(large, 1400));
+
+    check_disable(poller);
+    check_gro(poller, false);
+    check_gro(poller, true);
+
+    poller->Shutdown();
+    loop.join();
+
+    cout << (g_failed ? "failed" : "all passed") << endl;
+    return g_failed ? 1 : 0;
+}
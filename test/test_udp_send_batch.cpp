@@ -0,0 +1,255 @@
+#include "net/buffer.h"
+#include "net/socket.h"
+#include "poller/event_poller.h"
+#include "thread/semaphore.h"
+#include "utils/logger.h"
+#include <arpa/inet.h>
+#include <errno.h>
+#include <iostream>
+#include <netinet/in.h>
+#include <poll.h>
+#include <string.h>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using namespace std;
+using namespace common_library;
+
+/**
+ * UDP sendmmsg批量发送测试
+ * partial  BufferList发往发送缓存很小的unix数据报socket，每次只发出一部分
+ *          对端取走后继续发送，数据报分多批发出，边界和顺序不变
+ * queue    一次Send多个Buffer，一次刷新分多批发出，全部完整到达
+ * multi    poller阻塞时其他线程交替向两个目标Send，之后批量发出并各自按序到达
+ */
+
+#define PACKET_COUNT 600
+
+static int g_failed = 0;
+
+static void report(bool ok, const string& name, const string& detail)
+{
+    cout << (ok ? "[ok] " : "[failed] ") << name << " " << detail << endl;
+    if (!ok) {
+        ++g_failed;
+    }
+}
+
+// 第i个数据报的内容，长度在20~219之间变化
+static string make_packet(int i)
+{
+    string packet = "packet " + to_string(i) + " ";
+    packet.resize(20 + i * 37 % 200, static_cast<char>('a' + i % 26));
+    return packet;
+}
+
+static Buffer::Ptr make_buffer(const string& data)
+{
+    BufferRaw::Ptr buffer = std::make_shared<BufferRaw>();
+    buffer->Assign(data.data(), data.size());
+    return buffer;
+}
+
+// 非阻塞地取走fd中已到达的数据报
+static void recv_available(int fd, vector<string>& packets)
+{
+    char buf[2048];
+    for (;;) {
+        ssize_t n = recv(fd, buf, sizeof(buf), MSG_DONTWAIT);
+        if (n < 0) {
+            return;
+        }
+        packets.emplace_back(buf, n);
+    }
+}
+
+// 等待收到expect个数据报，最多等待timeout_ms
+static vector<string> recv_packets(int fd, size_t expect, int timeout_ms)
+{
+    vector<string> packets;
+    while (packets.size() < expect) {
+        struct pollfd pfd = {fd, POLLIN, 0};
+        if (poll(&pfd, 1, timeout_ms) <= 0) {
+            break;
+        }
+        recv_available(fd, packets);
+    }
+    return packets;
+}
+
+// 绑定127.0.0.1随机端口的普通UDP socket，接收缓存足够容纳所有数据报
+static int create_receiver(sockaddr_storage& addr, socklen_t& len)
+{
+    int         fd = socket(AF_INET, SOCK_DGRAM, 0);
+    sockaddr_in local;
+    bzero(&local, sizeof(local));
+    local.sin_family      = AF_INET;
+    local.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bind(fd, reinterpret_cast<sockaddr*>(&local), sizeof(local));
+    int rcvbuf = 4 * 1024 * 1024;
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+
+    len = sizeof(addr);
+    getsockname(fd, reinterpret_cast<sockaddr*>(&addr), &len);
+    return fd;
+}
+
+static void check_partial()
+{
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_DGRAM, 0, fds) != 0) {
+        report(false, "partial", "socketpair failed");
+        return;
+    }
+    int sndbuf = 4096;
+    setsockopt(fds[0], SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf));
+
+    vector<string>    packets;
+    List<Buffer::Ptr> list;
+    uint64_t          total = 0;
+    for (int i = 0; i < PACKET_COUNT; i++) {
+        packets.push_back(make_packet(i));
+        total += packets.back().size();
+        // 已连接的socket不需要目标地址
+        list.emplace_back(
+            std::make_shared<BufferSock>(make_buffer(packets[i])));
+    }
+
+    BufferList     buffers(list);
+    vector<string> received;
+    int            partial = 0;
+    uint64_t       sent    = 0;
+    bool           error   = false;
+    for (int round = 0; round < PACKET_COUNT && !buffers.empty(); round++) {
+        ssize_t n = buffers.send(fds[0], MSG_DONTWAIT, true);
+        if (n > 0) {
+            sent += n;
+        }
+        else if (errno != EAGAIN) {
+            error = true;
+            break;
+        }
+        if (!buffers.empty()) {
+            ++partial;
+        }
+        recv_available(fds[1], received);
+    }
+    recv_available(fds[1], received);
+
+    bool ok = !error && buffers.empty() && buffers.size() == 0 &&
+              sent == total && partial > 0 && received == packets;
+    report(ok, "partial",
+           "received=" + to_string(received.size()) +
+               " partial=" + to_string(partial) + " sent=" + to_string(sent));
+
+    close(fds[0]);
+    close(fds[1]);
+}
+
+static void check_queue(const EventPoller::Ptr& poller)
+{
+    sockaddr_storage addr;
+    socklen_t        len;
+    int              recv_fd = create_receiver(addr, len);
+
+    Socket::Ptr sock = Socket::Create(poller);
+    if (!sock->Listen(SOCK_UDP, 0, false, "127.0.0.1")) {
+        report(false, "queue", "listen failed");
+        close(recv_fd);
+        return;
+    }
+
+    // 所有数据报一次入队，之后一次刷新
+    vector<string>      packets;
+    vector<Buffer::Ptr> bufs;
+    for (int i = 0; i < PACKET_COUNT; i++) {
+        packets.push_back(make_packet(i));
+        bufs.push_back(make_buffer(packets.back()));
+    }
+    poller->Sync([&]() { sock->Send(bufs, &addr, len); });
+
+    vector<string> received = recv_packets(recv_fd, packets.size(), 1000);
+    uint64_t       queued   = 1;
+    poller->Sync([&]() {
+        queued = sock->GetSendQueueBytes();
+        sock   = nullptr;
+    });
+
+    report(received == packets && queued == 0, "queue",
+           "received=" + to_string(received.size()) +
+               " queued=" + to_string(queued));
+    close(recv_fd);
+}
+
+static void check_multi(const EventPoller::Ptr& poller)
+{
+    sockaddr_storage addrs[2];
+    socklen_t        lens[2];
+    int              recv_fds[2];
+    for (int i = 0; i < 2; i++) {
+        recv_fds[i] = create_receiver(addrs[i], lens[i]);
+    }
+
+    Socket::Ptr sock = Socket::Create(poller);
+    if (!sock->Listen(SOCK_UDP, 0, false, "127.0.0.1")) {
+        report(false, "multi", "listen failed");
+        close(recv_fds[0]);
+        close(recv_fds[1]);
+        return;
+    }
+
+    // 阻塞poller，其他线程的Send都在任务队列中积压
+    Semaphore blocked;
+    Semaphore release;
+    poller->Post([&blocked, &release]() {
+        blocked.Post();
+        release.Wait();
+    });
+    blocked.Wait();
+
+    // 第i个数据报发往第i % 2个接收者
+    vector<string> expects[2];
+    for (int i = 0; i < PACKET_COUNT; i++) {
+        string packet = make_packet(i);
+        expects[i % 2].push_back(packet);
+        sock->Send(packet.data(), packet.size(), &addrs[i % 2], lens[i % 2]);
+    }
+    release.Post();
+
+    bool   ok = true;
+    string detail;
+    for (int i = 0; i < 2; i++) {
+        vector<string> received =
+            recv_packets(recv_fds[i], expects[i].size(), 1000);
+        ok = ok && received == expects[i];
+        detail += "received" + to_string(i) + "=" +
+                  to_string(received.size()) + " ";
+        close(recv_fds[i]);
+    }
+    report(ok, "multi", detail);
+
+    poller->Sync([&sock]() { sock = nullptr; });
+}
+
+int main()
+{
+    Logger::Instance().AddChannel(std::make_shared<ConsoleChannel>());
+    Logger::Instance().SetWriter(
+        std::make_shared<AsyncLogWriter>(Logger::Instance()));
+
+    EventPoller::Ptr poller = EventPoller::Create();
+    thread           loop([poller]() { poller->RunLoop(); });
+
+    check_partial();
+    check_queue(poller);
+    check_multi(poller);
+
+    poller->Shutdown();
+    loop.join();
+
+    cout << (g_failed ? "failed" : "all passed") << endl;
+    return g_failed ? 1 : 0;
+}
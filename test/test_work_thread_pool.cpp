@@ -0,0 +1,203 @@
+#include "thread/work_thread_pool.h"
+#include "utils/logger.h"
+#include <atomic>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace common_library;
+
+/**
+ * WorkThreadPool测试，多个线程同时投递，检查每个任务恰好执行一次
+ * external  多个外部线程并发投递到注入队列
+ * fork      工作线程内递归投递到自己的队列，空闲线程窃取
+ * mixed     外部投递的任务在工作线程内再投递子任务，同时有外部线程持续投递
+ * drain     析构时执行完所有已投递但未执行的任务
+ */
+
+#define THREAD_NUM      4
+#define PRODUCER_NUM    4
+#define TASK_PER_THREAD 20000
+#define FORK_DEPTH      14
+
+static int g_failed = 0;
+
+static void report(bool ok, const string& name, const string& detail)
+{
+    cout << (ok ? "[ok] " : "[failed] ") << name << " " << detail << endl;
+    if (!ok) {
+        ++g_failed;
+    }
+}
+
+// 每个任务一个计数，执行一次加一
+struct RunCounts
+{
+    typedef std::shared_ptr<RunCounts> Ptr;
+
+    explicit RunCounts(size_t size) : counts(size)
+    {
+        for (auto& count : counts) {
+            count = 0;
+        }
+    }
+
+    // 返回执行次数不为1的任务数
+    size_t Bad()
+    {
+        size_t bad = 0;
+        for (auto& count : counts) {
+            if (count.load() != 1) {
+                ++bad;
+            }
+        }
+        return bad;
+    }
+
+    vector<atomic<int>> counts;
+    atomic<size_t>      done{0};
+};
+
+static bool wait_done(const RunCounts::Ptr& runs, size_t total, int timeout_ms)
+{
+    for (int i = 0; i < timeout_ms && runs->done < total; i++) {
+        this_thread::sleep_for(chrono::milliseconds(1));
+    }
+    return runs->done == total;
+}
+
+// 从多个线程并发投递，第i个线程投递[i * count, (i + 1) * count)
+static void produce(size_t count, const function<void(size_t)>& post_one)
+{
+    vector<thread> producers;
+    for (size_t i = 0; i < PRODUCER_NUM; i++) {
+        producers.emplace_back([i, count, &post_one]() {
+            for (size_t j = 0; j < count; j++) {
+                post_one(i * count + j);
+            }
+        });
+    }
+    for (auto& producer : producers) {
+        producer.join();
+    }
+}
+
+static void check_external()
+{
+    WorkThreadPool pool(THREAD_NUM);
+    size_t         total = PRODUCER_NUM * TASK_PER_THREAD;
+    auto           runs  = make_shared<RunCounts>(total);
+
+    produce(TASK_PER_THREAD, [&pool, runs](size_t id) {
+        pool.Post([runs, id]() {
+            ++runs->counts[id];
+            ++runs->done;
+        });
+    });
+    bool   finished = wait_done(runs, total, 10000);
+    size_t bad      = runs->Bad();
+
+    report(finished && bad == 0, "external",
+           "done=" + to_string(runs->done) + " bad=" + to_string(bad));
+}
+
+// 以id为根的满二叉树，子节点为2 * id + 1和2 * id + 2
+static void fork_task(WorkThreadPool*       pool,
+                      const RunCounts::Ptr& runs,
+                      size_t                id,
+                      int                   depth)
+{
+    ++runs->counts[id];
+    if (depth > 0) {
+        for (size_t child = 2 * id + 1; child <= 2 * id + 2; child++) {
+            pool->Post([pool, runs, child, depth]() {
+                fork_task(pool, runs, child, depth - 1);
+            });
+        }
+    }
+    ++runs->done;
+}
+
+static void check_fork()
+{
+    WorkThreadPool pool(THREAD_NUM);
+    size_t         total = (size_t(1) << (FORK_DEPTH + 1)) - 1;
+    auto           runs  = make_shared<RunCounts>(total);
+
+    WorkThreadPool* ptr = &pool;
+    pool.Post([ptr, runs]() { fork_task(ptr, runs, 0, FORK_DEPTH); });
+    bool   finished = wait_done(runs, total, 10000);
+    size_t bad      = runs->Bad();
+
+    report(finished && bad == 0, "fork",
+           "done=" + to_string(runs->done) + " bad=" + to_string(bad));
+}
+
+static void check_mixed()
+{
+    WorkThreadPool pool(THREAD_NUM);
+    // 前一半给外部投递的任务，后一半给它们各自的子任务
+    size_t count = TASK_PER_THREAD / 4;
+    size_t half  = PRODUCER_NUM * count;
+    auto   runs  = make_shared<RunCounts>(half * 2);
+
+    WorkThreadPool* ptr = &pool;
+    produce(count, [ptr, runs, half](size_t id) {
+        ptr->Post([ptr, runs, id, half]() {
+            ptr->Post([runs, id, half]() {
+                ++runs->counts[half + id];
+                ++runs->done;
+            });
+            ++runs->counts[id];
+            ++runs->done;
+        });
+    });
+    bool   finished = wait_done(runs, half * 2, 10000);
+    size_t bad      = runs->Bad();
+
+    report(finished && bad == 0, "mixed",
+           "done=" + to_string(runs->done) + " bad=" + to_string(bad));
+}
+
+static void check_drain()
+{
+    size_t total = TASK_PER_THREAD;
+    auto   runs  = make_shared<RunCounts>(total);
+    {
+        WorkThreadPool pool(THREAD_NUM);
+        // 先让每个工作线程都阻塞一段时间，析构时仍有大量任务未执行
+        for (size_t i = 0; i < THREAD_NUM; i++) {
+            pool.Post(
+                []() { this_thread::sleep_for(chrono::milliseconds(20)); });
+        }
+        for (size_t id = 0; id < total; id++) {
+            pool.Post([runs, id]() {
+                ++runs->counts[id];
+                ++runs->done;
+            });
+        }
+    }
+    size_t bad = runs->Bad();
+
+    report(runs->done == total && bad == 0, "drain",
+           "done=" + to_string(runs->done) + " bad=" + to_string(bad));
+}
+
+int main()
+{
+    Logger::Instance().AddChannel(std::make_shared<ConsoleChannel>());
+    Logger::Instance().SetWriter(
+        std::make_shared<AsyncLogWriter>(Logger::Instance()));
+
+    check_external();
+    check_fork();
+    check_mixed();
+    check_drain();
+
+    cout << (g_failed ? "failed" : "all passed") << endl;
+    return g_failed ? 1 : 0;
+}
@@ -0,0 +1,289 @@
+#include "net/socket.h"
+#include "poller/event_poller.h"
+#include "thread/semaphore.h"
+#include "utils/logger.h"
+#include <atomic>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace common_library;
+
+/**
+ * Socket::SetZeroCopy测试，所有socket在同一个poller，走127.0.0.1，逐字节校验
+ * 回环地址上内核通常回退为拷贝，只检查各项统计之和，不要求一定零拷贝
+ * large     超过阈值的发送走MSG_ZEROCOPY，收完通知后没有待完成的字节
+ * small     一次刷新的数据低于阈值时直接拷贝，不产生完成通知
+ * partial   对端暂停读取时只发出一部分，恢复后发完，多次发送的通知都被计入
+ * release   Buffer在完成通知后才释放
+ */
+
+#define CHUNK_SIZE         (1024 * 1024)
+#define CHUNK_COUNT        8
+#define ZEROCOPY_THRESHOLD (64 * 1024)
+
+static int g_failed = 0;
+
+// 只在poller线程中访问
+static vector<Socket::Ptr>                g_peers;
+static function<void(Socket::Ptr& peer)> g_on_accept;
+
+struct Connection
+{
+    Socket::Ptr             client;
+    // 服务端accept得到的socket
+    Socket::Ptr             peer;
+    shared_ptr<string>      received;
+    shared_ptr<atomic<int>> err_code;
+};
+
+static void report(bool ok, const string& name, const string& detail)
+{
+    cout << (ok ? "[ok] " : "[failed] ") << name << " " << detail << endl;
+    if (!ok) {
+        ++g_failed;
+    }
+}
+
+static Connection connect_peer(const EventPoller::Ptr& poller,
+                               uint16_t                port,
+                               bool                    peer_recv)
+{
+    Connection conn;
+    conn.received = make_shared<string>();
+    conn.err_code = make_shared<atomic<int>>(ERR_SUCCESS);
+
+    // 连接完成和accept各Post一次
+    Semaphore sem;
+    poller->Sync([&]() {
+        g_on_accept = [&conn, &sem, peer_recv](Socket::Ptr& peer) {
+            auto received = conn.received;
+            peer->EnableRecv(peer_recv);
+            peer->SetOnRead([received](const Buffer::Ptr& buf,
+                                       sockaddr_storage*, socklen_t) {
+                received->append(buf->Data(), buf->Size());
+            });
+            conn.peer = peer;
+            sem.Post();
+        };
+
+        auto err_code = conn.err_code;
+        conn.client   = Socket::Create(poller);
+        conn.client->SetZeroCopy(ZEROCOPY_THRESHOLD);
+        conn.client->SetOnError([err_code](const SocketException& err) {
+            *err_code = err.GetErrCode();
+        });
+        conn.client->Connect("127.0.0.1", port,
+                             [&sem](const SocketException&) { sem.Post(); });
+    });
+    sem.Wait();
+    sem.Wait();
+    poller->Sync([]() { g_on_accept = nullptr; });
+    return conn;
+}
+
+// 在poller线程中检查cond，最多等待timeout_ms
+static bool wait_until(const EventPoller::Ptr& poller,
+                       const function<bool()>& cond,
+                       uint64_t                timeout_ms = 10000)
+{
+    uint64_t begin = get_steady_milliseconds();
+    while (get_steady_milliseconds() - begin < timeout_ms) {
+        bool done = false;
+        poller->Sync([&]() { done = cond(); });
+        if (done) {
+            return true;
+        }
+        this_thread::sleep_for(chrono::milliseconds(10));
+    }
+    return false;
+}
+
+static string make_pattern(size_t size)
+{
+    string data(size, 0);
+    for (size_t i = 0; i < size; i++) {
+        data[i] = char(i * 7 + i / 251);
+    }
+    return data;
+}
+
+static Buffer::Ptr make_buffer(const string& data)
+{
+    BufferRaw::Ptr buffer = std::make_shared<BufferRaw>();
+    buffer->Assign(data.data(), data.size());
+    return buffer;
+}
+
+// 等待对端收完且没有待完成的零拷贝发送，返回最终统计
+static ZeroCopyStats wait_complete(const EventPoller::Ptr& poller,
+                                   Connection&             conn,
+                                   size_t                  expect_size)
+{
+    wait_until(poller, [&]() {
+        return conn.received->size() >= expect_size &&
+               conn.client->GetSendQueueBytes() == 0 &&
+               conn.client->GetZeroCopyStats().pending_bytes == 0;
+    });
+
+    ZeroCopyStats stats;
+    poller->Sync([&]() { stats = conn.client->GetZeroCopyStats(); });
+    return stats;
+}
+
+static string stats_string(const ZeroCopyStats& stats)
+{
+    return "zerocopy=" + to_string(stats.zerocopy_bytes) +
+           " fallback=" + to_string(stats.fallback_bytes) +
+           " copied=" + to_string(stats.copied_bytes) +
+           " pending=" + to_string(stats.pending_bytes);
+}
+
+static void close_conn(const EventPoller::Ptr& poller, Connection& conn)
+{
+    poller->Sync([&]() {
+        conn.client = nullptr;
+        conn.peer   = nullptr;
+        g_peers.clear();
+    });
+}
+
+static void check_large(const EventPoller::Ptr& poller, uint16_t port)
+{
+    string     expect = make_pattern(CHUNK_SIZE * CHUNK_COUNT);
+    Connection conn   = connect_peer(poller, port, true);
+    poller->Sync([&]() {
+        for (int i = 0; i < CHUNK_COUNT; i++) {
+            conn.client->Send(
+                make_buffer(expect.substr(i * CHUNK_SIZE, CHUNK_SIZE)));
+        }
+    });
+
+    ZeroCopyStats stats = wait_complete(poller, conn, expect.size());
+    // 通知过多(ENOBUFS)时剩余数据改为拷贝发送
+    bool ok = *conn.received == expect && *conn.err_code == ERR_SUCCESS &&
+              stats.pending_bytes == 0 &&
+              stats.zerocopy_bytes + stats.fallback_bytes > 0 &&
+              stats.zerocopy_bytes + stats.fallback_bytes +
+                      stats.copied_bytes ==
+                  expect.size();
+    report(ok, "large",
+           "received=" + to_string(conn.received->size()) + " " +
+               stats_string(stats));
+    close_conn(poller, conn);
+}
+
+static void check_small(const EventPoller::Ptr& poller, uint16_t port)
+{
+    // 阈值按一次刷新的总长度判断，两次Send合计仍低于阈值
+    string     head   = make_pattern(ZEROCOPY_THRESHOLD / 2);
+    string     expect = head + "tail";
+    Connection conn   = connect_peer(poller, port, true);
+    poller->Sync([&]() {
+        conn.client->Send(make_buffer(head));
+        conn.client->Send("tail", 4);
+    });
+
+    ZeroCopyStats stats = wait_complete(poller, conn, expect.size());
+    bool ok = *conn.received == expect && stats.zerocopy_bytes == 0 &&
+              stats.fallback_bytes == 0 && stats.pending_bytes == 0 &&
+              stats.copied_bytes == expect.size();
+    report(ok, "small",
+           "received=" + to_string(conn.received->size()) + " " +
+               stats_string(stats));
+    close_conn(poller, conn);
+}
+
+static void check_partial(const EventPoller::Ptr& poller, uint16_t port)
+{
+    string     expect = make_pattern(CHUNK_SIZE * CHUNK_COUNT);
+    Connection conn   = connect_peer(poller, port, false);
+    poller->Sync([&]() { conn.client->Send(make_buffer(expect)); });
+
+    // 对端不读时内核缓存写满，队列中还剩大部分数据
+    uint64_t queued = 0;
+    wait_until(
+        poller,
+        [&]() {
+            queued = conn.client->GetSendQueueBytes();
+            return queued > 0 && queued < expect.size();
+        },
+        1000);
+    poller->Sync([&]() { conn.peer->EnableRecv(true); });
+
+    ZeroCopyStats stats = wait_complete(poller, conn, expect.size());
+    bool ok = queued > 0 && queued < expect.size() &&
+              *conn.received == expect && stats.pending_bytes == 0 &&
+              stats.zerocopy_bytes + stats.fallback_bytes +
+                      stats.copied_bytes ==
+                  expect.size();
+    report(ok, "partial",
+           "queued=" + to_string(queued) + " " + stats_string(stats));
+    close_conn(poller, conn);
+}
+
+static void check_release(const EventPoller::Ptr& poller, uint16_t port)
+{
+    string           expect = make_pattern(CHUNK_SIZE);
+    Connection       conn   = connect_peer(poller, port, true);
+    weak_ptr<Buffer> weak;
+    bool             held = false;
+    poller->Sync([&]() {
+        Buffer::Ptr buffer = make_buffer(expect);
+        weak               = buffer;
+        conn.client->Send(buffer);
+        // 发出后仍被待完成的通知持有
+        held = !weak.expired();
+    });
+
+    ZeroCopyStats stats    = wait_complete(poller, conn, expect.size());
+    bool          released = false;
+    poller->Sync([&]() { released = weak.expired(); });
+
+    bool ok = held && released && *conn.received == expect &&
+              stats.pending_bytes == 0;
+    report(ok, "release",
+           "held=" + to_string(held) + " released=" + to_string(released));
+    close_conn(poller, conn);
+}
+
+int main()
+{
+    Logger::Instance().AddChannel(std::make_shared<ConsoleChannel>());
+    Logger::Instance().SetWriter(
+        std::make_shared<AsyncLogWriter>(Logger::Instance()));
+
+    EventPoller::Ptr poller = EventPoller::Create();
+    thread           loop([poller]() { poller->RunLoop(); });
+
+    Socket::Ptr server = Socket::Create(poller);
+    poller->Sync([&]() {
+        server->SetOnAccept([](Socket::Ptr& peer) {
+            g_peers.emplace_back(peer);
+            if (g_on_accept) {
+                g_on_accept(peer);
+            }
+        });
+        server->Listen(SOCK_TCP, 0, false, "127.0.0.1");
+    });
+    uint16_t port = server->GetLocalPort();
+
+    check_large(poller, port);
+    check_small(poller, port);
+    check_partial(poller, port);
+    check_release(poller, port);
+
+    poller->Sync([&]() {
+        g_peers.clear();
+        server = nullptr;
+    });
+    poller->Shutdown();
+    loop.join();
+
+    cout << (g_failed ? "failed" : "all passed") << endl;
+    return g_failed ? 1 : 0;
+}
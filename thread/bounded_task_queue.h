@@ -0,0 +1,281 @@
+#ifndef COMMON_LIBRARY_BOUNDED_TASK_QUEUE_H
+#define COMMON_LIBRARY_BOUNDED_TASK_QUEUE_H
+
+#include <utils/noncopyable.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include <stdint.h>
+
+#define BOUNDED_QUEUE_SPIN_ROUNDS 64
+
+namespace common_library {
+
+/**
+ * 有界无锁多生产者多消费者队列(Vyukov环形缓冲)
+ * 容量向上取整为2的幂，队列满时AddTask阻塞等待，TryAddTask直接返回false
+ * 取任务时先自旋，仍取不到再阻塞，阻塞/唤醒只在有等待者时才加锁
+ * PostExit的退出通知排在已入队的任务之后，与TaskQueue语义一致
+ */
+template <typename T> class BoundedTaskQueue final : public noncopyable {
+  public:
+    BoundedTaskQueue(uint64_t capacity = 65536)
+    {
+        uint64_t cap = 2;
+        while (cap < capacity) {
+            cap <<= 1;
+        }
+        mask_  = cap - 1;
+        cells_ = new Cell[cap];
+        for (uint64_t i = 0; i < cap; i++) {
+            cells_[i].seq.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    ~BoundedTaskQueue()
+    {
+        delete[] cells_;
+    }
+
+  public:
+    /**
+     * 队列满时阻塞直到有空位
+     */
+    template <typename Func> void AddTask(Func&& f)
+    {
+        while (!TryAddTask(std::forward<Func>(f))) {
+            wait_not_full();
+        }
+    }
+
+    /**
+     * 队列满时返回false，f不会被移动
+     */
+    template <typename Func> bool TryAddTask(Func&& f)
+    {
+        Cell*    cell;
+        uint64_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+        for (;;) {
+            cell         = &cells_[pos & mask_];
+            uint64_t seq = cell->seq.load(std::memory_order_acquire);
+            int64_t  dif = (int64_t)seq - (int64_t)pos;
+            if (dif == 0) {
+                if (enqueue_pos_.compare_exchange_weak(
+                        pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            }
+            else if (dif < 0) {
+                return false;
+            }
+            else {
+                pos = enqueue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+
+        cell->data = std::forward<Func>(f);
+        cell->seq.store(pos + 1, std::memory_order_release);
+
+        notify(empty_waiters_, not_empty_, false);
+        return true;
+    }
+
+    void PostExit(uint32_t waiting_thread_num)
+    {
+        exit_num_.fetch_add(waiting_thread_num, std::memory_order_seq_cst);
+        notify(empty_waiters_, not_empty_, true);
+    }
+
+    /**
+     * 队列为空时阻塞，收到退出通知时返回false
+     */
+    bool GetTask(T& f)
+    {
+        for (;;) {
+            if (TryGetTask(f)) {
+                return true;
+            }
+            if (take_exit()) {
+                return false;
+            }
+            wait_not_empty();
+        }
+    }
+
+    /**
+     * 批量取出最多n个任务，至少取到一个才返回
+     * 收到退出通知且队列为空时返回0
+     */
+    uint64_t GetTasks(T* tasks, uint64_t n)
+    {
+        if (n == 0 || !GetTask(tasks[0])) {
+            return 0;
+        }
+
+        uint64_t count = 1;
+        while (count < n && TryGetTask(tasks[count])) {
+            ++count;
+        }
+        return count;
+    }
+
+    bool TryGetTask(T& f)
+    {
+        Cell*    cell;
+        uint64_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+        for (;;) {
+            cell         = &cells_[pos & mask_];
+            uint64_t seq = cell->seq.load(std::memory_order_acquire);
+            int64_t  dif = (int64_t)seq - (int64_t)(pos + 1);
+            if (dif == 0) {
+                if (dequeue_pos_.compare_exchange_weak(
+                        pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            }
+            else if (dif < 0) {
+                return false;
+            }
+            else {
+                pos = dequeue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+
+        f = std::move(cell->data);
+        // 及时释放任务持有的资源
+        cell->data = T();
+        cell->seq.store(pos + mask_ + 1, std::memory_order_release);
+
+        notify(full_waiters_, not_full_, false);
+        return true;
+    }
+
+    /**
+     * 近似长度，仅用于统计
+     */
+    uint64_t Size() const
+    {
+        uint64_t tail = dequeue_pos_.load(std::memory_order_acquire);
+        uint64_t head = enqueue_pos_.load(std::memory_order_acquire);
+        return head > tail ? head - tail : 0;
+    }
+
+    uint64_t Capacity() const
+    {
+        return mask_ + 1;
+    }
+
+  private:
+    struct Cell {
+        std::atomic<uint64_t> seq;
+        T                     data;
+    };
+
+    // 队首的元素已经发布
+    bool readable() const
+    {
+        uint64_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+        return cells_[pos & mask_].seq.load(std::memory_order_acquire) ==
+               pos + 1;
+    }
+
+    // 队尾的位置已经空出
+    bool writable() const
+    {
+        uint64_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+        return cells_[pos & mask_].seq.load(std::memory_order_acquire) == pos;
+    }
+
+    bool take_exit()
+    {
+        uint32_t num = exit_num_.load(std::memory_order_acquire);
+        while (num > 0) {
+            if (exit_num_.compare_exchange_weak(num, num - 1,
+                                                std::memory_order_acq_rel)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void wait_not_empty()
+    {
+        for (int i = 0; i < BOUNDED_QUEUE_SPIN_ROUNDS; i++) {
+            if (readable() || exit_num_.load(std::memory_order_relaxed)) {
+                return;
+            }
+            std::this_thread::yield();
+        }
+
+        // 先登记再检查，与生产者发布后检查等待者配对，保证不会丢失唤醒
+        empty_waiters_.fetch_add(1, std::memory_order_seq_cst);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        {
+            std::unique_lock<std::mutex> lock(mux_);
+            while (!readable() && !exit_num_.load(std::memory_order_seq_cst)) {
+                not_empty_.wait(lock);
+            }
+        }
+        empty_waiters_.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    void wait_not_full()
+    {
+        for (int i = 0; i < BOUNDED_QUEUE_SPIN_ROUNDS; i++) {
+            if (writable()) {
+                return;
+            }
+            std::this_thread::yield();
+        }
+
+        full_waiters_.fetch_add(1, std::memory_order_seq_cst);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        {
+            std::unique_lock<std::mutex> lock(mux_);
+            while (!writable()) {
+                not_full_.wait(lock);
+            }
+        }
+        full_waiters_.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    void notify(std::atomic<uint32_t>&   waiters,
+                std::condition_variable& cond,
+                bool                     all)
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waiters.load(std::memory_order_relaxed) == 0) {
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mux_);
+        }
+        if (all) {
+            cond.notify_all();
+        }
+        else {
+            cond.notify_one();
+        }
+    }
+
+  private:
+    Cell*    cells_;
+    uint64_t mask_;
+    // 生产者与消费者的位置分开到不同缓存行，避免伪共享
+    alignas(64) std::atomic<uint64_t> enqueue_pos_{0};
+    alignas(64) std::atomic<uint64_t> dequeue_pos_{0};
+    alignas(64) std::atomic<uint32_t> empty_waiters_{0};
+    std::atomic<uint32_t>   full_waiters_{0};
+    std::atomic<uint32_t>   exit_num_{0};
+    std::mutex              mux_;
+    std::condition_variable not_empty_;
+    std::condition_variable not_full_;
+};
+
+}  // namespace common_library
+
+#endif
@@ -0,0 +1,118 @@
+#ifndef COMMON_LIBRARY_MPSC_QUEUE_H
+#define COMMON_LIBRARY_MPSC_QUEUE_H
+
+#include <utils/noncopyable.h>
+
+#include <atomic>
+
+#include <stdint.h>
+
+namespace common_library {
+
+/**
+ * 侵入式队列节点，使用者继承该类并自行管理节点内存
+ */
+class MpscNode {
+  public:
+    MpscNode()  = default;
+    ~MpscNode() = default;
+
+  private:
+    template <typename T> friend class MpscQueue;
+    std::atomic<MpscNode*> mpsc_next_{nullptr};
+};
+
+/**
+ * 无锁多生产者单消费者队列(Vyukov)
+ * Push可以在任意线程调用，Pop只能在同一个消费者线程调用
+ */
+template <typename T> class MpscQueue final : public noncopyable {
+  public:
+    MpscQueue() : head_(&stub_), tail_(&stub_) {}
+
+    ~MpscQueue() = default;
+
+  public:
+    void Push(T* node)
+    {
+        // 先计数再链接，保证Size()不小于可取出的节点数
+        size_.fetch_add(1, std::memory_order_relaxed);
+        push(node);
+    }
+
+    /**
+     * 队列为空或者有生产者正处于Push中间状态时返回nullptr
+     * 后者由生产者完成Push后的唤醒保证不会丢失
+     */
+    T* Pop()
+    {
+        MpscNode* tail = tail_;
+        MpscNode* next = tail->mpsc_next_.load(std::memory_order_acquire);
+
+        if (tail == &stub_) {
+            if (!next) {
+                return nullptr;
+            }
+            tail_ = next;
+            tail  = next;
+            next  = next->mpsc_next_.load(std::memory_order_acquire);
+        }
+
+        if (next) {
+            tail_ = next;
+            return pop_done(tail);
+        }
+
+        if (tail != head_.load(std::memory_order_acquire)) {
+            return nullptr;
+        }
+
+        push(&stub_);
+
+        next = tail->mpsc_next_.load(std::memory_order_acquire);
+        if (next) {
+            tail_ = next;
+            return pop_done(tail);
+        }
+
+        return nullptr;
+    }
+
+    /**
+     * 近似长度，仅用于统计及限制单次处理数量
+     */
+    uint64_t Size() const
+    {
+        return size_.load(std::memory_order_acquire);
+    }
+
+    bool Empty() const
+    {
+        return Size() == 0;
+    }
+
+  private:
+    void push(MpscNode* node)
+    {
+        node->mpsc_next_.store(nullptr, std::memory_order_relaxed);
+        MpscNode* prev = head_.exchange(node, std::memory_order_acq_rel);
+        prev->mpsc_next_.store(node, std::memory_order_release);
+    }
+
+    T* pop_done(MpscNode* node)
+    {
+        size_.fetch_sub(1, std::memory_order_relaxed);
+        return static_cast<T*>(node);
+    }
+
+  private:
+    MpscNode               stub_;
+    std::atomic<MpscNode*> head_;
+    // 仅消费者线程访问
+    MpscNode*             tail_;
+    std::atomic<uint64_t> size_{0};
+};
+
+}  // namespace common_library
+
+#endif
@@ -0,0 +1,96 @@
+#ifndef COMMON_LIBRARY_NODE_POOL_H
+#define COMMON_LIBRARY_NODE_POOL_H
+
+#include <atomic>
+
+#include <stdint.h>
+
+namespace common_library {
+
+/**
+ * 任务节点缓存，同一种Node共用一个全局空闲链表，Node需要有free_next成员
+ * 生产者线程从线程局部缓存取节点，缓存为空时一次性取走全局空闲链表
+ * 执行线程处理完任务后把节点成批归还到全局空闲链表(Treiber栈)
+ * 取出时总是整体交换，不存在ABA问题
+ * 链表长度用近似计数限制在MaxFree左右，突发过后多余的节点被释放
+ */
+template <typename Node, uint64_t MaxFree> class NodePool final {
+  public:
+    static Node* Alloc()
+    {
+        LocalCache& cache = local_cache();
+        if (!cache.head) {
+            cache.head =
+                s_free_list.exchange(nullptr, std::memory_order_acquire);
+            s_free_count.store(0, std::memory_order_relaxed);
+        }
+        if (!cache.head) {
+            return new Node();
+        }
+
+        Node* node      = cache.head;
+        cache.head      = node->free_next;
+        node->free_next = nullptr;
+        return node;
+    }
+
+    /**
+     * 归还由free_next串起的count个节点，节点中的任务必须已经释放
+     */
+    static void Free(Node* head, Node* tail, uint64_t count)
+    {
+        if (s_free_count.load(std::memory_order_relaxed) + count > MaxFree) {
+            tail->free_next = nullptr;
+            release(head);
+            return;
+        }
+        s_free_count.fetch_add(count, std::memory_order_relaxed);
+
+        Node* old = s_free_list.load(std::memory_order_relaxed);
+        do {
+            tail->free_next = old;
+        } while (!s_free_list.compare_exchange_weak(old, head,
+                                                    std::memory_order_release,
+                                                    std::memory_order_relaxed));
+    }
+
+  private:
+    struct LocalCache
+    {
+        ~LocalCache()
+        {
+            release(head);
+        }
+
+        Node* head = nullptr;
+    };
+
+    static LocalCache& local_cache()
+    {
+        static thread_local LocalCache s_cache;
+        return s_cache;
+    }
+
+    static void release(Node* head)
+    {
+        while (head) {
+            Node* next = head->free_next;
+            delete head;
+            head = next;
+        }
+    }
+
+  private:
+    static std::atomic<Node*>    s_free_list;
+    static std::atomic<uint64_t> s_free_count;
+};
+
+template <typename Node, uint64_t MaxFree>
+std::atomic<Node*> NodePool<Node, MaxFree>::s_free_list{nullptr};
+
+template <typename Node, uint64_t MaxFree>
+std::atomic<uint64_t> NodePool<Node, MaxFree>::s_free_count{0};
+
+}  // namespace common_library
+
+#endif
@@ -1,13 +1,30 @@
 #ifndef COMMON_LIBRARY_SEMAPHORE_H
 #define COMMON_LIBRARY_SEMAPHORE_H
 
-#include <condition_variable>
-#include <mutex>
+#include <atomic>
 
+#include <errno.h>
+#include <limits.h>
+#include <linux/futex.h>
 #include <stdint.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#define SEMAPHORE_SPIN_ROUNDS  128
+#define SEMAPHORE_VALUE_SHIFT  1
+#define SEMAPHORE_WAITERS_MASK 1u
 
 namespace common_library {
 
+/**
+ * 基于futex的信号量
+ * 计数为正或者没有等待者时Post/Wait都只有原子操作，不进入内核
+ * Wait在休眠前先有限次自旋，适合生产者消费者间隔很短的场景
+ * 计数和"有等待者"标记在同一个32位futex字中，Post只做一次原子加，
+ * 之后只对该地址调用FUTEX_WAKE，不再访问对象，
+ * 等待者返回后即可销毁信号量(例如放在等待线程的栈上)
+ */
 class Semaphore final {
   public:
     Semaphore()  = default;
@@ -16,32 +33,165 @@ class Semaphore final {
   public:
     void Post(uint32_t n = 1)
     {
-        std::unique_lock<std::mutex> lock(mux_);
-        count_ += n;
-        if (n == 1) {
-            cond_.notify_one();
-        }
-        else {
-            cond_.notify_all();
+        uint32_t value =
+            value_.fetch_add(n << SEMAPHORE_VALUE_SHIFT,
+                             std::memory_order_seq_cst);
+        if (value & SEMAPHORE_WAITERS_MASK) {
+            futex(FUTEX_WAKE_PRIVATE, n > INT_MAX ? INT_MAX : (int)n, nullptr);
         }
     }
 
     void Wait()
     {
-        std::unique_lock<std::mutex> lock(mux_);
-        // 防止虚假唤醒
-        while (count_ == 0) {
-            cond_.wait(lock);
+        if (try_wait() || spin_wait()) {
+            return;
+        }
+
+        waiters_.fetch_add(1, std::memory_order_relaxed);
+        while (!try_wait()) {
+            futex_wait(nullptr);
+        }
+        finish_wait();
+    }
+
+    /**
+     * 最多等待timeout_ms毫秒，超时返回false
+     */
+    bool WaitFor(uint64_t timeout_ms)
+    {
+        if (try_wait()) {
+            return true;
+        }
+        if (timeout_ms == 0) {
+            return false;
+        }
+        if (spin_wait()) {
+            return true;
+        }
+
+        // 使用CLOCK_MONOTONIC绝对时间，被唤醒后重新等待时无需重算剩余时间
+        timespec deadline;
+        clock_gettime(CLOCK_MONOTONIC, &deadline);
+        deadline.tv_sec += timeout_ms / 1000;
+        deadline.tv_nsec += (timeout_ms % 1000) * 1000000;
+        if (deadline.tv_nsec >= 1000000000) {
+            deadline.tv_sec += 1;
+            deadline.tv_nsec -= 1000000000;
+        }
+
+        bool ret = true;
+        waiters_.fetch_add(1, std::memory_order_relaxed);
+        while (!try_wait()) {
+            if (!futex_wait(&deadline)) {
+                ret = try_wait();
+                break;
+            }
+        }
+        finish_wait();
+        return ret;
+    }
+
+    bool TryWait()
+    {
+        return try_wait();
+    }
+
+  private:
+    bool try_wait()
+    {
+        uint32_t value = value_.load(std::memory_order_relaxed);
+        while ((value >> SEMAPHORE_VALUE_SHIFT) > 0) {
+            if (value_.compare_exchange_weak(
+                    value, value - (1 << SEMAPHORE_VALUE_SHIFT),
+                    std::memory_order_acquire, std::memory_order_relaxed)) {
+                return true;
+            }
         }
-        --count_;
+        return false;
+    }
+
+    bool spin_wait()
+    {
+        for (int i = 0; i < SEMAPHORE_SPIN_ROUNDS; i++) {
+            cpu_relax();
+            if ((value_.load(std::memory_order_relaxed) >>
+                 SEMAPHORE_VALUE_SHIFT) > 0 &&
+                try_wait()) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * 计数为0时设置等待者标记并休眠，Post看到标记才会唤醒
+     * 超时返回false，其余情况(被唤醒、计数或标记已变化)返回true
+     */
+    bool futex_wait(const timespec* deadline)
+    {
+        uint32_t value = value_.load(std::memory_order_relaxed);
+        if ((value >> SEMAPHORE_VALUE_SHIFT) > 0) {
+            return true;
+        }
+        if (!(value & SEMAPHORE_WAITERS_MASK) &&
+            !value_.compare_exchange_strong(value,
+                                            value | SEMAPHORE_WAITERS_MASK,
+                                            std::memory_order_seq_cst,
+                                            std::memory_order_relaxed)) {
+            return true;
+        }
+
+        int op = deadline ? FUTEX_WAIT_BITSET_PRIVATE : FUTEX_WAIT_PRIVATE;
+        return futex(op, SEMAPHORE_WAITERS_MASK, deadline) != -1 ||
+               errno != ETIMEDOUT;
+    }
+
+    /**
+     * 注销等待者，可能是最后一个时清除标记
+     * 清除后发现还有其他等待者，恢复标记并按剩余计数补发唤醒
+     */
+    void finish_wait()
+    {
+        int32_t guess = waiters_.load(std::memory_order_relaxed);
+        if (guess == 1) {
+            value_.fetch_and(~SEMAPHORE_WAITERS_MASK,
+                             std::memory_order_acquire);
+        }
+        int32_t last = waiters_.fetch_sub(1, std::memory_order_release);
+        if (guess == 1 && last > 1) {
+            uint32_t value = value_.fetch_or(SEMAPHORE_WAITERS_MASK,
+                                             std::memory_order_relaxed);
+            value >>= SEMAPHORE_VALUE_SHIFT;
+            if (value > 0) {
+                futex(FUTEX_WAKE_PRIVATE,
+                      value > INT_MAX ? INT_MAX : (int)value, nullptr);
+            }
+        }
+    }
+
+    long futex(int op, int val, const timespec* timeout)
+    {
+        return syscall(SYS_futex, reinterpret_cast<uint32_t*>(&value_), op,
+                       val, timeout, nullptr, FUTEX_BITSET_MATCH_ANY);
+    }
+
+    static void cpu_relax()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#elif defined(__aarch64__)
+        asm volatile("yield" ::: "memory");
+#endif
     }
 
   private:
-    uint32_t                    count_ = 0;
-    std::mutex                  mux_;
-    std::condition_variable_any cond_;
+    // 最低位为等待者标记，其余位为计数
+    // futex直接等待在该字上，要求与uint32_t布局一致
+    std::atomic<uint32_t> value_{0};
+    // 只由等待者修改，Post不访问
+    std::atomic<int32_t>  waiters_{0};
 };
 
 }  // namespace common_library
 
-#endif
\ No newline at end of file
+#endif
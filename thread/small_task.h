@@ -0,0 +1,177 @@
+#ifndef COMMON_LIBRARY_SMALL_TASK_H
+#define COMMON_LIBRARY_SMALL_TASK_H
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#define SMALL_TASK_INLINE_SIZE 64
+
+namespace common_library {
+
+/**
+ * 只能移动的无参任务，类似std::function<void()>
+ * 不超过SMALL_TASK_INLINE_SIZE字节且移动不抛异常的可调用对象直接存放在内部，不分配内存
+ */
+class SmallTask final {
+  public:
+    SmallTask() = default;
+
+    template <typename Func,
+              typename = typename std::enable_if<!std::is_same<
+                  typename std::decay<Func>::type, SmallTask>::value>::type>
+    SmallTask(Func&& f)
+    {
+        typedef typename std::decay<Func>::type FuncType;
+        construct<FuncType>(
+            std::forward<Func>(f),
+            std::integral_constant<bool, is_inline<FuncType>()>());
+    }
+
+    SmallTask(SmallTask&& that)
+    {
+        move_from(that);
+    }
+
+    SmallTask& operator=(SmallTask&& that)
+    {
+        if (this != &that) {
+            Reset();
+            move_from(that);
+        }
+        return *this;
+    }
+
+    SmallTask(const SmallTask&) = delete;
+    SmallTask& operator=(const SmallTask&) = delete;
+
+    ~SmallTask()
+    {
+        Reset();
+    }
+
+  public:
+    void operator()()
+    {
+        if (ops_) {
+            ops_->invoke(storage_);
+        }
+    }
+
+    explicit operator bool() const
+    {
+        return ops_ != nullptr;
+    }
+
+    void Reset()
+    {
+        if (ops_) {
+            ops_->destroy(storage_);
+            ops_ = nullptr;
+        }
+    }
+
+  private:
+    struct Ops
+    {
+        void (*invoke)(void* storage);
+        // 移动到dst并析构src
+        void (*relocate)(void* dst, void* src);
+        void (*destroy)(void* storage);
+    };
+
+    template <typename FuncType> static constexpr bool is_inline()
+    {
+        return sizeof(FuncType) <= SMALL_TASK_INLINE_SIZE &&
+               alignof(FuncType) <= alignof(std::max_align_t) &&
+               std::is_nothrow_move_constructible<FuncType>::value;
+    }
+
+    template <typename FuncType> struct InlineOps
+    {
+        static void invoke(void* storage)
+        {
+            (*static_cast<FuncType*>(storage))();
+        }
+
+        static void relocate(void* dst, void* src)
+        {
+            FuncType* f = static_cast<FuncType*>(src);
+            new (dst) FuncType(std::move(*f));
+            f->~FuncType();
+        }
+
+        static void destroy(void* storage)
+        {
+            static_cast<FuncType*>(storage)->~FuncType();
+        }
+
+        static const Ops ops;
+    };
+
+    // 超出内部存储的对象放在堆上，内部只保存指针
+    template <typename FuncType> struct HeapOps
+    {
+        static void invoke(void* storage)
+        {
+            (**static_cast<FuncType**>(storage))();
+        }
+
+        static void relocate(void* dst, void* src)
+        {
+            *static_cast<FuncType**>(dst) = *static_cast<FuncType**>(src);
+        }
+
+        static void destroy(void* storage)
+        {
+            delete *static_cast<FuncType**>(storage);
+        }
+
+        static const Ops ops;
+    };
+
+    template <typename FuncType, typename Func>
+    void construct(Func&& f, std::true_type)
+    {
+        new (storage_) FuncType(std::forward<Func>(f));
+        ops_ = &InlineOps<FuncType>::ops;
+    }
+
+    template <typename FuncType, typename Func>
+    void construct(Func&& f, std::false_type)
+    {
+        *reinterpret_cast<FuncType**>(storage_) =
+            new FuncType(std::forward<Func>(f));
+        ops_ = &HeapOps<FuncType>::ops;
+    }
+
+    void move_from(SmallTask& that)
+    {
+        if (that.ops_) {
+            that.ops_->relocate(storage_, that.storage_);
+            ops_      = that.ops_;
+            that.ops_ = nullptr;
+        }
+    }
+
+  private:
+    alignas(std::max_align_t) unsigned char storage_[SMALL_TASK_INLINE_SIZE];
+    const Ops* ops_ = nullptr;
+};
+
+template <typename FuncType>
+const SmallTask::Ops SmallTask::InlineOps<FuncType>::ops = {
+    &SmallTask::InlineOps<FuncType>::invoke,
+    &SmallTask::InlineOps<FuncType>::relocate,
+    &SmallTask::InlineOps<FuncType>::destroy};
+
+template <typename FuncType>
+const SmallTask::Ops SmallTask::HeapOps<FuncType>::ops = {
+    &SmallTask::HeapOps<FuncType>::invoke,
+    &SmallTask::HeapOps<FuncType>::relocate,
+    &SmallTask::HeapOps<FuncType>::destroy};
+
+}  // namespace common_library
+
+#endif
@@ -2,6 +2,7 @@
 #define COMMON_LIBRARY_TASK_EXECUTOR_H
 
 #include <thread/semaphore.h>
+#include <thread/small_task.h>
 #include <thread/task.h>
 #include <utils/once_token.h>
 #include <utils/time_ticker.h>
@@ -18,9 +19,19 @@ class TaskExecutor {
     virtual ~TaskExecutor() = default;
 
   public:
-    virtual Task::Ptr Async(TaskIn&& task) = 0;
+    /**
+     * may_sync为true且当前已在执行线程中时直接执行任务，此时返回nullptr
+     */
+    virtual Task::Ptr Async(TaskIn&& task, bool may_sync = true) = 0;
 
-    virtual Task::Ptr AsyncFirst(TaskIn&& task) = 0;
+    virtual Task::Ptr AsyncFirst(TaskIn&& task, bool may_sync = true) = 0;
+
+    /**
+     * 不可取消的投递，对于较小的任务不分配内存
+     */
+    virtual void Post(SmallTask&& task) = 0;
+
+    virtual void PostFirst(SmallTask&& task) = 0;
 };
 
 }  // namespace common_library
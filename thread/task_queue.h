@@ -5,6 +5,8 @@
 #include <thread/task.h>
 #include <utils/list.h>
 
+#include <mutex>
+
 namespace common_library {
 
 template <typename T> class TaskQueue final {
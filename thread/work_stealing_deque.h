@@ -0,0 +1,166 @@
+#ifndef COMMON_LIBRARY_WORK_STEALING_DEQUE_H
+#define COMMON_LIBRARY_WORK_STEALING_DEQUE_H
+
+#include <utils/noncopyable.h>
+
+#include <atomic>
+#include <vector>
+
+#include <stdint.h>
+
+namespace common_library {
+
+/**
+ * Chase-Lev工作窃取双端队列，只保存指针，不管理元素内存
+ * Push/Pop只能在所有者线程调用(后进先出)，Steal可在任意线程调用(先进先出)
+ */
+template <typename T> class WorkStealingDeque final : public noncopyable {
+  public:
+    WorkStealingDeque(int64_t capacity = 1024)
+    {
+        int64_t cap = 1;
+        while (cap < capacity) {
+            cap <<= 1;
+        }
+        array_.store(new Array(cap), std::memory_order_relaxed);
+    }
+
+    ~WorkStealingDeque()
+    {
+        delete array_.load(std::memory_order_relaxed);
+        for (Array* array : garbage_) {
+            delete array;
+        }
+    }
+
+  public:
+    void Push(T* item)
+    {
+        int64_t b     = bottom_.load(std::memory_order_relaxed);
+        int64_t t     = top_.load(std::memory_order_acquire);
+        Array*  array = array_.load(std::memory_order_relaxed);
+
+        if (b - t > array->capacity - 1) {
+            array = grow(array, b, t);
+        }
+
+        array->Put(b, item);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom_.store(b + 1, std::memory_order_relaxed);
+    }
+
+    T* Pop()
+    {
+        int64_t b     = bottom_.load(std::memory_order_relaxed) - 1;
+        Array*  array = array_.load(std::memory_order_relaxed);
+        bottom_.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = top_.load(std::memory_order_relaxed);
+
+        if (t > b) {
+            // 队列为空
+            bottom_.store(b + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+
+        T* item = array->Get(b);
+        if (t == b) {
+            // 最后一个元素，与窃取者竞争
+            if (!top_.compare_exchange_strong(t, t + 1,
+                                              std::memory_order_seq_cst,
+                                              std::memory_order_relaxed)) {
+                item = nullptr;
+            }
+            bottom_.store(b + 1, std::memory_order_relaxed);
+        }
+        return item;
+    }
+
+    /**
+     * 队列为空或者与其他线程竞争失败时返回nullptr
+     */
+    T* Steal()
+    {
+        int64_t t = top_.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t b = bottom_.load(std::memory_order_acquire);
+
+        if (t >= b) {
+            return nullptr;
+        }
+
+        Array* array = array_.load(std::memory_order_acquire);
+        T*     item  = array->Get(t);
+        if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                          std::memory_order_relaxed)) {
+            return nullptr;
+        }
+        return item;
+    }
+
+    /**
+     * 近似长度
+     */
+    int64_t Size() const
+    {
+        int64_t b = bottom_.load(std::memory_order_relaxed);
+        int64_t t = top_.load(std::memory_order_relaxed);
+        return b > t ? b - t : 0;
+    }
+
+    bool Empty() const
+    {
+        return Size() == 0;
+    }
+
+  private:
+    struct Array
+    {
+        Array(int64_t cap) : capacity(cap), mask(cap - 1)
+        {
+            items = new std::atomic<T*>[cap];
+        }
+
+        ~Array()
+        {
+            delete[] items;
+        }
+
+        void Put(int64_t index, T* item)
+        {
+            items[index & mask].store(item, std::memory_order_relaxed);
+        }
+
+        T* Get(int64_t index)
+        {
+            return items[index & mask].load(std::memory_order_relaxed);
+        }
+
+        int64_t          capacity;
+        int64_t          mask;
+        std::atomic<T*>* items;
+    };
+
+    Array* grow(Array* array, int64_t b, int64_t t)
+    {
+        Array* bigger = new Array(array->capacity * 2);
+        for (int64_t i = t; i < b; i++) {
+            bigger->Put(i, array->Get(i));
+        }
+        // 窃取者可能仍在读取旧数组，析构时再释放
+        garbage_.emplace_back(array);
+        array_.store(bigger, std::memory_order_release);
+        return bigger;
+    }
+
+  private:
+    std::atomic<int64_t> top_{0};
+    std::atomic<int64_t> bottom_{0};
+    std::atomic<Array*>  array_;
+    // 仅所有者线程访问
+    std::vector<Array*> garbage_;
+};
+
+}  // namespace common_library
+
+#endif
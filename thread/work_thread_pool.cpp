@@ -0,0 +1,296 @@
+#include <thread/work_thread_pool.h>
+#include <utils/logger.h>
+
+#include <thread>
+
+#define WORK_STEAL_SPIN_ROUNDS 16
+
+namespace common_library {
+
+// 当前工作线程所属的线程池及其队列
+static thread_local WorkThreadPool* s_current_pool   = nullptr;
+static thread_local void*           s_current_worker = nullptr;
+
+WorkThreadPool::WorkThreadPool(size_t             thread_num,
+                               ThreadPriority     priority,
+                               bool               enable_affinity,
+                               const std::string& name)
+{
+    if (thread_num == 0) {
+        thread_num = std::thread::hardware_concurrency();
+    }
+    if (thread_num == 0) {
+        thread_num = 1;
+    }
+
+    for (size_t i = 0; i < thread_num; i++) {
+        workers_.emplace_back(new Worker());
+        workers_.back()->rand_seed =
+            static_cast<uint32_t>(i * 2654435761u + 1);
+    }
+
+    for (size_t i = 0; i < thread_num; i++) {
+        threads_.CreateThread([this, i, priority, enable_affinity, name]() {
+            set_thread_name(name + " " + std::to_string(i));
+            set_thread_priority(priority);
+            if (enable_affinity) {
+                set_thread_affinity(static_cast<int>(i));
+            }
+            run(i);
+        });
+    }
+}
+
+WorkThreadPool::~WorkThreadPool()
+{
+    exit_flag_.store(true, std::memory_order_seq_cst);
+    {
+        std::lock_guard<std::mutex> lock(park_mux_);
+        park_epoch_.fetch_add(1, std::memory_order_relaxed);
+    }
+    park_cond_.notify_all();
+    threads_.JoinAll();
+
+    // 工作线程退出前会执行完所有任务，这里只是兜底
+    TaskNode* node;
+    while ((node = pop_inject_task())) {
+        delete node;
+    }
+    for (auto& worker : workers_) {
+        while ((node = worker->deque.Steal())) {
+            delete node;
+        }
+    }
+}
+
+Task::Ptr WorkThreadPool::Async(TaskIn&& task, bool may_sync)
+{
+    if (may_sync && IsCurrentThread()) {
+        task();
+        return nullptr;
+    }
+
+    Task::Ptr ptask = std::make_shared<Task>(std::move(task));
+    post([ptask]() { (*ptask)(); }, false);
+    return ptask;
+}
+
+Task::Ptr WorkThreadPool::AsyncFirst(TaskIn&& task, bool may_sync)
+{
+    if (may_sync && IsCurrentThread()) {
+        task();
+        return nullptr;
+    }
+
+    Task::Ptr ptask = std::make_shared<Task>(std::move(task));
+    post([ptask]() { (*ptask)(); }, true);
+    return ptask;
+}
+
+void WorkThreadPool::Post(SmallTask&& task)
+{
+    post(std::move(task), false);
+}
+
+void WorkThreadPool::PostFirst(SmallTask&& task)
+{
+    post(std::move(task), true);
+}
+
+bool WorkThreadPool::IsCurrentThread()
+{
+    return s_current_pool == this;
+}
+
+size_t WorkThreadPool::Size()
+{
+    return workers_.size();
+}
+
+void WorkThreadPool::run(size_t index)
+{
+    Worker* self     = workers_[index].get();
+    s_current_pool   = this;
+    s_current_worker = self;
+
+    while (true) {
+        TaskNode* node = find_task(self);
+        if (node) {
+            execute(self, node);
+            continue;
+        }
+
+        // 先短暂自旋，减少任务密集时的阻塞唤醒
+        for (int i = 0; i < WORK_STEAL_SPIN_ROUNDS && !node; i++) {
+            std::this_thread::yield();
+            node = find_task(self);
+        }
+        if (node) {
+            execute(self, node);
+            continue;
+        }
+
+        // 即将阻塞，先归还攒下的节点
+        flush_free_nodes(self);
+
+        // 先登记再检查一次队列，与投递方的"先入队再检查登记数"配对
+        // 保证投递方能看到登记，或者这里能看到新任务，不会丢失唤醒
+        uint64_t epoch = park_epoch_.load(std::memory_order_acquire);
+        parked_num_.fetch_add(1, std::memory_order_seq_cst);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        node = find_task(self);
+        if (node) {
+            parked_num_.fetch_sub(1, std::memory_order_relaxed);
+            execute(self, node);
+            continue;
+        }
+
+        if (exit_flag_.load(std::memory_order_acquire)) {
+            parked_num_.fetch_sub(1, std::memory_order_relaxed);
+            break;
+        }
+
+        {
+            std::unique_lock<std::mutex> lock(park_mux_);
+            while (park_epoch_.load(std::memory_order_relaxed) == epoch) {
+                park_cond_.wait(lock);
+            }
+        }
+        parked_num_.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    s_current_pool   = nullptr;
+    s_current_worker = nullptr;
+}
+
+void WorkThreadPool::post(SmallTask&& task, bool first)
+{
+    TaskNode* node = TaskNodePool::Alloc();
+    node->task     = std::move(task);
+
+    if (IsCurrentThread()) {
+        // 工作线程内投递的任务放入自己的队列，所有者后进先出
+        static_cast<Worker*>(s_current_worker)->deque.Push(node);
+    }
+    else {
+        std::lock_guard<std::mutex> lock(inject_mux_);
+        if (first) {
+            inject_tasks_.emplace_front(node);
+        }
+        else {
+            inject_tasks_.emplace_back(node);
+        }
+        inject_size_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (parked_num_.load(std::memory_order_seq_cst) > 0) {
+        wakeup_one();
+    }
+}
+
+WorkThreadPool::TaskNode* WorkThreadPool::find_task(Worker* self)
+{
+    TaskNode* node = self->deque.Pop();
+    if (node) {
+        return node;
+    }
+
+    node = pop_inject_task();
+    if (node) {
+        return node;
+    }
+
+    return steal_task(self);
+}
+
+WorkThreadPool::TaskNode* WorkThreadPool::steal_task(Worker* self)
+{
+    size_t count = workers_.size();
+    if (count <= 1) {
+        return nullptr;
+    }
+
+    // xorshift随机选择起点，避免所有空闲线程窃取同一个队列
+    uint32_t x = self->rand_seed;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    self->rand_seed = x;
+
+    size_t start = x % count;
+    for (size_t i = 0; i < count; i++) {
+        Worker* victim = workers_[(start + i) % count].get();
+        if (victim == self) {
+            continue;
+        }
+
+        TaskNode* node = victim->deque.Steal();
+        if (node) {
+            return node;
+        }
+    }
+    return nullptr;
+}
+
+WorkThreadPool::TaskNode* WorkThreadPool::pop_inject_task()
+{
+    if (inject_size_.load(std::memory_order_relaxed) == 0) {
+        return nullptr;
+    }
+
+    std::lock_guard<std::mutex> lock(inject_mux_);
+    if (inject_tasks_.empty()) {
+        return nullptr;
+    }
+
+    TaskNode* node = inject_tasks_.front();
+    inject_tasks_.pop_front();
+    inject_size_.fetch_sub(1, std::memory_order_relaxed);
+    return node;
+}
+
+void WorkThreadPool::wakeup_one()
+{
+    {
+        std::lock_guard<std::mutex> lock(park_mux_);
+        park_epoch_.fetch_add(1, std::memory_order_relaxed);
+    }
+    park_cond_.notify_one();
+}
+
+void WorkThreadPool::execute(Worker* self, TaskNode* node)
+{
+    try {
+        node->task();
+    }
+    catch (std::exception& e) {
+        LOG_E << "work thread pool caught an exception while executing task. "
+              << e.what();
+    }
+
+    node->task.Reset();
+    node->free_next = self->free_head;
+    self->free_head = node;
+    if (!self->free_tail) {
+        self->free_tail = node;
+    }
+    if (++self->free_num >= WORK_TASK_NODE_FREE_BATCH) {
+        flush_free_nodes(self);
+    }
+}
+
+void WorkThreadPool::flush_free_nodes(Worker* self)
+{
+    if (!self->free_head) {
+        return;
+    }
+
+    TaskNodePool::Free(self->free_head, self->free_tail, self->free_num);
+    self->free_head = nullptr;
+    self->free_tail = nullptr;
+    self->free_num  = 0;
+}
+
+}  // namespace common_library
@@ -0,0 +1,122 @@
+#ifndef COMMON_LIBRARY_WORK_THREAD_POOL_H
+#define COMMON_LIBRARY_WORK_THREAD_POOL_H
+
+#include <thread/group.h>
+#include <thread/node_pool.h>
+#include <thread/task_executor.h>
+#include <thread/work_stealing_deque.h>
+#include <utils/list.h>
+#include <utils/noncopyable.h>
+#include <utils/utils.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// 任务节点全局空闲链表缓存的节点数上限
+#define WORK_TASK_NODE_FREE_MAX 8192
+// 工作线程攒够这么多执行完的节点再一次性归还
+#define WORK_TASK_NODE_FREE_BATCH 64
+
+namespace common_library {
+
+/**
+ * 用于执行cpu密集型任务的线程池
+ * 每个工作线程有自己的Chase-Lev队列，工作线程内投递的任务放入自己的队列
+ * 其他线程投递的任务放入共享的注入队列，工作线程空闲时从其他线程的队列窃取
+ * 所有线程都空闲时阻塞在条件变量上，投递任务时只在有线程阻塞时才唤醒
+ * 任务节点从NodePool中复用，投递任务不需要每次分配内存
+ */
+class WorkThreadPool final : public TaskExecutor, public noncopyable {
+  public:
+    typedef std::shared_ptr<WorkThreadPool> Ptr;
+
+    /**
+     * @param thread_num 线程数，0表示使用cpu核数
+     * @param enable_affinity 是否将第i个线程绑定到第i个cpu
+     */
+    WorkThreadPool(size_t             thread_num      = 0,
+                   ThreadPriority     priority        = TPRIORITY_NORMAL,
+                   bool               enable_affinity = false,
+                   const std::string& name            = "work");
+
+    /**
+     * 执行完已投递的任务后退出
+     */
+    ~WorkThreadPool();
+
+  public:
+    Task::Ptr Async(TaskIn&& task, bool may_sync = true) override;
+
+    Task::Ptr AsyncFirst(TaskIn&& task, bool may_sync = true) override;
+
+    void Post(SmallTask&& task) override;
+
+    void PostFirst(SmallTask&& task) override;
+
+    /**
+     * 当前线程是否为本线程池的工作线程
+     */
+    bool IsCurrentThread();
+
+    size_t Size();
+
+  private:
+    struct TaskNode
+    {
+        SmallTask task;
+        // 节点缓存中的空闲链表
+        TaskNode* free_next = nullptr;
+    };
+
+    typedef NodePool<TaskNode, WORK_TASK_NODE_FREE_MAX> TaskNodePool;
+
+    struct Worker
+    {
+        WorkStealingDeque<TaskNode> deque;
+        uint32_t                    rand_seed = 0;
+        // 执行完等待归还的节点，只在本工作线程访问
+        TaskNode*                   free_head = nullptr;
+        TaskNode*                   free_tail = nullptr;
+        uint64_t                    free_num  = 0;
+    };
+
+    void run(size_t index);
+
+    void post(SmallTask&& task, bool first);
+
+    TaskNode* find_task(Worker* self);
+
+    TaskNode* steal_task(Worker* self);
+
+    TaskNode* pop_inject_task();
+
+    void wakeup_one();
+
+    static void execute(Worker* self, TaskNode* node);
+
+    static void flush_free_nodes(Worker* self);
+
+  private:
+    std::vector<std::unique_ptr<Worker>> workers_;
+    ThreadGroup                          threads_;
+
+    // 非工作线程投递的任务
+    std::mutex            inject_mux_;
+    List<TaskNode*>       inject_tasks_;
+    std::atomic<uint64_t> inject_size_{0};
+
+    // 空闲线程阻塞等待
+    std::mutex              park_mux_;
+    std::condition_variable park_cond_;
+    std::atomic<uint64_t>   park_epoch_{0};
+    std::atomic<uint32_t>   parked_num_{0};
+    std::atomic<bool>       exit_flag_{false};
+};
+
+}  // namespace common_library
+
+#endif
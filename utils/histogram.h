@@ -0,0 +1,113 @@
+#ifndef COMMON_LIBRARY_HISTOGRAM_H
+#define COMMON_LIBRARY_HISTOGRAM_H
+
+#include <utils/noncopyable.h>
+
+#include <algorithm>
+#include <atomic>
+
+#include <stdint.h>
+
+#define HISTOGRAM_BUCKETS 32
+
+namespace common_library {
+
+/**
+ * 以2的幂为边界的直方图
+ * 第0个桶记录0，第i个桶记录[2^(i-1), 2^i)，超出范围的值记录在最后一个桶
+ * 只允许一个线程写入，可在任意线程读取快照
+ */
+class Histogram final : public noncopyable {
+  public:
+    struct Snapshot
+    {
+        uint64_t buckets[HISTOGRAM_BUCKETS] = {0};
+        uint64_t count                      = 0;
+        uint64_t sum                        = 0;
+        uint64_t max                        = 0;
+
+        uint64_t Mean() const
+        {
+            return count ? sum / count : 0;
+        }
+
+        /**
+         * 返回第percent百分位所在桶的上边界(不超过最大值)，percent取值0~100
+         */
+        uint64_t Percentile(double percent) const
+        {
+            if (count == 0) {
+                return 0;
+            }
+
+            uint64_t target = static_cast<uint64_t>(count * percent / 100);
+            uint64_t seen   = 0;
+            for (int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+                seen += buckets[i];
+                if (seen > target) {
+                    return std::min(bucket_limit(i), max);
+                }
+            }
+            return max;
+        }
+    };
+
+    Histogram()  = default;
+    ~Histogram() = default;
+
+  public:
+    void Record(uint64_t value)
+    {
+        // 单写者，不需要原子的读改写
+        increase(buckets_[bucket_index(value)], 1);
+        increase(count_, 1);
+        increase(sum_, value);
+        if (value > max_.load(std::memory_order_relaxed)) {
+            max_.store(value, std::memory_order_relaxed);
+        }
+    }
+
+    Snapshot GetSnapshot() const
+    {
+        Snapshot snap;
+        for (int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+            snap.buckets[i] = buckets_[i].load(std::memory_order_relaxed);
+        }
+        snap.count = count_.load(std::memory_order_relaxed);
+        snap.sum   = sum_.load(std::memory_order_relaxed);
+        snap.max   = max_.load(std::memory_order_relaxed);
+        return snap;
+    }
+
+  private:
+    static int bucket_index(uint64_t value)
+    {
+        if (value == 0) {
+            return 0;
+        }
+        int index = 64 - __builtin_clzll(value);
+        return index < HISTOGRAM_BUCKETS ? index : HISTOGRAM_BUCKETS - 1;
+    }
+
+    // 第index个桶的上边界(含)
+    static uint64_t bucket_limit(int index)
+    {
+        return (uint64_t(1) << index) - 1;
+    }
+
+    static void increase(std::atomic<uint64_t>& counter, uint64_t value)
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + value,
+                      std::memory_order_relaxed);
+    }
+
+  private:
+    std::atomic<uint64_t> buckets_[HISTOGRAM_BUCKETS] = {};
+    std::atomic<uint64_t> count_{0};
+    std::atomic<uint64_t> sum_{0};
+    std::atomic<uint64_t> max_{0};
+};
+
+}  // namespace common_library
+
+#endif
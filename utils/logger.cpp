@@ -12,6 +12,8 @@
 #    define gettid() syscall(SYS_gettid)
 #endif
 
+#define LOG_WRITE_BATCH_SIZE 128
+
 namespace common_library {
 
 static const char* s_log_const_table[][3] = {
@@ -108,46 +110,66 @@ void LogWriter::write_to_channels(const std::shared_ptr<LogContext>& pctx)
     logger_.write_channels(pctx);
 }
 
-AsyncLogWriter::AsyncLogWriter(Logger& logger) : LogWriter(logger)
+AsyncLogWriter::AsyncLogWriter(Logger& logger, uint64_t capacity)
+    : LogWriter(logger), pctxs_(capacity)
 {
-    running_ = true;
-    thread_  = new std::thread(std::bind(&AsyncLogWriter::run, this));
+    thread_ = new std::thread(std::bind(&AsyncLogWriter::run, this));
 }
 
 void AsyncLogWriter::Write(const std::shared_ptr<LogContext>& pctx)
 {
-    {
-        std::lock_guard<std::mutex> lock(mux_);
-        pctxs_.emplace_back(pctx);
+    if (!pctxs_.TryAddTask(pctx)) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
     }
-    sem_.Post();
+}
+
+uint64_t AsyncLogWriter::GetDroppedCount() const
+{
+    return dropped_.load(std::memory_order_relaxed);
 }
 
 void AsyncLogWriter::run()
 {
     set_thread_name("logger");
-    while (running_) {
-        sem_.Wait();
-        flush_all();
+
+    std::shared_ptr<LogContext> pctxs[LOG_WRITE_BATCH_SIZE];
+    uint64_t                    count;
+    // 收到退出通知前会先取完已入队的日志
+    while ((count = pctxs_.GetTasks(pctxs, LOG_WRITE_BATCH_SIZE)) > 0) {
+        for (uint64_t i = 0; i < count; i++) {
+            write_to_channels(pctxs[i]);
+            pctxs[i].reset();
+        }
+        report_dropped();
     }
 }
 
 void AsyncLogWriter::flush_all()
 {
-    List<std::shared_ptr<LogContext>> tmp_pctxs;
-    {
-        std::lock_guard<std::mutex> lock(mux_);
-        tmp_pctxs.swap(pctxs_);
+    std::shared_ptr<LogContext> pctx;
+    while (pctxs_.TryGetTask(pctx)) {
+        write_to_channels(pctx);
+    }
+    report_dropped();
+}
+
+void AsyncLogWriter::report_dropped()
+{
+    uint64_t dropped = dropped_.load(std::memory_order_relaxed);
+    if (dropped == reported_) {
+        return;
     }
 
-    tmp_pctxs.for_each(
-        [this](std::shared_ptr<LogContext>& pctx) { write_to_channels(pctx); });
+    std::shared_ptr<LogContext> pctx = std::make_shared<LogContext>(
+        LWARN, __FILE__, gettid(), __FUNCTION__, __LINE__);
+    *pctx << "log queue full, " << dropped - reported_ << " logs dropped";
+    write_to_channels(pctx);
+    reported_ = dropped;
 }
 
 AsyncLogWriter::~AsyncLogWriter()
 {
-    running_ = false;
-    sem_.Post();
+    pctxs_.PostExit(1);
     thread_->join();
     delete thread_;
     flush_all();
@@ -1,16 +1,19 @@
 #ifndef COMMON_LIBRARY_LOGGER_H
 #define COMMON_LIBRARY_LOGGER_H
 
-#include <thread/semaphore.h>
-#include <utils/list.h>
+#include <thread/bounded_task_queue.h>
 #include <utils/noncopyable.h>
 
+#include <atomic>
 #include <functional>
 #include <map>
 #include <memory>
 #include <sstream>
 #include <thread>
 
+// AsyncLogWriter队列的默认容量
+#define LOG_QUEUE_CAPACITY 65536
+
 namespace common_library {
 
 class LogContext;
@@ -89,22 +92,32 @@ class LogWriter : public noncopyable {
 
 class AsyncLogWriter final : public LogWriter {
   public:
-    AsyncLogWriter(Logger& logger);
+    AsyncLogWriter(Logger& logger, uint64_t capacity = LOG_QUEUE_CAPACITY);
     ~AsyncLogWriter();
 
   public:
+    /**
+     * 队列满时丢弃并计数，不阻塞写日志的线程
+     */
     void Write(const std::shared_ptr<LogContext>& pctx) override;
 
+    /**
+     * 因队列满而丢弃的日志条数，可在任意线程调用
+     */
+    uint64_t GetDroppedCount() const;
+
   private:
     void run();
     void flush_all();
+    void report_dropped();
 
   private:
-    volatile bool                     running_;
-    std::thread*                      thread_;
-    Semaphore                         sem_;
-    List<std::shared_ptr<LogContext>> pctxs_;
-    std::mutex                        mux_;
+    std::thread* thread_;
+    // 有界队列，内存占用可预期
+    BoundedTaskQueue<std::shared_ptr<LogContext>> pctxs_;
+    std::atomic<uint64_t>                         dropped_{0};
+    // 已经输出过提示的丢弃条数，只在日志线程中访问
+    uint64_t                                      reported_ = 0;
 };
 
 class LogChannel : public noncopyable {
@@ -7,6 +7,7 @@
 
 #include <linux/limits.h>
 #include <sched.h>
+#include <time.h>
 #include <unistd.h>
 
 namespace common_library {
@@ -66,6 +67,27 @@ uint64_t get_current_seconds()
     return s_now_seconds.load(std::memory_order_acquire);
 }
 
+uint64_t get_steady_microseconds()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+uint64_t get_steady_milliseconds()
+{
+    return get_steady_microseconds() / 1000;
+}
+
+uint64_t get_thread_cpu_microseconds()
+{
+    struct timespec ts;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) == -1) {
+        return 0;
+    }
+    return ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
 std::string print_time(const timeval& tv)
 {
     time_t sec = tv.tv_sec;
@@ -126,4 +148,21 @@ bool set_thread_name(const std::string& name)
     return (pthread_setname_np(pthread_self(), name.c_str()) == 0);
 }
 
+bool set_thread_affinity(int cpu, pthread_t tid)
+{
+    static int cpus = std::thread::hardware_concurrency();
+    if (cpus <= 0 || cpu < 0) {
+        return false;
+    }
+
+    if (tid == 0) {
+        tid = pthread_self();
+    }
+
+    cpu_set_t mask;
+    CPU_ZERO(&mask);
+    CPU_SET(cpu % cpus, &mask);
+    return pthread_setaffinity_np(tid, sizeof(mask), &mask) == 0;
+}
+
 }  // namespace common_library
\ No newline at end of file
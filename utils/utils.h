@@ -46,6 +46,18 @@ uint64_t get_current_milliseconds();
 
 uint64_t get_current_seconds();
 
+/**
+ * 单调时钟微秒数，每次调用实时读取，用于微秒级的耗时统计
+ */
+uint64_t get_steady_microseconds();
+
+uint64_t get_steady_milliseconds();
+
+/**
+ * 当前线程消耗的cpu时间(微秒)
+ */
+uint64_t get_thread_cpu_microseconds();
+
 std::string print_time(const timeval& tv);
 
 std::string get_exe_path();
@@ -64,6 +76,11 @@ bool set_thread_priority(ThreadPriority priority = TPRIORITY_NORMAL,
                          pthread_t      tid      = 0);
 
 bool set_thread_name(const std::string& name);
+
+/**
+ * 将线程绑定到指定cpu，cpu超出范围时取模
+ */
+bool set_thread_affinity(int cpu, pthread_t tid = 0);
 }  // namespace common_library
 
 #endif
\ No newline at end of file